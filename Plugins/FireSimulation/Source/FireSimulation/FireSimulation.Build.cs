@@ -36,6 +36,7 @@ public class FireSimulation : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"Json",
 				"Slate",
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...
@@ -0,0 +1,144 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireScratchPool.h"
+
+#include "RenderGraphBuilder.h"
+#include "RenderTargetPool.h"
+
+void FFireScratchPool::Reset()
+{
+	Logicals.Reset();
+	Physicals.Reset();
+	bPlanned = false;
+}
+
+int32 FFireScratchPool::Declare(const TCHAR* Name, const FRDGTextureDesc& Desc, int32 FirstStage, int32 LastStage)
+{
+	check(!bPlanned);
+	check(FirstStage <= LastStage);
+
+	FLogical& Logical = Logicals.AddDefaulted_GetRef();
+	Logical.Name = Name;
+	Logical.Desc = Desc;
+	Logical.FirstStage = FirstStage;
+	Logical.LastStage = LastStage;
+	return Logicals.Num() - 1;
+}
+
+void FFireScratchPool::Plan(bool bAllowAliasing)
+{
+	check(!bPlanned);
+
+	// greedy interval colouring in order of first use, optimal for each texture description
+	TArray<int32> Order;
+	Order.Reserve(Logicals.Num());
+	for (int32 Index = 0; Index < Logicals.Num(); ++Index)
+	{
+		Order.Add(Index);
+	}
+	Order.StableSort([this](int32 A, int32 B) { return Logicals[A].FirstStage < Logicals[B].FirstStage; });
+
+	for (const int32 Index : Order)
+	{
+		FLogical& Logical = Logicals[Index];
+		for (int32 PhysicalIndex = 0; bAllowAliasing && PhysicalIndex < Physicals.Num(); ++PhysicalIndex)
+		{
+			FPhysical& Physical = Physicals[PhysicalIndex];
+			// a stage may read one logical texture and write another, so lifetimes that touch in a stage overlap
+			if (Physical.Desc == Logical.Desc && Physical.LastStage < Logical.FirstStage)
+			{
+				Physical.LastStage = Logical.LastStage;
+				Logical.Physical = PhysicalIndex;
+				break;
+			}
+		}
+
+		if (Logical.Physical == INDEX_NONE)
+		{
+			FPhysical& Physical = Physicals.AddDefaulted_GetRef();
+			Physical.Name = Logical.Name;
+			Physical.Desc = Logical.Desc;
+			Physical.LastStage = Logical.LastStage;
+			Logical.Physical = Physicals.Num() - 1;
+		}
+	}
+
+	bPlanned = true;
+}
+
+void FFireScratchPool::BeginStep(FRDGBuilder& GraphBuilder)
+{
+	check(bPlanned);
+
+	for (int32 PhysicalIndex = 0; PhysicalIndex < Physicals.Num(); ++PhysicalIndex)
+	{
+		FPhysical& Physical = Physicals[PhysicalIndex];
+		Physical.bAllocated = !Physical.Texture.IsValid();
+		if (Physical.bAllocated)
+		{
+			Physical.Texture = GRenderTargetPool.FindFreeElement(Physical.Desc, Physical.Name);
+		}
+		Physical.StepTexture = GraphBuilder.RegisterExternalTexture(Physical.Texture);
+	}
+}
+
+FRDGTextureRef FFireScratchPool::Get(int32 Handle) const
+{
+	if (Handle == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	return Physicals[Logicals[Handle].Physical].StepTexture;
+}
+
+bool FFireScratchPool::WasAllocated(int32 Handle) const
+{
+	return Physicals[Logicals[Handle].Physical].bAllocated;
+}
+
+void FFireScratchPool::SwapPhysical(int32 StateIn, int32 StateOut)
+{
+	const int32 PhysicalIn = Logicals[StateIn].Physical;
+	const int32 PhysicalOut = Logicals[StateOut].Physical;
+	if (PhysicalIn != PhysicalOut)
+	{
+		Swap(Physicals[PhysicalIn].Texture, Physicals[PhysicalOut].Texture);
+	}
+}
+
+TRefCountPtr<IPooledRenderTarget> FFireScratchPool::GetPooledTexture(int32 Handle) const
+{
+	check(bPlanned);
+	return Physicals[Logicals[Handle].Physical].Texture;
+}
+
+void FFireScratchPool::SetPooledTexture(int32 Handle, const TRefCountPtr<IPooledRenderTarget>& Texture)
+{
+	check(bPlanned);
+	Physicals[Logicals[Handle].Physical].Texture = Texture;
+}
+
+uint64 FFireScratchPool::GetTextureBytes(const FRDGTextureDesc& Desc)
+{
+	return static_cast<uint64>(GPixelFormats[Desc.Format].BlockBytes) * Desc.Extent.X * Desc.Extent.Y * Desc.Depth;
+}
+
+uint64 FFireScratchPool::GetPeakBytes() const
+{
+	uint64 Bytes = 0;
+	for (const FPhysical& Physical : Physicals)
+	{
+		Bytes += GetTextureBytes(Physical.Desc);
+	}
+	return Bytes;
+}
+
+uint64 FFireScratchPool::GetUnaliasedBytes() const
+{
+	uint64 Bytes = 0;
+	for (const FLogical& Logical : Logicals)
+	{
+		Bytes += GetTextureBytes(Logical.Desc);
+	}
+	return Bytes;
+}
@@ -0,0 +1,76 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RendererInterface.h"
+#include "RenderGraphDefinitions.h"
+
+/**
+ * Persistent scratch textures of a simulation step.
+ * Logical textures are declared with the range of stages in which they are live. Plan assigns them to physical
+ * textures, logical textures with the same description and disjoint lifetimes share one physical texture.
+ * Physical textures are allocated once and kept across steps, so a step does no transient allocations.
+ */
+class FFireScratchPool
+{
+public:
+	void Reset();
+
+	/** Declares a logical texture that is written first in FirstStage and read last in LastStage */
+	int32 Declare(const TCHAR* Name, const FRDGTextureDesc& Desc, int32 FirstStage, int32 LastStage);
+	/** Assigns physical textures, without aliasing every logical texture gets its own */
+	void Plan(bool bAllowAliasing = true);
+
+	/** Registers all physical textures with the graph, allocates the ones that do not exist yet */
+	void BeginStep(FRDGBuilder& GraphBuilder);
+	/** Returns the texture of a logical texture for the current step, null for INDEX_NONE */
+	FRDGTextureRef Get(int32 Handle) const;
+	/** True if the physical texture of a logical texture was allocated by the current step and holds no data yet */
+	bool WasAllocated(int32 Handle) const;
+
+	/**
+	 * Exchanges the physical textures of two logical textures, used to carry the output of a step over as the input of
+	 * the next one. StateIn has to be the first user of its physical texture and StateOut the last user of its own.
+	 */
+	void SwapPhysical(int32 StateIn, int32 StateOut);
+
+	/** Access to the physical texture of a logical texture, used to carry state over when the pool is planned again */
+	TRefCountPtr<IPooledRenderTarget> GetPooledTexture(int32 Handle) const;
+	void SetPooledTexture(int32 Handle, const TRefCountPtr<IPooledRenderTarget>& Texture);
+
+	/** Index of the physical texture of a logical texture, INDEX_NONE before Plan */
+	int32 GetPhysical(int32 Handle) const { return Logicals[Handle].Physical; }
+	int32 GetNumLogical() const { return Logicals.Num(); }
+	int32 GetNumPhysical() const { return Physicals.Num(); }
+	/** Memory of all physical textures, which is the peak scratch memory of a step */
+	uint64 GetPeakBytes() const;
+	/** Memory the logical textures would need without aliasing */
+	uint64 GetUnaliasedBytes() const;
+
+private:
+	struct FLogical
+	{
+		const TCHAR* Name = nullptr;
+		FRDGTextureDesc Desc;
+		int32 FirstStage = 0;
+		int32 LastStage = 0;
+		int32 Physical = INDEX_NONE;
+	};
+
+	struct FPhysical
+	{
+		const TCHAR* Name = nullptr;
+		FRDGTextureDesc Desc;
+		int32 LastStage = 0;
+		TRefCountPtr<IPooledRenderTarget> Texture;
+		FRDGTextureRef StepTexture = nullptr;
+		bool bAllocated = false;
+	};
+
+	static uint64 GetTextureBytes(const FRDGTextureDesc& Desc);
+
+	TArray<FLogical> Logicals;
+	TArray<FPhysical> Physicals;
+	bool bPlanned = false;
+};
@@ -5,6 +5,7 @@
 
 IMPLEMENT_GLOBAL_SHADER(FFireShaderClearFloatCS, "/FireSimulation/Private/FireSimulation.usf", "CSClearFloat", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderClearFloat4CS, "/FireSimulation/Private/FireSimulation.usf", "CSClearFloat4", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderClearFluidCS, "/FireSimulation/Private/FireSimulation.usf", "CSClearFluid", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderPrepareFluidDataAdvectionCS, "/FireSimulation/Private/FireSimulation.usf", "CSPrepareFluidDataAdvection", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderAdvectFluidDataCS, "/FireSimulation/Private/FireSimulation.usf", "CSAdvectFluidData", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderAdvectVelocityCS, "/FireSimulation/Private/FireSimulation.usf", "CSAdvectVelocity", SF_Compute);
@@ -15,4 +16,29 @@ IMPLEMENT_GLOBAL_SHADER(FFireShaderConfinementCS, "/FireSimulation/Private/FireS
 IMPLEMENT_GLOBAL_SHADER(FFireShaderDivergenceCS, "/FireSimulation/Private/FireSimulation.usf", "CSDivergence", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderPreparePressureCS, "/FireSimulation/Private/FireSimulation.usf", "CSPreparePressure", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderPressureCS, "/FireSimulation/Private/FireSimulation.usf", "CSPressure", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderPressureTiledCS, "/FireSimulation/Private/FireSimulation.usf", "CSPressureTiled", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderMultigridObstaclesCS, "/FireSimulation/Private/FireSimulation.usf", "CSMultigridObstacles", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderMultigridSmoothCS, "/FireSimulation/Private/FireSimulation.usf", "CSMultigridSmooth", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderMultigridResidualCS, "/FireSimulation/Private/FireSimulation.usf", "CSMultigridResidual", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderMultigridRestrictCS, "/FireSimulation/Private/FireSimulation.usf", "CSMultigridRestrict", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderMultigridProlongCS, "/FireSimulation/Private/FireSimulation.usf", "CSMultigridProlong", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderResidualNormCS, "/FireSimulation/Private/FireSimulation.usf", "CSResidualNorm", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderResidualReduceCS, "/FireSimulation/Private/FireSimulation.usf", "CSResidualReduce", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderVelocityMaxCS, "/FireSimulation/Private/FireSimulation.usf", "CSVelocityMax", SF_Compute);
 IMPLEMENT_GLOBAL_SHADER(FFireShaderProjectionCS, "/FireSimulation/Private/FireSimulation.usf", "CSProjection", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderAdvectVelocityBuoyancyCS, "/FireSimulation/Private/FireSimulation.usf", "CSAdvectVelocityBuoyancy", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderAdvectFluidExtinguishCS, "/FireSimulation/Private/FireSimulation.usf", "CSAdvectFluidExtinguish", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderVorticityConfinementCS, "/FireSimulation/Private/FireSimulation.usf", "CSVorticityConfinement", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderDivergencePreparePressureCS, "/FireSimulation/Private/FireSimulation.usf", "CSDivergencePreparePressure", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderPackObstaclesCS, "/FireSimulation/Private/FireSimulation.usf", "CSPackObstacles", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderDynamicObstaclesCS, "/FireSimulation/Private/FireSimulation.usf", "CSDynamicObstacles", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderStaticObstaclesCS, "/FireSimulation/Private/FireSimulation.usf", "CSStaticObstacles", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderAddEmitterCS, "/FireSimulation/Private/FireSimulation.usf", "CSAddEmitter", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderReadbackFieldCS, "/FireSimulation/Private/FireSimulation.usf", "CSReadbackField", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderResampleCS, "/FireSimulation/Private/FireSimulation.usf", "CSResample", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderResampleFloatCS, "/FireSimulation/Private/FireSimulation.usf", "CSResampleFloat", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderScrollClearCS, "/FireSimulation/Private/FireSimulation.usf", "CSScrollClear", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderScrollClearFloatCS, "/FireSimulation/Private/FireSimulation.usf", "CSScrollClearFloat", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderCascadeExchangeCS, "/FireSimulation/Private/FireSimulation.usf", "CSCascadeExchange", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderSparseUpdateBricksCS, "/FireSimulation/Private/FireSimulation.usf", "CSSparseUpdateBricks", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FFireShaderSparseBuildArgsCS, "/FireSimulation/Private/FireSimulation.usf", "CSSparseBuildArgs", SF_Compute);
@@ -4,18 +4,124 @@
 
 #include "CoreMinimal.h"
 #include "DataDrivenShaderPlatformInfo.h"
+#include "GlobalShader.h"
 #include "IntVectorTypes.h"
+#include "RenderGraphUtils.h"
 #include "ShaderParameterStruct.h"
+#include "ShaderPermutation.h"
+
+/** Addressing of a grid, the slots of an atlas or the wrapped origin of a scrolling grid */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireAtlasParameters, )
+	SHADER_PARAMETER(FIntVector3, AtlasSlots)
+	SHADER_PARAMETER(int32, AtlasSlotSize)
+	SHADER_PARAMETER(int32, AtlasFluidSlotSize)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FBrickDesc>, Bricks)
+	SHADER_PARAMETER(FIntVector3, VelocityScroll)
+	SHADER_PARAMETER(FIntVector3, FluidScroll)
+END_SHADER_PARAMETER_STRUCT()
+
+/** Obstacle bits and per brick summary packed from the obstacle texture by FFireShaderPackObstaclesCS, plus the moving bodies */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireObstacleParameters, )
+	SHADER_PARAMETER(FIntVector3, ObstacleBrickCount)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, obstacleMaskIn)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, obstacleBricksIn)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, dynamicObstaclesIn)
+END_SHADER_PARAMETER_STRUCT()
+
+/** Brick list of a sparse dispatch, SparseArgs holds the indirect arguments at SparseArgsOffset */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireSparseParameters, )
+	SHADER_PARAMETER(FIntVector3, SparseBrickCount)
+	SHADER_PARAMETER(int32, SparseFluidScale)
+	SHADER_PARAMETER(float, SparseThreshold)
+	SHADER_PARAMETER(uint32, SparseArgsOffset)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, SparseBricks)
+	SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, SparseContentOut)
+	RDG_BUFFER_ACCESS(SparseArgs, ERHIAccess::IndirectArgs)
+END_SHADER_PARAMETER_STRUCT()
+
+/** Per channel scale of the fluid state in its storage format, one for float formats */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireStorageParameters, )
+	SHADER_PARAMETER(FVector4f, FluidStorageScale)
+	SHADER_PARAMETER(FVector4f, RcpFluidStorageScale)
+END_SHADER_PARAMETER_STRUCT()
+
+/** Emitters splatted by FFireShaderAddEmitterCS, added by the fluid update of every sub-step while EmitterActive is set */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireEmitterParameters, )
+	SHADER_PARAMETER(int32, EmitterActive)
+	SHADER_PARAMETER(float, EmitterFraction)
+	SHADER_PARAMETER(FVector3f, emitterScale)
+	SHADER_PARAMETER(float, vaporMinTemperature)
+	SHADER_PARAMETER(float, vaporTemperatureScale)
+	SHADER_PARAMETER(float, vaporDensity)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, emitterIn)
+END_SHADER_PARAMETER_STRUCT()
+
+/** Impulses of a step, added by the velocity update of every sub-step. The arrays hold FireSimulationCommands::MaxImpulses. */
+BEGIN_SHADER_PARAMETER_STRUCT(FFireImpulseParameters, )
+	SHADER_PARAMETER(int32, NumImpulses)
+	SHADER_PARAMETER(FVector3f, ImpulseCellSize)
+	SHADER_PARAMETER_ARRAY(FVector4f, ImpulseSpheres, [16])
+	SHADER_PARAMETER_ARRAY(FVector4f, ImpulseVelocities, [16])
+END_SHADER_PARAMETER_STRUCT()
 
 class FFireShaderBaseCS : public FGlobalShader
 {
 public:
+	class FAtlasDim : SHADER_PERMUTATION_BOOL("FIRE_ATLAS");
+	class FSparseDim : SHADER_PERMUTATION_BOOL("FIRE_SPARSE");
+	using FPermutationDomain = TShaderPermutationDomain<FAtlasDim, FSparseDim>;
+
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
-		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+		return ShouldCompileGridPermutation(Parameters, FPermutationDomain(Parameters.PermutationId));
+	}
+
+	/** Atlas volumes are never sparse */
+	template<typename TPermutationDomain>
+	static bool ShouldCompileGridPermutation(const FGlobalShaderPermutationParameters& Parameters, const TPermutationDomain& PermutationVector)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5)
+			&& !(PermutationVector.template Get<FAtlasDim>() && PermutationVector.template Get<FSparseDim>());
+	}
+};
+
+/** Base of the kernels without atlas and sparse permutations, they address their textures directly */
+class FFireShaderNoPermutationCS : public FFireShaderBaseCS
+{
+public:
+	using FPermutationDomain = FShaderPermutationNone;
+};
+
+/** Selects the permutation of a fire kernel */
+struct FFireShaderPermutation
+{
+	bool bAtlas = false;
+	bool bSparse = false;
+
+	template<typename TShaderClass>
+	TShaderMapRef<TShaderClass> Get() const
+	{
+		typename TShaderClass::FPermutationDomain PermutationVector;
+		PermutationVector.template Set<FFireShaderBaseCS::FAtlasDim>(bAtlas);
+		PermutationVector.template Set<FFireShaderBaseCS::FSparseDim>(bSparse);
+		return TShaderMapRef<TShaderClass>(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
 	}
 };
 
+/** Dispatches a fire kernel over GroupCount, or indirectly over the bricks of its sparse parameters */
+template<typename TShaderClass>
+void DispatchFireShader(FRHIComputeCommandList& RHICmdList, const TShaderMapRef<TShaderClass>& Shader, const typename TShaderClass::FParameters& Parameters, const FIntVector& GroupCount)
+{
+	if (FRDGBuffer* SparseArgs = Parameters.Sparse.SparseArgs)
+	{
+		FComputeShaderUtils::DispatchIndirect(RHICmdList, Shader, Parameters, SparseArgs->GetIndirectRHICallBuffer(), Parameters.Sparse.SparseArgsOffset);
+	}
+	else
+	{
+		FComputeShaderUtils::Dispatch(RHICmdList, Shader, Parameters, GroupCount);
+	}
+}
+
 class FFireShaderClearFloatCS : public FFireShaderBaseCS
 {
 public:
@@ -23,6 +129,8 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderClearFloatCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float>, outputFloat)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -34,6 +142,21 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderClearFloat4CS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderClearFluidCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderClearFluidCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderClearFluidCS, FFireShaderBaseCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -45,15 +168,19 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderPrepareFluidDataAdvectionCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(FVector2f, TScale)
 		SHADER_PARAMETER(float, Forward)
 		SHADER_PARAMETER(FVector3f, WorldToGrid)
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
 		SHADER_PARAMETER(FVector3f, RcpFluidSize)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FIntVector3, FluidBounds)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, phiIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -65,6 +192,9 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderAdvectFluidDataCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
 		SHADER_PARAMETER(FVector2f, TScale)
 		SHADER_PARAMETER(float, Forward)
 		SHADER_PARAMETER(FVector4f, FluidDissipation)
@@ -73,12 +203,13 @@ public:
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
 		SHADER_PARAMETER(FVector3f, RcpFluidSize)
 		SHADER_PARAMETER(FIntVector3, FluidBounds)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, phi0)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, phi1)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -90,13 +221,16 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderAdvectVelocityCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(float, Forward)
 		SHADER_PARAMETER(FVector3f, Dissipation)
 		SHADER_PARAMETER(FVector3f, WorldToGrid)
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -108,14 +242,22 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderBuoyancyCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
 		SHADER_PARAMETER(float, Buoyancy)
 		SHADER_PARAMETER(float, Weight)
 		SHADER_PARAMETER(float, AmbientTemperature)
 		SHADER_PARAMETER(FVector3f, Up)
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER(FVector3f, RcpFluidSize)
+		SHADER_PARAMETER(FVector2f, TScale)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FIntVector3, FluidBounds)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireImpulseParameters, Impulse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
@@ -128,15 +270,20 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderExtinguishCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
 		SHADER_PARAMETER(FVector2f, TScale)
 		SHADER_PARAMETER(float, Amount)
 		SHADER_PARAMETER(FVector3f, Extinguishment)
 		SHADER_PARAMETER(FVector3f, TempDistribution)
 		SHADER_PARAMETER(FIntVector3, FluidBounds)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireEmitterParameters, Emitter)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -148,6 +295,8 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderVorticityCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
@@ -161,6 +310,8 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderConfinementCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(float, Strength)
 		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
@@ -176,11 +327,13 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderDivergenceCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
 		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -192,6 +345,8 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderPreparePressureCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, divergenceIn)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
 	END_SHADER_PARAMETER_STRUCT()
@@ -204,14 +359,179 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderPressureCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, divergenceIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Runs up to PRESSURE_SWEEPS Jacobi iterations per dispatch in groupshared memory */
+class FFireShaderPressureTiledCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderPressureTiledCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderPressureTiledCS, FFireShaderBaseCS);
+
+	static constexpr int32 MaxSweeps = 4;
+	class FSweepsDim : SHADER_PERMUTATION_RANGE_INT("PRESSURE_SWEEPS", 1, MaxSweeps);
+	using FPermutationDomain = TShaderPermutationDomain<FAtlasDim, FSparseDim, FSweepsDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return ShouldCompileGridPermutation(Parameters, FPermutationDomain(Parameters.PermutationId));
+	}
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER(int32, NumSweeps)
 		SHADER_PARAMETER(FIntVector3, VelocityBounds)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, divergenceIn)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
 	END_SHADER_PARAMETER_STRUCT()
 };
 
+/** Writes the obstacles of the finest multigrid level from the packed obstacles */
+class FFireShaderMultigridObstaclesCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderMultigridObstaclesCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderMultigridObstaclesCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, LevelBounds)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, obstaclesOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderMultigridSmoothCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderMultigridSmoothCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderMultigridSmoothCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, LevelBounds)
+		SHADER_PARAMETER(float, CellArea)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, rhsIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, obstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderMultigridResidualCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderMultigridResidualCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderMultigridResidualCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, LevelBounds)
+		SHADER_PARAMETER(float, CellArea)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, rhsIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, obstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderMultigridRestrictCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderMultigridRestrictCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderMultigridRestrictCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, LevelBounds)
+		SHADER_PARAMETER(float, CellArea)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, rhsIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, obstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, pressureOut)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, obstaclesOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderMultigridProlongCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderMultigridProlongCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderMultigridProlongCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, LevelBounds)
+		SHADER_PARAMETER(FVector3f, RcpLevelSize)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, coarseIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, obstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Reduces the residual of the pressure solve per thread group */
+class FFireShaderResidualNormCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderResidualNormCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderResidualNormCS, FFireShaderBaseCS);
+
+	/** Runs over the whole grid, inactive bricks of a sparse grid hold zeros */
+	using FPermutationDomain = TShaderPermutationDomain<FAtlasDim>;
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER(FIntVector3, NumGroups)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, divergenceIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<float4>, residualOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Reduces the group results of FFireShaderResidualNormCS in a single group */
+class FFireShaderResidualReduceCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderResidualReduceCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderResidualReduceCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(int32, NumPartials)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float4>, residualIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<float4>, residualOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Reduces the largest velocity in cells per second per group into y, FFireShaderResidualReduceCS reduces the group results */
+class FFireShaderVelocityMaxCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderVelocityMaxCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderVelocityMaxCS, FFireShaderBaseCS);
+
+	/** Runs over the whole grid, inactive bricks of a sparse grid hold zeros */
+	using FPermutationDomain = TShaderPermutationDomain<FAtlasDim>;
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER(FIntVector3, NumGroups)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FVector3f, WorldToGrid)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<float4>, residualOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
 class FFireShaderProjectionCS : public FFireShaderBaseCS
 {
 public:
@@ -219,10 +539,322 @@ public:
 	SHADER_USE_PARAMETER_STRUCT(FFireShaderProjectionCS, FFireShaderBaseCS);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
 		SHADER_PARAMETER(FIntVector3, VelocityBounds)
-		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, obstaclesIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, pressureIn)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float4>, outputFloat4)
 	END_SHADER_PARAMETER_STRUCT()
 };
+
+class FFireShaderAdvectVelocityBuoyancyCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderAdvectVelocityBuoyancyCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderAdvectVelocityBuoyancyCS, FFireShaderBaseCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
+		SHADER_PARAMETER(float, Forward)
+		SHADER_PARAMETER(FVector3f, Dissipation)
+		SHADER_PARAMETER(float, Buoyancy)
+		SHADER_PARAMETER(float, Weight)
+		SHADER_PARAMETER(float, AmbientTemperature)
+		SHADER_PARAMETER(FVector3f, Up)
+		SHADER_PARAMETER(FVector3f, WorldToGrid)
+		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER(FVector3f, RcpFluidSize)
+		SHADER_PARAMETER(FVector2f, TScale)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FIntVector3, FluidBounds)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireImpulseParameters, Impulse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderAdvectFluidExtinguishCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderAdvectFluidExtinguishCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderAdvectFluidExtinguishCS, FFireShaderBaseCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
+		SHADER_PARAMETER(FVector2f, TScale)
+		SHADER_PARAMETER(float, Forward)
+		SHADER_PARAMETER(FVector4f, FluidDissipation)
+		SHADER_PARAMETER(FVector4f, FluidDecay)
+		SHADER_PARAMETER(float, Amount)
+		SHADER_PARAMETER(FVector3f, Extinguishment)
+		SHADER_PARAMETER(FVector3f, TempDistribution)
+		SHADER_PARAMETER(FVector3f, WorldToGrid)
+		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER(FVector3f, RcpFluidSize)
+		SHADER_PARAMETER(FIntVector3, FluidBounds)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, phi0)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, phi1)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireEmitterParameters, Emitter)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderVorticityConfinementCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderVorticityConfinementCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderVorticityConfinementCS, FFireShaderBaseCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER(float, Strength)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderDivergencePreparePressureCS : public FFireShaderBaseCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderDivergencePreparePressureCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderDivergencePreparePressureCS, FFireShaderBaseCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireAtlasParameters, Atlas)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireSparseParameters, Sparse)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireObstacleParameters, Obstacles)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, outputFloat)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture<float>, pressureOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Packs the obstacle texture into one bit per texel and classifies its bricks of 8^3 texels */
+class FFireShaderPackObstaclesCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderPackObstaclesCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderPackObstaclesCS, FFireShaderNoPermutationCS);
+
+	/** Words of the bit mask per brick */
+	static constexpr int32 BrickWords = 16;
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, ObstacleBrickCount)
+		SHADER_PARAMETER(int32, PackBrickList)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, obstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, dynamicObstaclesIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint4>, dynamicBricksIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, obstacleMaskOut)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, obstacleBricksOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Rasterizes the shapes of moving bodies into the bricks of a dirty brick list, see FFireDynamicObstacles */
+class FFireShaderDynamicObstaclesCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderDynamicObstaclesCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderDynamicObstaclesCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, DynamicBounds)
+		SHADER_PARAMETER(FIntVector3, DynamicScroll)
+		SHADER_PARAMETER(FVector3f, DynamicOrigin)
+		SHADER_PARAMETER(FVector3f, DynamicCellSize)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint4>, dynamicBricksIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, dynamicShapeIndicesIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FObstacleShape>, dynamicShapesIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float4>, dynamicPlanesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, dynamicObstaclesOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Marks the cells of the voxelized static geometry as solid in the obstacle texture, see FFireSimulationVoxelizer */
+class FFireShaderStaticObstaclesCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderStaticObstaclesCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderStaticObstaclesCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, StaticObstacleBounds)
+		SHADER_PARAMETER(FIntVector3, StaticObstacleResolution)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, staticObstaclesIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Splats the emitters of a step into the bricks of a brick list and marks the bricks that received fluid, see FFireEmitterBatch */
+class FFireShaderAddEmitterCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderAddEmitterCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderAddEmitterCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, EmitterBounds)
+		SHADER_PARAMETER(FVector3f, EmitterCellSize)
+		SHADER_PARAMETER(int32, EmitterMarkContent)
+		SHADER_PARAMETER(FIntVector3, SparseBrickCount)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint4>, emitterBricksIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, emitterIndicesIn)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FEmitter>, emittersIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, SparseContentOut)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, emitterOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Downsamples temperature, reaction, smoke and velocity of a standalone volume into a buffer read back by the CPU */
+class FFireShaderReadbackFieldCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderReadbackFieldCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderReadbackFieldCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FFireStorageParameters, Storage)
+		SHADER_PARAMETER(FIntVector3, ReadbackBounds)
+		SHADER_PARAMETER(int32, ReadbackFactor)
+		SHADER_PARAMETER(FIntVector3, VelocityScroll)
+		SHADER_PARAMETER(FIntVector3, FluidScroll)
+		SHADER_PARAMETER(FVector3f, RcpVelocitySize)
+		SHADER_PARAMETER(FVector2f, TScale)
+		SHADER_PARAMETER(FIntVector3, VelocityBounds)
+		SHADER_PARAMETER(FIntVector3, FluidBounds)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, velocityIn)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, fluidDataIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<uint4>, readbackOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Carries a field over to a grid of another resolution, the cell centers of both grids span the same volume */
+class FFireShaderResampleCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderResampleCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderResampleCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, ResampleBounds)
+		SHADER_PARAMETER(FVector4f, ResampleScale)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, resampleIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderResampleFloatCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderResampleFloatCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderResampleFloatCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, ResampleBounds)
+		SHADER_PARAMETER(FVector4f, ResampleScale)
+		SHADER_PARAMETER_SAMPLER(SamplerState, _LinearClamp)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float>, resampleFloatIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Clears the cells that entered a scrolling grid with its last scroll of ScrollDelta cells */
+class FFireShaderScrollClearCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderScrollClearCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderScrollClearCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, ScrollBounds)
+		SHADER_PARAMETER(FIntVector3, ScrollOffset)
+		SHADER_PARAMETER(FIntVector3, ScrollDelta)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderScrollClearFloatCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderScrollClearFloatCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderScrollClearFloatCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, ScrollBounds)
+		SHADER_PARAMETER(FIntVector3, ScrollOffset)
+		SHADER_PARAMETER(FIntVector3, ScrollDelta)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float>, outputFloat)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Exchanges a float4 field between two nested levels of a cascade, see FFireSimulationCascade */
+class FFireShaderCascadeExchangeCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderCascadeExchangeCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderCascadeExchangeCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, CascadeDstBounds)
+		SHADER_PARAMETER(FIntVector3, CascadeDstScroll)
+		SHADER_PARAMETER(FIntVector3, CascadeSrcBounds)
+		SHADER_PARAMETER(FIntVector3, CascadeSrcScroll)
+		SHADER_PARAMETER(float, CascadeScale)
+		SHADER_PARAMETER(FVector3f, CascadeOffset)
+		SHADER_PARAMETER(int32, CascadeBorder)
+		SHADER_PARAMETER(int32, CascadeRestrict)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture3D<float4>, cascadeIn)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture3D<float4>, outputFloat4)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+/** Builds the active and retired brick lists of a sparse step from the content flags of the previous step */
+class FFireShaderSparseUpdateBricksCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderSparseUpdateBricksCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderSparseUpdateBricksCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntVector3, SparseBrickCount)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, brickContentIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, brickStateOut)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, activeBricksOut)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, retiredBricksOut)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, brickCountersOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
+
+class FFireShaderSparseBuildArgsCS : public FFireShaderNoPermutationCS
+{
+public:
+	DECLARE_GLOBAL_SHADER(FFireShaderSparseBuildArgsCS);
+	SHADER_USE_PARAMETER_STRUCT(FFireShaderSparseBuildArgsCS, FFireShaderNoPermutationCS);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(int32, SparseFluidScale)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, brickCountersIn)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, brickArgsOut)
+	END_SHADER_PARAMETER_STRUCT()
+};
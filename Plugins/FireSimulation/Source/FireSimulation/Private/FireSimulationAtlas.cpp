@@ -0,0 +1,142 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationAtlas.h"
+
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+
+static int32 GFireSimulationAtlasSlotsPerAxis = 4;
+static FAutoConsoleVariableRef CVarFireSimulationAtlasSlotsPerAxis(
+	TEXT("r.FireSimulation.AtlasSlotsPerAxis"),
+	GFireSimulationAtlasSlotsPerAxis,
+	TEXT("Number of volume slots per axis of newly created fire simulation atlases."),
+	ECVF_Default);
+
+static const FIntVector3 THREAD_COUNT = { 8, 8, 8 };
+
+bool FFireSimulationAtlas::CanHold(const FIntVector& VelocityResolution)
+{
+	return VelocityResolution.GetMax() <= SlotSize;
+}
+
+FFireSimulationAtlas::FFireSimulationAtlas(const FFireSimulationConfig& InConfig)
+	: Config(InConfig)
+{
+	const int32 SlotsPerAxis = FMath::Clamp(GFireSimulationAtlasSlotsPerAxis, 1, 8);
+	Slots = FIntVector(SlotsPerAxis);
+	UsedSlots.Init(false, Slots.X * Slots.Y * Slots.Z);
+
+	const FIntVector Resolution = Slots * SlotSize;
+	Context.InitializeResolution(Resolution, Config.FluidResolutionScale, FVector(Resolution));
+}
+
+bool FFireSimulationAtlas::IsCompatible(const FFireSimulationConfig& Other) const
+{
+	// all bricks of an atlas are stepped with the same parameters, only the placement differs per brick
+	return Config.FluidResolutionScale == Other.FluidResolutionScale
+		&& Config.NumPressureIterations == Other.NumPressureIterations
+		&& Config.bAdaptiveSubSteps == Other.bAdaptiveSubSteps
+		&& Config.CflNumber == Other.CflNumber
+		&& Config.MaxSubSteps == Other.MaxSubSteps
+		&& Config.bInterpolateOutput == Other.bInterpolateOutput
+		&& Config.PressureSweepsPerDispatch == Other.PressureSweepsPerDispatch
+		&& Config.bWarmStartPressure == Other.bWarmStartPressure
+		&& Config.bAdaptivePressureIterations == Other.bAdaptivePressureIterations
+		&& Config.MinPressureIterations == Other.MinPressureIterations
+		&& Config.MaxPressureIterations == Other.MaxPressureIterations
+		&& Config.PressureResidualTarget == Other.PressureResidualTarget
+		&& Config.VelocityPrecision == Other.VelocityPrecision
+		&& Config.FluidPrecision == Other.FluidPrecision
+		&& Config.PressurePrecision == Other.PressurePrecision
+		&& Config.DivergencePrecision == Other.DivergencePrecision
+		&& Config.FluidStorageRange == Other.FluidStorageRange
+		&& Config.FluidDissipation == Other.FluidDissipation
+		&& Config.FluidDecay == Other.FluidDecay
+		&& Config.Dissipation == Other.Dissipation
+		&& Config.Buoyancy == Other.Buoyancy
+		&& Config.DensityWeight == Other.DensityWeight
+		&& Config.AmbientTemperature == Other.AmbientTemperature
+		&& Config.ReactionAmount == Other.ReactionAmount
+		&& Config.VaporCooling == Other.VaporCooling
+		&& Config.VaporExtinguish == Other.VaporExtinguish
+		&& Config.ReactionExtinguish == Other.ReactionExtinguish
+		&& Config.TemperatureDistribution == Other.TemperatureDistribution
+		&& Config.VorticityStrength == Other.VorticityStrength;
+}
+
+int32 FFireSimulationAtlas::AllocateSlot()
+{
+	check(IsInGameThread());
+	// lowest free slot first, this keeps the dispatched part of the atlas small
+	return UsedSlots.FindAndSetFirstZeroBit();
+}
+
+void FFireSimulationAtlas::ReleaseSlot(int32 Slot)
+{
+	check(IsInGameThread());
+	UsedSlots[Slot] = false;
+}
+
+FIntVector FFireSimulationAtlas::GetSlotCoord(int32 Slot) const
+{
+	return FIntVector(Slot % Slots.X, (Slot / Slots.X) % Slots.Y, Slot / (Slots.X * Slots.Y));
+}
+
+void FFireSimulationAtlas::AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, TConstArrayView<FFireSimulationBrick> Bricks)
+{
+	check(IsInRenderingThread());
+	RDG_EVENT_SCOPE(GraphBuilder, "FireSimulationAtlas %d Bricks", Bricks.Num());
+
+	const int32 FluidSlotSize = SlotSize * Config.FluidResolutionScale;
+
+	TArray<FFireBrickDesc> Descs;
+	Descs.SetNum(Slots.X * Slots.Y * Slots.Z);
+	TArray<FFireBrickDesc> ResetDescs;
+
+	int32 MaxSlotZ = 0;
+	for (const FFireSimulationBrick& Brick : Bricks)
+	{
+		const FIntVector SlotCoord = GetSlotCoord(Brick.Slot);
+		const FIntVector FluidResolution = Brick.VelocityResolution * Config.FluidResolutionScale;
+
+		FFireBrickDesc& Desc = Descs[Brick.Slot];
+		Desc.VelocityOffset = SlotCoord * SlotSize;
+		Desc.VelocityBounds = Brick.VelocityResolution - FIntVector(1);
+		Desc.FluidOffset = SlotCoord * FluidSlotSize;
+		Desc.FluidBounds = FluidResolution - FIntVector(1);
+		Desc.WorldToGrid = Brick.WorldToGrid;
+		Desc.TScale = Brick.TScale;
+
+		if (Brick.bReset)
+		{
+			if (ResetDescs.IsEmpty())
+			{
+				ResetDescs.SetNum(Descs.Num());
+			}
+			ResetDescs[Brick.Slot] = Desc;
+		}
+		MaxSlotZ = FMath::Max(MaxSlotZ, SlotCoord.Z);
+	}
+
+	// only dispatch the slot layers that hold bricks
+	const FIntVector VelocityExtent = Slots * SlotSize;
+	const FIntVector FluidExtent = Slots * FluidSlotSize;
+
+	FFireSimulationAtlasBinding Binding;
+	Binding.Slots = Slots;
+	Binding.SlotSize = SlotSize;
+	Binding.FluidSlotSize = FluidSlotSize;
+	Binding.VelocityGroupCount = FComputeShaderUtils::GetGroupCount(FIntVector(VelocityExtent.X, VelocityExtent.Y, (MaxSlotZ + 1) * SlotSize), THREAD_COUNT);
+	Binding.FluidGroupCount = FComputeShaderUtils::GetGroupCount(FIntVector(FluidExtent.X, FluidExtent.Y, (MaxSlotZ + 1) * FluidSlotSize), THREAD_COUNT);
+
+	if (!ResetDescs.IsEmpty())
+	{
+		FRDGBufferRef ResetBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.ResetBricks"), ResetDescs);
+		Binding.ResetBricks = GraphBuilder.CreateSRV(ResetBuffer);
+	}
+
+	FRDGBufferRef BrickBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.Bricks"), Descs);
+	Binding.Bricks = GraphBuilder.CreateSRV(BrickBuffer);
+
+	Context.AddPasses(GraphBuilder, TimeStep, Config, &Binding);
+}
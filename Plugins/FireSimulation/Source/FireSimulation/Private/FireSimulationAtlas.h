@@ -0,0 +1,70 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationConfig.h"
+#include "FireSimulationContext.h"
+
+/** Placement of one volume inside an atlas, layout matches FBrickDesc in FireSimulation.usf */
+struct FFireBrickDesc
+{
+	FIntVector3 VelocityOffset = FIntVector3::ZeroValue;
+	FIntVector3 VelocityBounds = FIntVector3(-1, -1, -1);
+	FIntVector3 FluidOffset = FIntVector3::ZeroValue;
+	FIntVector3 FluidBounds = FIntVector3(-1, -1, -1);
+	FVector3f WorldToGrid = FVector3f::ZeroVector;
+	FVector2f TScale = FVector2f::ZeroVector;
+	FVector3f Padding = FVector3f::ZeroVector;
+};
+static_assert(sizeof(FFireBrickDesc) == 80, "FFireBrickDesc has to match FBrickDesc in FireSimulation.usf");
+
+/** A volume that is stepped inside an atlas this frame */
+struct FFireSimulationBrick
+{
+	int32 Slot = INDEX_NONE;
+	FIntVector VelocityResolution = FIntVector::ZeroValue;
+	FVector3f WorldToGrid = FVector3f::ZeroVector;
+	FVector2f TScale = FVector2f::ZeroVector;
+	bool bReset = false;
+};
+
+/**
+ * Packs small volumes that share the same simulation parameters into shared 3D textures, one fixed size slot per volume.
+ * Every simulation stage then runs as a single dispatch over all volumes of the atlas.
+ * Slots are managed on the game thread, AddPasses is called on the rendering thread.
+ */
+class FFireSimulationAtlas
+{
+public:
+	/** Slot size in velocity cells, volumes up to this resolution on every axis can live in an atlas */
+	static constexpr int32 SlotSize = 32;
+
+	static bool CanHold(const FIntVector& VelocityResolution);
+
+	explicit FFireSimulationAtlas(const FFireSimulationConfig& InConfig);
+
+	bool IsCompatible(const FFireSimulationConfig& Other) const;
+	int32 AllocateSlot();
+	void ReleaseSlot(int32 Slot);
+
+	void AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, TConstArrayView<FFireSimulationBrick> Bricks);
+
+	int32 GetNumSlots() const { return UsedSlots.Num(); }
+	int32 GetNumUsedSlots() const { return UsedSlots.CountSetBits(); }
+	const FIntVector& GetVelocityResolution() const { return Context.GetVelocityResolution(); }
+	/** Memory of the shared textures, any thread */
+	uint64 GetPlannedBytes() const { return Context.GetPlannedBytes(); }
+	/** Context that holds the textures of all slots, rendering thread only */
+	const FFireSimulationContext& GetContext() const { return Context; }
+
+private:
+	FIntVector GetSlotCoord(int32 Slot) const;
+
+	FFireSimulationConfig Config;
+	FIntVector Slots;
+	TBitArray<> UsedSlots;
+	FFireSimulationContext Context;
+};
+
+using FFireSimulationAtlasPtr = TSharedPtr<FFireSimulationAtlas, ESPMode::ThreadSafe>;
@@ -0,0 +1,225 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationBenchmarkCommandlet.h"
+
+#include "Dom/JsonObject.h"
+#include "FireSimulation.h"
+#include "FireSimulationCpuContext.h"
+#include "FireSimulationEmitterBatch.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace FireBenchmark
+{
+	/** Fixed step so that runs of different commits simulate the same thing */
+	static constexpr float TimeStep = 1.0f / 60.0f;
+	static constexpr int32 NumEmitters = 3;
+
+	static TArray<float> ParseList(const TMap<FString, FString>& Params, const TCHAR* Key, const TArray<float>& Default)
+	{
+		const FString* Value = Params.Find(Key);
+		if (!Value)
+		{
+			return Default;
+		}
+
+		TArray<FString> Items;
+		Value->ParseIntoArray(Items, TEXT(","));
+		TArray<float> Result;
+		for (const FString& Item : Items)
+		{
+			Result.Add(FCString::Atof(*Item));
+		}
+		return Result.IsEmpty() ? Default : Result;
+	}
+
+	static int32 ParseInt(const TMap<FString, FString>& Params, const TCHAR* Key, int32 Default)
+	{
+		const FString* Value = Params.Find(Key);
+		return Value ? FCString::Atoi(**Value) : Default;
+	}
+
+	/** Milliseconds rounded to microseconds, keeps the JSON stable for diffs */
+	static double ToMilliseconds(double Seconds)
+	{
+		return FMath::RoundToDouble(Seconds * 1000000.0) / 1000.0;
+	}
+
+	static TSharedRef<FJsonValue> MakeVectorValue(const FIntVector& Vector)
+	{
+		return MakeShared<FJsonValueArray>(TArray<TSharedPtr<FJsonValue>>{
+			MakeShared<FJsonValueNumber>(Vector.X), MakeShared<FJsonValueNumber>(Vector.Y), MakeShared<FJsonValueNumber>(Vector.Z) });
+	}
+
+	/**
+	 * Fires in the lower half of a volume centered at the origin, placed by Seed. An empty volume would measure the stages on
+	 * zeros, the emitters keep fire, smoke and flow in the grid through the warm up and the measured steps.
+	 */
+	static FFireEmitterBatch MakeEmitters(float VolumeSize, int32 Seed)
+	{
+		FRandomStream Random(Seed);
+		FFireEmitterBatch Batch;
+		Batch.GridOrigin = FVector(-0.5 * VolumeSize);
+		for (int32 Index = 0; Index < NumEmitters; ++Index)
+		{
+			FFireEmitter Emitter;
+			Emitter.Shape = EFireEmitterShape::Sphere;
+			Emitter.Location = FVector(Random.FRandRange(-0.3f, 0.3f), Random.FRandRange(-0.3f, 0.3f), Random.FRandRange(-0.4f, -0.2f)) * VolumeSize;
+			Emitter.Radius = Random.FRandRange(0.04f, 0.08f) * VolumeSize;
+			Emitter.Heat = Random.FRandRange(2000.0f, 4000.0f);
+			Emitter.Reaction = Random.FRandRange(5.0f, 10.0f);
+			Batch.Emitters.Add(FireSimulationEmitters::Scale(Emitter, TimeStep));
+		}
+		return Batch;
+	}
+
+	static TSharedRef<FJsonObject> Run(const FFireSimulationConfig& Config, float VolumeSize, int32 Seed, int32 WarmUpSteps, int32 Steps)
+	{
+		FFireSimulationCpuContext Context;
+		Context.Initialize(FVector(VolumeSize), Config);
+
+		const FFireEmitterBatch Emitters = MakeEmitters(VolumeSize, Seed);
+		for (int32 Step = 0; Step < WarmUpSteps; ++Step)
+		{
+			Context.SetEmitters(Emitters);
+			Context.Step(TimeStep, Config);
+		}
+
+		double StageSeconds[int32(EFireCpuStage::Num)] = {};
+		double TotalSeconds = 0.0;
+		double MinStepSeconds = UE_BIG_NUMBER;
+		for (int32 Step = 0; Step < Steps; ++Step)
+		{
+			Context.SetEmitters(Emitters);
+			const double StartTime = FPlatformTime::Seconds();
+			Context.Step(TimeStep, Config);
+			const double StepSeconds = FPlatformTime::Seconds() - StartTime;
+
+			TotalSeconds += StepSeconds;
+			MinStepSeconds = FMath::Min(MinStepSeconds, StepSeconds);
+			for (int32 Stage = 0; Stage < int32(EFireCpuStage::Num); ++Stage)
+			{
+				StageSeconds[Stage] += Context.GetStageSeconds(EFireCpuStage(Stage));
+			}
+		}
+
+		const FIntVector VelocityResolution = Context.GetVelocityResolution();
+		const FIntVector FluidResolution = Context.GetFluidResolution();
+		const double NumVelocityCells = double(VelocityResolution.X) * VelocityResolution.Y * VelocityResolution.Z;
+		const double NumFluidCells = double(FluidResolution.X) * FluidResolution.Y * FluidResolution.Z;
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetNumberField(TEXT("VolumeSize"), VolumeSize);
+		Result->SetNumberField(TEXT("CellSize"), Config.CellSize);
+		Result->SetNumberField(TEXT("MaxResolution"), Config.MaxResolution);
+		Result->SetNumberField(TEXT("FluidResolutionScale"), Config.FluidResolutionScale);
+		Result->SetNumberField(TEXT("NumPressureIterations"), Config.NumPressureIterations);
+		Result->SetField(TEXT("VelocityResolution"), MakeVectorValue(VelocityResolution));
+		Result->SetField(TEXT("FluidResolution"), MakeVectorValue(FluidResolution));
+
+		const double MeanStepSeconds = TotalSeconds / FMath::Max(Steps, 1);
+		Result->SetNumberField(TEXT("StepMs"), ToMilliseconds(MeanStepSeconds));
+		Result->SetNumberField(TEXT("MinStepMs"), ToMilliseconds(Steps > 0 ? MinStepSeconds : 0.0));
+
+		TSharedRef<FJsonObject> Stages = MakeShared<FJsonObject>();
+		for (int32 Stage = 0; Stage < int32(EFireCpuStage::Num); ++Stage)
+		{
+			Stages->SetNumberField(FFireSimulationCpuContext::GetStageName(EFireCpuStage(Stage)), ToMilliseconds(StageSeconds[Stage] / FMath::Max(Steps, 1)));
+		}
+		Result->SetObjectField(TEXT("StageMs"), Stages);
+
+		Result->SetNumberField(TEXT("VelocityCellsPerSecond"), MeanStepSeconds > 0.0 ? FMath::RoundToDouble(NumVelocityCells / MeanStepSeconds) : 0.0);
+		Result->SetNumberField(TEXT("FluidCellsPerSecond"), MeanStepSeconds > 0.0 ? FMath::RoundToDouble(NumFluidCells / MeanStepSeconds) : 0.0);
+		Result->SetNumberField(TEXT("MemoryBytes"), double(Context.GetAllocatedBytes()));
+
+		UE_LOG(LogFireSimulation, Display, TEXT("Benchmark %dx%dx%d (fluid x%d, %d pressure iterations): %.3f ms per step, %.1f M velocity cells/s"),
+			VelocityResolution.X, VelocityResolution.Y, VelocityResolution.Z, Config.FluidResolutionScale, Config.NumPressureIterations,
+			MeanStepSeconds * 1000.0, MeanStepSeconds > 0.0 ? NumVelocityCells / MeanStepSeconds / 1000000.0 : 0.0);
+		return Result;
+	}
+}
+
+UFireSimulationBenchmarkCommandlet::UFireSimulationBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UFireSimulationBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace FireBenchmark;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamMap);
+
+	const FFireSimulationConfig DefaultConfig;
+	const TArray<float> VolumeSizes = ParseList(ParamMap, TEXT("VolumeSize"), { 1000.0f });
+	// 32^3 and 64^3 grids for the default volume
+	const TArray<float> CellSizes = ParseList(ParamMap, TEXT("CellSize"), { 31.25f, 15.625f });
+	const TArray<float> MaxResolutions = ParseList(ParamMap, TEXT("MaxResolution"), { float(DefaultConfig.MaxResolution) });
+	const TArray<float> FluidScales = ParseList(ParamMap, TEXT("FluidResolutionScale"), { float(DefaultConfig.FluidResolutionScale) });
+	const TArray<float> PressureIterations = ParseList(ParamMap, TEXT("NumPressureIterations"), { float(DefaultConfig.NumPressureIterations) });
+	const int32 WarmUpSteps = FMath::Max(ParseInt(ParamMap, TEXT("WarmUpSteps"), 5), 0);
+	const int32 Steps = FMath::Max(ParseInt(ParamMap, TEXT("Steps"), 20), 1);
+	const int32 Seed = ParseInt(ParamMap, TEXT("Seed"), 1);
+
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("FireSimulation"), TEXT("Benchmark.json"));
+	if (const FString* Output = ParamMap.Find(TEXT("Output")))
+	{
+		OutputPath = *Output;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Results;
+	for (const float VolumeSize : VolumeSizes)
+	{
+		for (const float CellSize : CellSizes)
+		{
+			for (const float MaxResolution : MaxResolutions)
+			{
+				for (const float FluidScale : FluidScales)
+				{
+					for (const float Iterations : PressureIterations)
+					{
+						FFireSimulationConfig Config = DefaultConfig;
+						Config.CellSize = CellSize;
+						Config.MaxResolution = FMath::RoundToInt32(MaxResolution);
+						Config.FluidResolutionScale = FMath::Max(FMath::RoundToInt32(FluidScale), 1);
+						Config.NumPressureIterations = FMath::Max(FMath::RoundToInt32(Iterations), 0);
+						Results.Add(MakeShared<FJsonValueObject>(Run(Config, VolumeSize, Seed, WarmUpSteps, Steps)));
+					}
+				}
+			}
+		}
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	// the GPU path needs a scene and the rendering thread, only FFireSimulationCpuContext is measured
+	Root->SetStringField(TEXT("Backend"), TEXT("Cpu"));
+	Root->SetStringField(TEXT("EngineVersion"), FEngineVersion::Current().ToString());
+	Root->SetStringField(TEXT("Cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	Root->SetNumberField(TEXT("Cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Root->SetNumberField(TEXT("TimeStep"), TimeStep);
+	Root->SetNumberField(TEXT("WarmUpSteps"), WarmUpSteps);
+	Root->SetNumberField(TEXT("Steps"), Steps);
+	Root->SetNumberField(TEXT("Seed"), Seed);
+	Root->SetNumberField(TEXT("Emitters"), NumEmitters);
+	Root->SetArrayField(TEXT("Results"), Results);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogFireSimulation, Error, TEXT("Failed to write the benchmark results to %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogFireSimulation, Display, TEXT("Wrote %d CPU backend benchmark results with seed %d to %s"), Results.Num(), Seed, *OutputPath);
+	return 0;
+}
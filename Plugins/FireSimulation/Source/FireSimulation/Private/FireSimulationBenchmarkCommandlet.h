@@ -0,0 +1,28 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FireSimulationBenchmarkCommandlet.generated.h"
+
+/**
+ * Steps procedurally created volumes over a sweep of configurations and writes the timings as JSON. Only the CPU backend is
+ * measured, GPU timings come from r.FireSimulation.Profile in a running game.
+ * Runs without a map or GPU, e.g. UnrealEditor-Cmd <Project> -run=FireSimulationBenchmark -nullrhi -unattended
+ *
+ * Every sweep parameter takes a comma separated list, all combinations are measured in a fixed order:
+ * -VolumeSize= -CellSize= -MaxResolution= -FluidResolutionScale= -NumPressureIterations=
+ * -WarmUpSteps= and -Steps= set the steps per configuration, -Output= the JSON file. Every volume burns from emitters placed
+ * by -Seed= (1), which the JSON records.
+ */
+UCLASS()
+class UFireSimulationBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UFireSimulationBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,124 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationCascade.h"
+
+#include "FireShaderKernels.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+
+static const FIntVector3 THREAD_COUNT = { 8, 8, 8 };
+
+/**
+ * Copies velocity and fluid from Src into Dst, two nested levels. Without bRestrict Dst is the finer level and only its shell
+ * is written, with it Dst is the coarser level and takes the average of the interior of Src. Skipped before both levels stepped.
+ */
+static void AddExchangePasses(FRDGBuilder& GraphBuilder, const FFireSimulationContext& Dst, const FFireSimulationContext& Src, bool bRestrict)
+{
+	const TRefCountPtr<IPooledRenderTarget> Textures[2][2] = {
+		{ Dst.GetVelocityState(), Src.GetVelocityState() },
+		{ Dst.GetFluidState(), Src.GetFluidState() } };
+	if (!Textures[0][0].IsValid() || !Textures[0][1].IsValid())
+	{
+		return;
+	}
+
+	// cells of Dst measured in cells of Src, the grid cells of both levels are in their own cells
+	const float Scale = Src.GetWorldToGrid().X / Dst.GetWorldToGrid().X;
+	const int32 FluidResolutionScale = FMath::RoundToInt32(Dst.GetTScale().X);
+	for (int32 Field = 0; Field < 2; ++Field)
+	{
+		const int32 CellScale = Field == 0 ? 1 : FluidResolutionScale;
+		const FIntVector DstResolution = Dst.GetVelocityResolution() * CellScale;
+
+		FFireShaderCascadeExchangeCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderCascadeExchangeCS::FParameters>();
+		Params->CascadeDstBounds = DstResolution - FIntVector(1);
+		Params->CascadeDstScroll = Dst.GetVelocityScroll() * CellScale;
+		Params->CascadeSrcBounds = Src.GetVelocityResolution() * CellScale - FIntVector(1);
+		Params->CascadeSrcScroll = Src.GetVelocityScroll() * CellScale;
+		Params->CascadeScale = Scale;
+		Params->CascadeOffset = FVector3f(Dst.GetGridCell() * CellScale) * Scale - FVector3f(Src.GetGridCell() * CellScale);
+		Params->CascadeBorder = FFireSimulationCascade::ExchangeBorder * CellScale;
+		Params->CascadeRestrict = bRestrict ? 1 : 0;
+		Params->cascadeIn = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalTexture(Textures[Field][1]));
+		Params->outputFloat4 = GraphBuilder.CreateUAV(GraphBuilder.RegisterExternalTexture(Textures[Field][0]));
+
+		const auto GroupCount = FComputeShaderUtils::GetGroupCount(DstResolution, THREAD_COUNT);
+		TShaderMapRef<FFireShaderCascadeExchangeCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Cascade %s %s", bRestrict ? TEXT("Restrict") : TEXT("Boundary"), Field == 0 ? TEXT("Velocity") : TEXT("Fluid")),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+}
+
+FFireSimulationCascade::FFireSimulationCascade(const FFireSimulationContext& FineContext, const FFireSimulationConfig& Config)
+{
+	const FFireSimulationContext* Finer = &FineContext;
+	for (int32 Level = 1; Level < FMath::Clamp(Config.NumCascadeLevels, 1, MaxLevels); ++Level)
+	{
+		FLevel& NewLevel = Levels.AddDefaulted_GetRef();
+		NewLevel.Context = MakeUnique<FFireSimulationContext>();
+		NewLevel.Context->InitializeCoarser(*Finer, Config);
+		Finer = NewLevel.Context.Get();
+	}
+}
+
+uint64 FFireSimulationCascade::GetPlannedBytes() const
+{
+	uint64 Bytes = 0;
+	for (const FLevel& Level : Levels)
+	{
+		Bytes += Level.Context->GetPlannedBytes();
+	}
+	return Bytes;
+}
+
+void FFireSimulationCascade::AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, FFireSimulationContext& FineContext, const FVector& Location)
+{
+	check(IsInRenderingThread());
+	RDG_EVENT_SCOPE(GraphBuilder, "FireSimulation Cascade");
+
+	++StepCount;
+	uint32 SteppedLevels = 1;
+	for (int32 Index = Levels.Num() - 1; Index >= 0; --Index)
+	{
+		FLevel& Level = Levels[Index];
+		Level.PendingTime += TimeStep;
+		Level.Context->AddScrollPasses(GraphBuilder, Level.Context->ComputeGridCell(Location));
+
+		// level N steps on the steps of level 0 that are an odd multiple of 2^(N-1)
+		const uint32 Period = 1u << (Index + 1);
+		if ((StepCount + Period / 2) % Period != 0)
+		{
+			continue;
+		}
+		if (Index + 1 < Levels.Num())
+		{
+			AddExchangePasses(GraphBuilder, *Level.Context, *Levels[Index + 1].Context, false);
+		}
+		Level.Context->AddPasses(GraphBuilder, Level.PendingTime, Config);
+		Level.PendingTime = 0.0f;
+		SteppedLevels |= 1u << (Index + 1);
+	}
+
+	if (!Levels.IsEmpty())
+	{
+		AddExchangePasses(GraphBuilder, FineContext, *Levels[0].Context, false);
+	}
+	FineContext.AddPasses(GraphBuilder, TimeStep, Config);
+
+	// every stepped level hands its interior to the level around it, finest first so that detail travels outwards
+	const FFireSimulationContext* Finer = &FineContext;
+	for (int32 Index = 0; Index < Levels.Num(); ++Index)
+	{
+		if (SteppedLevels & (1u << Index))
+		{
+			AddExchangePasses(GraphBuilder, *Levels[Index].Context, *Finer, true);
+		}
+		Finer = Levels[Index].Context.Get();
+	}
+}
@@ -0,0 +1,49 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationConfig.h"
+#include "FireSimulationContext.h"
+
+/**
+ * Nested scrolling grids around a focus point for domains larger than one grid, see FFireSimulationConfig::NumCascadeLevels.
+ * Level 0 is the context of the volume, the cascade owns the coarser levels. Every level has the resolution of level 0 at twice
+ * the cell size of the level inside it, so the cost grows with the number of levels and not with the covered volume.
+ * Created on the game thread, AddPasses is called on the rendering thread.
+ */
+class FFireSimulationCascade
+{
+public:
+	static constexpr int32 MaxLevels = 4;
+	/** Velocity cells of the shell of a finer level that take the coarser level, the rest of it is restricted back */
+	static constexpr int32 ExchangeBorder = 2;
+
+	FFireSimulationCascade(const FFireSimulationContext& FineContext, const FFireSimulationConfig& Config);
+
+	/**
+	 * Scrolls the coarser levels to Location and records one step of level 0, after stepping the coarser levels that are
+	 * due. Level N steps every 2^N steps of level 0, staggered so that at most one coarser level steps at a time.
+	 * The shell of every stepped level takes the coarser level around it, its interior is then restricted into it.
+	 */
+	void AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, FFireSimulationContext& FineContext, const FVector& Location);
+
+	/** Levels including level 0 */
+	int32 GetNumLevels() const { return Levels.Num() + 1; }
+	/** Memory of the coarser levels, any thread */
+	uint64 GetPlannedBytes() const;
+
+private:
+	struct FLevel
+	{
+		TUniquePtr<FFireSimulationContext> Context;
+		/** Time since the last step of the level */
+		float PendingTime = 0.0f;
+	};
+
+	/** Levels 1 to N, each twice the size of the previous one */
+	TArray<FLevel, TInlineAllocator<MaxLevels - 1>> Levels;
+	uint32 StepCount = 0;
+};
+
+using FFireSimulationCascadePtr = TSharedPtr<FFireSimulationCascade, ESPMode::ThreadSafe>;
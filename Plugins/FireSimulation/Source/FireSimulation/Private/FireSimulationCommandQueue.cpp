@@ -0,0 +1,214 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationCommandQueue.h"
+
+#include "FireSimulation.h"
+#include "FireSimulationCommands.h"
+#include "FireSimulationDynamicObstacles.h"
+#include "FireSimulationEmitterBatch.h"
+#include "FireSimulationProfiling.h"
+
+static int32 GFireSimulationCommandQueueSize = 1024;
+static FAutoConsoleVariableRef CVarFireSimulationCommandQueueSize(
+	TEXT("r.FireSimulation.CommandQueueSize"),
+	GFireSimulationCommandQueueSize,
+	TEXT("Commands a fire volume holds between two of its steps, rounded up to a power of two. Further commands are dropped.\n")
+	TEXT("Applies to volumes that begin play after the change."),
+	ECVF_Default);
+
+FFireSimulationCommandQueue::FFireSimulationCommandQueue(int32 InCapacity)
+{
+	const uint32 Capacity = FMath::RoundUpToPowerOfTwo(uint32(FMath::Max(InCapacity > 0 ? InCapacity : GFireSimulationCommandQueueSize, 2)));
+	Slots = MakeUnique<FSlot[]>(Capacity);
+	for (uint32 Index = 0; Index < Capacity; ++Index)
+	{
+		Slots[Index].Sequence.store(Index, std::memory_order_relaxed);
+	}
+	Mask = Capacity - 1;
+}
+
+FFireSimulationCommandQueue::~FFireSimulationCommandQueue()
+{
+	delete PendingConfig.exchange(nullptr);
+}
+
+bool FFireSimulationCommandQueue::Enqueue(const FFireSimulationCommand& Command)
+{
+	// a producer claims a position by advancing the head, the slot is free once the consumer released it one lap earlier
+	uint32 Position = Head.load(std::memory_order_relaxed);
+	FSlot* Slot = nullptr;
+	for (;;)
+	{
+		Slot = &Slots[Position & Mask];
+		const int32 Lag = int32(Slot->Sequence.load(std::memory_order_acquire) - Position);
+		if (Lag == 0)
+		{
+			if (Head.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (Lag < 0)
+		{
+			NumDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			Position = Head.load(std::memory_order_relaxed);
+		}
+	}
+
+	Slot->Command = Command;
+	Slot->Sequence.store(Position + 1, std::memory_order_release);
+	return true;
+}
+
+bool FFireSimulationCommandQueue::SubmitEmitter(const FFireEmitter& Emitter, float DeltaSeconds)
+{
+	return Enqueue(FFireSimulationCommand(TInPlaceType<FFireEmitter>(), FireSimulationEmitters::Scale(Emitter, DeltaSeconds)));
+}
+
+bool FFireSimulationCommandQueue::SubmitImpulse(const FFireImpulse& Impulse)
+{
+	return Enqueue(FFireSimulationCommand(TInPlaceType<FFireImpulse>(), Impulse));
+}
+
+bool FFireSimulationCommandQueue::SubmitObstacle(const FFireObstacle& Obstacle)
+{
+	return Enqueue(FFireSimulationCommand(TInPlaceType<FFireObstacle>(), Obstacle));
+}
+
+void FFireSimulationCommandQueue::SubmitConfig(const FFireSimulationConfig& Config)
+{
+	// a config the rendering thread has not received yet is replaced
+	delete PendingConfig.exchange(new FFireSimulationConfig(Config), std::memory_order_acq_rel);
+}
+
+bool FFireSimulationCommandQueue::Dequeue(FFireSimulationCommand& OutCommand)
+{
+	check(IsInRenderingThread());
+	FSlot& Slot = Slots[Tail & Mask];
+	if (int32(Slot.Sequence.load(std::memory_order_acquire) - (Tail + 1)) < 0)
+	{
+		return false;
+	}
+
+	OutCommand = MoveTemp(Slot.Command);
+	Slot.Sequence.store(Tail + Mask + 1, std::memory_order_release);
+	++Tail;
+	return true;
+}
+
+const FFireSimulationConfig* FFireSimulationCommandQueue::ReceiveConfig()
+{
+	check(IsInRenderingThread());
+	if (FFireSimulationConfig* Config = PendingConfig.exchange(nullptr, std::memory_order_acq_rel))
+	{
+		ReceivedConfig.Reset(Config);
+	}
+	return ReceivedConfig.Get();
+}
+
+uint32 FFireSimulationCommandQueue::ConsumeNumDropped()
+{
+	return NumDropped.exchange(0, std::memory_order_relaxed);
+}
+
+namespace FireSimulationCommands
+{
+	/** Merges B into A within the sphere around both, the velocity integrated over the spheres is kept */
+	static void Merge(FFireImpulse& A, const FFireImpulse& B)
+	{
+		const FVector Delta = B.Location - A.Location;
+		const double Distance = Delta.Size();
+		const double VolumeA = FMath::Cube(double(A.Radius));
+		const double VolumeB = FMath::Cube(double(B.Radius));
+		if (Distance + B.Radius > A.Radius)
+		{
+			if (Distance + A.Radius <= B.Radius)
+			{
+				A.Location = B.Location;
+				A.Radius = B.Radius;
+			}
+			else
+			{
+				const double Radius = 0.5 * (Distance + A.Radius + B.Radius);
+				A.Location += Delta * ((Radius - A.Radius) / Distance);
+				A.Radius = float(Radius);
+			}
+		}
+		A.Velocity = (A.Velocity * VolumeA + B.Velocity * VolumeB) / FMath::Max(FMath::Cube(double(A.Radius)), UE_SMALL_NUMBER);
+	}
+
+	static void AddImpulse(TArray<FFireImpulse>& Impulses, const FFireImpulse& Impulse)
+	{
+		int32 Nearest = INDEX_NONE;
+		double NearestGap = UE_BIG_NUMBER;
+		for (int32 Index = 0; Index < Impulses.Num(); ++Index)
+		{
+			const double Gap = FVector::Dist(Impulses[Index].Location, Impulse.Location) - Impulses[Index].Radius - Impulse.Radius;
+			if (Gap < NearestGap)
+			{
+				Nearest = Index;
+				NearestGap = Gap;
+			}
+		}
+
+		// once the list is full the nearest impulse takes the new one even without overlap
+		if (Nearest != INDEX_NONE && (NearestGap < 0.0 || Impulses.Num() >= MaxImpulses))
+		{
+			Merge(Impulses[Nearest], Impulse);
+		}
+		else
+		{
+			Impulses.Add(Impulse);
+		}
+	}
+
+	static void ApplyConfig(FFireSimulationConfig& Config, const FFireSimulationConfig& Submitted)
+	{
+		// the volume was planned with these at BeginPlay on the game thread
+		FFireSimulationConfig Applied = Submitted;
+		Applied.CellSize = Config.CellSize;
+		Applied.MaxResolution = Config.MaxResolution;
+		Applied.FluidResolutionScale = Config.FluidResolutionScale;
+		Applied.bUseAtlas = Config.bUseAtlas;
+		Applied.bScrolling = Config.bScrolling;
+		Applied.bStaticObstacles = Config.bStaticObstacles;
+		Applied.bDynamicObstacles = Config.bDynamicObstacles;
+		Applied.NumCascadeLevels = Config.NumCascadeLevels;
+		Config = Applied;
+	}
+
+	void Drain(FFireSimulationCommandQueue& Queue, FFireSimulationConfig& Config, FFireEmitterBatch& Emitters, FFireDynamicObstacles* Obstacles, TArray<FFireImpulse>& OutImpulses)
+	{
+		check(IsInRenderingThread());
+
+		if (const FFireSimulationConfig* Submitted = Queue.ReceiveConfig())
+		{
+			ApplyConfig(Config, *Submitted);
+		}
+
+		FFireSimulationCommand Command;
+		while (Queue.Dequeue(Command))
+		{
+			if (const FFireEmitter* Emitter = Command.TryGet<FFireEmitter>())
+			{
+				FireSimulationEmitters::Add(Emitters, *Emitter, 1.0f);
+			}
+			else if (const FFireImpulse* Impulse = Command.TryGet<FFireImpulse>())
+			{
+				AddImpulse(OutImpulses, *Impulse);
+			}
+			else if (const FFireObstacle* Obstacle = Command.TryGet<FFireObstacle>(); Obstacle && Obstacles)
+			{
+				FireSimulationObstacles::Add(*Obstacles, *Obstacle);
+			}
+		}
+
+		const uint32 NumDropped = Queue.ConsumeNumDropped();
+		CSV_CUSTOM_STAT(FireSimulation, DroppedCommands, int32(NumDropped), ECsvCustomStatOp::Accumulate);
+		UE_CLOG(NumDropped > 0, LogFireSimulation, Verbose, TEXT("Fire volume dropped %u commands, see r.FireSimulation.CommandQueueSize"), NumDropped);
+	}
+}
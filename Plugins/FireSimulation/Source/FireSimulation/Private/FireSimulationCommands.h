@@ -0,0 +1,22 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationCommandQueue.h"
+
+struct FFireDynamicObstacles;
+struct FFireEmitterBatch;
+
+namespace FireSimulationCommands
+{
+	/** Impulses a volume applies per step after merging, matches FIRE_MAX_IMPULSES in FireSimulation.usf */
+	static constexpr int32 MaxImpulses = 16;
+
+	/**
+	 * Drains the commands submitted to a volume since its last step into the step. Emitters and obstacles are appended to their
+	 * batches, obstacles are dropped when Obstacles is null. Overlapping impulses are merged into OutImpulses, up to MaxImpulses.
+	 * Config takes the latest submitted config. Rendering thread only.
+	 */
+	void Drain(FFireSimulationCommandQueue& Queue, FFireSimulationConfig& Config, FFireEmitterBatch& Emitters, FFireDynamicObstacles* Obstacles, TArray<FFireImpulse>& OutImpulses);
+}
@@ -0,0 +1,2883 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationContext.h"
+
+#include "FireShaderKernels.h"
+#include "FireSimulation.h"
+#include "FireSimulationCommands.h"
+#include "FireSimulationProfiling.h"
+#include "Math/Float16.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RHIGPUReadback.h"
+#include "SystemTextures.h"
+
+static TAutoConsoleVariable<int32> CVarFireSimulationFusedKernels(
+	TEXT("r.FireSimulation.FusedKernels"),
+	1,
+	TEXT("0: run every simulation stage as its own pass\n")
+	TEXT("1: merge neighboring stages into fused kernels (default)"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationPressureResidual(
+	TEXT("r.FireSimulation.PressureResidual"),
+	0,
+	TEXT("0: off (default)\n")
+	TEXT("1: measure the residual of the pressure solve\n")
+	TEXT("2: measure and log the residual of the pressure solve"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationMemoryBudgetMB(
+	TEXT("r.FireSimulation.MemoryBudgetMB"),
+	1024,
+	TEXT("GPU memory budget of all fire volumes in MB, volumes that begin play afterwards lower their resolution to fit into it.\n")
+	TEXT("0: no budget"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationFieldReadbackInterval(
+	TEXT("r.FireSimulation.FieldReadbackInterval"),
+	4,
+	TEXT("Steps between two readbacks of the field of a standalone fire volume into its CPU copy, see FFireSimulationField.\n")
+	TEXT("0: no readbacks"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationFieldReadbackDownsample(
+	TEXT("r.FireSimulation.FieldReadbackDownsample"),
+	4,
+	TEXT("Velocity cells along each axis that one cell of the CPU copy of a fire volume field covers (1..8)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationLodMinResolution(
+	TEXT("r.FireSimulation.LodMinResolution"),
+	16,
+	TEXT("Largest axis of the coarsest LOD level of a fire volume in velocity cells"),
+	ECVF_Default);
+
+static const FIntVector3 THREAD_COUNT = { 8, 8, 8 };
+
+/** Number of residual, velocity and field readbacks in flight per volume, steps are not measured while all of them are pending */
+static constexpr int32 NumReadbacks = 4;
+/** Coarse levels of the multigrid solver, the coarsest level keeps at least 4 cells per axis */
+static constexpr int32 MaxMultigridLevels = 4;
+static constexpr int32 MultigridCoarsestSweeps = 16;
+
+static constexpr int32 SnapValues[] = { 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 128 };
+static constexpr int32 NumSnapValues = sizeof(SnapValues) / sizeof(int32);
+
+static int32 SetResolution(const float Value, const int32 MaxRes = 0)
+{
+	int32 IntValue = FMath::RoundToInt32(Value);
+	if (IntValue <= SnapValues[0])
+	{
+		IntValue = SnapValues[0];
+	}
+	else if (IntValue >= SnapValues[NumSnapValues-1])
+	{
+		IntValue = SnapValues[NumSnapValues-1];
+	}
+	else
+	{
+		for(int I=1; I < NumSnapValues; ++I)
+		{
+			const int32 DP = IntValue - SnapValues[I-1];
+			if (int32 DN = SnapValues[I] - IntValue; DP >= 0 && DN >= 0)
+			{
+				IntValue = DP < DN ? SnapValues[I-1] : SnapValues[I];
+				break;
+			}
+		}
+	}
+	if (MaxRes > 0)
+	{
+		IntValue = FMath::Min(MaxRes,IntValue);
+	}
+	return IntValue;
+}
+
+static void GetResolution(FVector Size, float GridSize, int MaxRes, FIntVector3& OutResolution)
+{
+	Size /= GridSize;
+	if (Size.X >= Size.Y && Size.X >= Size.Z)
+	{
+		OutResolution.X = SetResolution(Size.X, MaxRes);
+		OutResolution.Y = SetResolution(Size.Y * OutResolution.X / Size.X);
+		OutResolution.Z = SetResolution(Size.Z * OutResolution.X / Size.X);
+	}
+	else if (Size.Y >= Size.X && Size.Y >= Size.Z)
+	{
+		OutResolution.Y = SetResolution(Size.Y, MaxRes);
+		OutResolution.X = SetResolution(Size.X * OutResolution.Y / Size.Y);
+		OutResolution.Z = SetResolution(Size.Z * OutResolution.Y / Size.Y);
+	}
+	else
+	{
+		OutResolution.Z = SetResolution(Size.Z, MaxRes);
+		OutResolution.X = SetResolution(Size.X * OutResolution.Z / Size.Z);
+		OutResolution.Y = SetResolution(Size.Y * OutResolution.Z / Size.Z);
+	}
+}
+
+static uint64 GetNumCells(const FIntVector& Resolution)
+{
+	return uint64(Resolution.X) * Resolution.Y * Resolution.Z;
+}
+
+FFireSimulationContext::FFireSimulationContext() = default;
+FFireSimulationContext::~FFireSimulationContext() = default;
+
+void FFireSimulationContext::FBufferDesc::Init(const FIntVector Res)
+{
+	Resolution = Res;
+	Bounds = FIntVector(Res.X-1, Res.Y-1, Res.Z-1);
+	RcpSize = FVector3f(1.0f/Res.X, 1.0f/Res.Y, 1.0f/Res.Z);
+	ThreadCount = FComputeShaderUtils::GetGroupCount(Res, THREAD_COUNT);
+}
+
+FIntVector FFireSimulationContext::ComputeResolution(const FVector& Size, const FFireSimulationConfig& Config)
+{
+	FIntVector Resolution = FIntVector::ZeroValue;
+	GetResolution(Size, Config.CellSize, Config.MaxResolution, Resolution);
+	return Resolution;
+}
+
+uint64 FFireSimulationContext::EstimateBytes(const FIntVector& Resolution, int32 FluidResolutionScale, const FFireSimulationConfig& Config)
+{
+	FFireSimulationContext Context;
+	Context.InitializeResolution(Resolution, FluidResolutionScale, FVector(Resolution));
+	Context.PlanScratchTextures(MakeLayout(Config, false));
+	return Context.GetPlannedBytes();
+}
+
+uint64 FFireSimulationContext::GetMemoryBudgetBytes()
+{
+	return uint64(FMath::Max(CVarFireSimulationMemoryBudgetMB.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+}
+
+int32 FFireSimulationContext::GetFieldReadbackInterval()
+{
+	return CVarFireSimulationFieldReadbackInterval.GetValueOnAnyThread();
+}
+
+int32 FFireSimulationContext::GetFieldReadbackDownsample()
+{
+	return FMath::Clamp(CVarFireSimulationFieldReadbackDownsample.GetValueOnAnyThread(), 1, 8);
+}
+
+void FFireSimulationContext::Initialize(const FVector& Size, const FFireSimulationConfig& Config, uint64 ReservedBytes)
+{
+	FIntVector Resolution = ComputeResolution(Size, Config);
+	int32 FluidResolutionScale = Config.FluidResolutionScale;
+
+	if (const uint64 Budget = GetMemoryBudgetBytes(); Budget > 0)
+	{
+		const uint64 Available = Budget - FMath::Min(ReservedBytes, Budget);
+		const uint64 RequestedBytes = EstimateBytes(Resolution, FluidResolutionScale, Config);
+		uint64 Bytes = RequestedBytes;
+
+		// the fluid scale multiplies the largest fields by its cube, so it goes first
+		FFireSimulationConfig FittedConfig = Config;
+		while (Bytes > Available)
+		{
+			if (FluidResolutionScale > 1)
+			{
+				--FluidResolutionScale;
+			}
+			else if (Resolution.GetMax() > SnapValues[0])
+			{
+				int32 Snap = 0;
+				while (SnapValues[Snap + 1] < Resolution.GetMax())
+				{
+					++Snap;
+				}
+				FittedConfig.MaxResolution = SnapValues[Snap];
+				Resolution = ComputeResolution(Size, FittedConfig);
+			}
+			else
+			{
+				break;
+			}
+			Bytes = EstimateBytes(Resolution, FluidResolutionScale, Config);
+		}
+
+		if (Bytes != RequestedBytes)
+		{
+			const FIntVector RequestedResolution = ComputeResolution(Size, Config);
+			UE_LOG(LogFireSimulation, Warning, TEXT("Fire volume of size %s needs %.1f MB, %.1f MB of the %.1f MB budget are left: %s %dx%dx%d with fluid resolution scale %d instead of %dx%dx%d with scale %d"),
+				*Size.ToCompactString(), RequestedBytes / (1024.0 * 1024.0), Available / (1024.0 * 1024.0), Budget / (1024.0 * 1024.0),
+				Bytes > Available ? TEXT("over budget at the smallest grid, using") : TEXT("using"),
+				Resolution.X, Resolution.Y, Resolution.Z, FluidResolutionScale,
+				RequestedResolution.X, RequestedResolution.Y, RequestedResolution.Z, Config.FluidResolutionScale);
+		}
+	}
+
+	BaseResolution = Resolution;
+	InitializeResolution(Resolution, FluidResolutionScale, Size);
+	// plan for the configured layout right away, so the planned memory is known before the first step
+	PlanScratchTextures(MakeLayout(Config, false));
+}
+
+void FFireSimulationContext::InitializeCoarser(const FFireSimulationContext& Finer, const FFireSimulationConfig& Config)
+{
+	BaseResolution = Finer.GetVelocityResolution();
+	InitializeResolution(BaseResolution, FMath::RoundToInt32(Finer.GetTScale().X), 2.0 * FVector(Finer.GetLocalSize()));
+	PlanScratchTextures(MakeLayout(Config, false));
+}
+
+void FFireSimulationContext::InitializeResolution(const FIntVector& Resolution, int32 FluidResolutionScale, const FVector& Size)
+{
+	Velocity.Init(Resolution);
+
+	const FIntVector FluidResolution = Resolution * FluidResolutionScale;
+	Fluid.Init(FluidResolution);
+	
+	LocalSize = FVector3f(Size.X, Size.Y, Size.Z);
+	TScale.X = FluidResolutionScale;
+	TScale.Y = 1.0f / FluidResolutionScale;
+
+	WorldToGrid = { Resolution.X / LocalSize.X, Resolution.Y / LocalSize.Y, Resolution.Z / LocalSize.Z };
+
+	FScratchLayout InitialLayout;
+	InitialLayout.bFused = CVarFireSimulationFusedKernels.GetValueOnAnyThread() != 0;
+	PlanScratchTextures(InitialLayout);
+}
+
+int32 FFireSimulationContext::GetNumLodLevels() const
+{
+	const int32 MinResolution = FMath::Max(CVarFireSimulationLodMinResolution.GetValueOnAnyThread(), SnapValues[0]);
+	int32 NumLevels = 1;
+	while ((BaseResolution.GetMax() >> NumLevels) >= MinResolution)
+	{
+		++NumLevels;
+	}
+	return NumLevels;
+}
+
+FIntVector FFireSimulationContext::GetLodResolution(int32 LodLevel, const FFireSimulationConfig& Config) const
+{
+	if (LodLevel <= 0)
+	{
+		return BaseResolution;
+	}
+
+	FFireSimulationConfig LodConfig = Config;
+	LodConfig.MaxResolution = FMath::Max(BaseResolution.GetMax() >> LodLevel, CVarFireSimulationLodMinResolution.GetValueOnAnyThread());
+	return ComputeResolution(FVector(LocalSize), LodConfig);
+}
+
+void FFireSimulationContext::SetAtlasSlot(const TSharedPtr<FFireSimulationAtlas, ESPMode::ThreadSafe>& InAtlas, int32 InSlot)
+{
+	Atlas = InAtlas;
+	AtlasSlot = InSlot;
+	bAtlasReset = Atlas.IsValid();
+}
+
+bool FFireSimulationContext::ConsumeAtlasReset()
+{
+	check(IsInRenderingThread());
+	const bool bReset = bAtlasReset;
+	bAtlasReset = false;
+	return bReset;
+}
+
+static FRDGTextureDesc CreateTextureDesc(FIntVector Res, EPixelFormat Format)
+{
+	constexpr ETextureCreateFlags Flags = ETextureCreateFlags::RenderTargetable | ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV;
+	return FRDGTextureDesc::Create3D(Res, Format, EClearBinding::ENoneBound, Flags);
+}
+
+/** Signed fields can not use a normalized format and store UNorm8 as Half */
+static EPixelFormat GetStorageFormat(EFireStoragePrecision Precision, bool bIsFloat4, bool bSigned)
+{
+	if (Precision == EFireStoragePrecision::Full)
+	{
+		return bIsFloat4 ? PF_A32B32G32R32F : PF_R32_FLOAT;
+	}
+	if (Precision == EFireStoragePrecision::UNorm8 && !bSigned)
+	{
+		return bIsFloat4 ? PF_R8G8B8A8 : PF_G8;
+	}
+	return bIsFloat4 ? PF_FloatRGBA : PF_R16F;
+}
+
+static FFireStorageParameters GetStorageParameters(const FFireSimulationConfig& Config)
+{
+	FFireStorageParameters Parameters;
+	Parameters.FluidStorageScale = FVector4f(1.0f, 1.0f, 1.0f, 1.0f);
+	Parameters.RcpFluidStorageScale = FVector4f(1.0f, 1.0f, 1.0f, 1.0f);
+	if (Config.FluidPrecision == EFireStoragePrecision::UNorm8)
+	{
+		// normalized channels hold [0, FluidStorageRange], larger values saturate
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			const float Range = FMath::Max(Config.FluidStorageRange[Channel], UE_KINDA_SMALL_NUMBER);
+			Parameters.FluidStorageScale[Channel] = 1.0f / Range;
+			Parameters.RcpFluidStorageScale[Channel] = Range;
+		}
+	}
+	return Parameters;
+}
+
+void FFireSimulationContext::FScratchLayout::SetStorage(const FFireSimulationConfig& Config)
+{
+	VelocityFormat = GetStorageFormat(Config.VelocityPrecision, true, true);
+	FluidFormat = GetStorageFormat(Config.FluidPrecision, true, false);
+	PressureFormat = GetStorageFormat(Config.PressurePrecision, false, true);
+	DivergenceFormat = GetStorageFormat(Config.DivergencePrecision, false, true);
+}
+
+FFireSimulationContext::FScratchLayout FFireSimulationContext::MakeLayout(const FFireSimulationConfig& Config, bool bAtlas)
+{
+	FScratchLayout Result;
+	Result.bFused = CVarFireSimulationFusedKernels.GetValueOnAnyThread() != 0;
+	// brick lists and multigrid levels address the textures directly, scrolling grids wrap their addressing
+	Result.bSparse = Config.bSparse && !bAtlas && !Config.bScrolling;
+	// multigrid runs over the whole grid, a sparse step stays with Jacobi
+	Result.bMultigrid = Config.PressureSolver == EFirePressureSolver::Multigrid && !bAtlas && !Result.bSparse && !Config.bScrolling;
+	Result.bWarmStart = Config.bWarmStartPressure;
+	Result.bKeepPreviousFluid = Config.bInterpolateOutput;
+	Result.SetStorage(Config);
+	return Result;
+}
+
+namespace FireStage
+{
+	/** Stages of a simulation step in execution order, the pressure iterations count as one stage */
+	enum Type : int32
+	{
+		PrepareAdvectionFwd,
+		PrepareAdvectionBack,
+		AdvectFluid,
+		AdvectVelocity,
+		Buoyancy,
+		Extinguish,
+		Vorticity,
+		Confinement,
+		Divergence,
+		PreparePressure,
+		Pressure,
+		Projection,
+		Num
+	};
+}
+
+void FFireSimulationContext::PlanScratchTextures(const FScratchLayout& InLayout)
+{
+	using namespace FireStage;
+
+	const FRDGTextureDesc Velocity4Desc = CreateTextureDesc(Velocity.Resolution, InLayout.VelocityFormat);
+	const FRDGTextureDesc PressureDesc = CreateTextureDesc(Velocity.Resolution, InLayout.PressureFormat);
+	const FRDGTextureDesc DivergenceDesc = CreateTextureDesc(Velocity.Resolution, InLayout.DivergenceFormat);
+	const FRDGTextureDesc Fluid4Desc = CreateTextureDesc(Fluid.Resolution, InLayout.FluidFormat);
+
+	ScratchPool.Reset();
+	Scratch = FScratchTextures();
+	Layout = InLayout;
+
+	// state of the previous step, dead once it has been advected. A kept fluid state shares its texture with nothing else,
+	// after the swap at the end of the step the fluid output texture then still holds it.
+	Scratch.VelocityIn = ScratchPool.Declare(TEXT("FireSimulation.Velocity"), Velocity4Desc, PrepareAdvectionFwd, AdvectVelocity);
+	Scratch.FluidIn = ScratchPool.Declare(TEXT("FireSimulation.Fluid"), Fluid4Desc, PrepareAdvectionFwd, InLayout.bKeepPreviousFluid ? Num : AdvectFluid);
+	if (Layout.bWarmStart)
+	{
+		// may be the solution itself when no iteration runs, so it lives until the projection
+		Scratch.PressureState = ScratchPool.Declare(TEXT("FireSimulation.Pressure"), PressureDesc, PrepareAdvectionFwd, Projection);
+	}
+
+	Scratch.Phi[1] = ScratchPool.Declare(TEXT("FireSimulation.Phi1"), Fluid4Desc, PrepareAdvectionFwd, AdvectFluid);
+	Scratch.Phi[0] = ScratchPool.Declare(TEXT("FireSimulation.Phi0"), Fluid4Desc, PrepareAdvectionBack, AdvectFluid);
+
+	if (Layout.bFused)
+	{
+		// advection + extinguish, advection + buoyancy, vorticity + confinement and divergence + pressure preparation
+		// run as single kernels, their intermediate results never reach memory
+		Scratch.TmpFluid4[1] = ScratchPool.Declare(TEXT("FireSimulation.FluidOut"), Fluid4Desc, AdvectFluid, Num);
+
+		Scratch.TmpVelocity4[1] = ScratchPool.Declare(TEXT("FireSimulation.BuoyantVelocity"), Velocity4Desc, AdvectVelocity, Confinement);
+		Scratch.TmpVelocity4[2] = ScratchPool.Declare(TEXT("FireSimulation.ConfinedVelocity"), Velocity4Desc, Confinement, Projection);
+		Scratch.Divergence = ScratchPool.Declare(TEXT("FireSimulation.Divergence"), DivergenceDesc, Divergence, Pressure);
+		Scratch.Pressure[0] = ScratchPool.Declare(TEXT("FireSimulation.Pressure0"), PressureDesc, Divergence, Projection);
+	}
+	else
+	{
+		Scratch.TmpFluid4[0] = ScratchPool.Declare(TEXT("FireSimulation.AdvectedFluid"), Fluid4Desc, AdvectFluid, Extinguish);
+		Scratch.TmpFluid4[1] = ScratchPool.Declare(TEXT("FireSimulation.FluidOut"), Fluid4Desc, Extinguish, Num);
+
+		Scratch.TmpVelocity4[0] = ScratchPool.Declare(TEXT("FireSimulation.AdvectedVelocity"), Velocity4Desc, AdvectVelocity, Buoyancy);
+		Scratch.TmpVelocity4[1] = ScratchPool.Declare(TEXT("FireSimulation.BuoyantVelocity"), Velocity4Desc, Buoyancy, Confinement);
+		Scratch.Vorticity = ScratchPool.Declare(TEXT("FireSimulation.Vorticity"), Velocity4Desc, Vorticity, Confinement);
+		Scratch.TmpVelocity4[2] = ScratchPool.Declare(TEXT("FireSimulation.ConfinedVelocity"), Velocity4Desc, Confinement, Projection);
+		Scratch.Divergence = ScratchPool.Declare(TEXT("FireSimulation.Divergence"), DivergenceDesc, Divergence, Pressure);
+		Scratch.Pressure[0] = ScratchPool.Declare(TEXT("FireSimulation.Pressure0"), PressureDesc, PreparePressure, Projection);
+	}
+	Scratch.Pressure[1] = ScratchPool.Declare(TEXT("FireSimulation.Pressure1"), PressureDesc, Pressure, Projection);
+	Scratch.VelocityOut = ScratchPool.Declare(TEXT("FireSimulation.VelocityOut"), Velocity4Desc, Projection, Num);
+
+	if (Layout.bMultigrid)
+	{
+		Scratch.Residual = ScratchPool.Declare(TEXT("FireSimulation.Residual"), PressureDesc, Pressure, Pressure);
+		Scratch.MultigridObstacles = ScratchPool.Declare(TEXT("FireSimulation.MultigridObstacles"), CreateTextureDesc(Velocity.Resolution, PF_R16F), Pressure, Pressure);
+
+		FIntVector LevelResolution = Velocity.Resolution;
+		while (Scratch.Multigrid.Num() < MaxMultigridLevels && LevelResolution.GetMin() >= 8
+			&& LevelResolution.X % 2 == 0 && LevelResolution.Y % 2 == 0 && LevelResolution.Z % 2 == 0)
+		{
+			LevelResolution /= 2;
+			const FRDGTextureDesc LevelDesc = CreateTextureDesc(LevelResolution, Layout.PressureFormat);
+
+			FScratchTextures::FMultigridLevel& Level = Scratch.Multigrid.AddDefaulted_GetRef();
+			Level.Resolution = LevelResolution;
+			Level.Obstacles = ScratchPool.Declare(TEXT("FireSimulation.MultigridObstacles"), CreateTextureDesc(LevelResolution, PF_R16F), Pressure, Pressure);
+			Level.Rhs = ScratchPool.Declare(TEXT("FireSimulation.MultigridRhs"), LevelDesc, Pressure, Pressure);
+			Level.Pressure[0] = ScratchPool.Declare(TEXT("FireSimulation.MultigridPressure0"), LevelDesc, Pressure, Pressure);
+			Level.Pressure[1] = ScratchPool.Declare(TEXT("FireSimulation.MultigridPressure1"), LevelDesc, Pressure, Pressure);
+		}
+
+		// the coarsest level is only smoothed
+		for (int32 Index = 0; Index < Scratch.Multigrid.Num() - 1; ++Index)
+		{
+			FScratchTextures::FMultigridLevel& Level = Scratch.Multigrid[Index];
+			Level.Residual = ScratchPool.Declare(TEXT("FireSimulation.MultigridResidual"), CreateTextureDesc(Level.Resolution, Layout.PressureFormat), Pressure, Pressure);
+		}
+	}
+
+	// inactive bricks of a sparse grid keep their zeros across steps, so sparse textures can not share memory
+	ScratchPool.Plan(!Layout.bSparse);
+
+	// new textures hold no data, the first step after a plan simulates every brick
+	SparseBrickContent.SafeRelease();
+	SparseBrickState.SafeRelease();
+
+	PlannedBytes.store(ScratchPool.GetPeakBytes() + GetPersistentBytes(), std::memory_order_relaxed);
+
+	UE_LOG(LogFireSimulation, Verbose, TEXT("Scratch plan for %dx%dx%d%s%s%s: %d textures in %d allocations, %.1f MB peak (%.1f MB without aliasing), %.1f bytes per cell"),
+		Velocity.Resolution.X, Velocity.Resolution.Y, Velocity.Resolution.Z, Layout.bFused ? TEXT(" (fused)") : TEXT(""), Layout.bMultigrid ? TEXT(" (multigrid)") : TEXT(""),
+		Layout.bSparse ? TEXT(" (sparse)") : TEXT(""),
+		ScratchPool.GetNumLogical(), ScratchPool.GetNumPhysical(),
+		ScratchPool.GetPeakBytes() / (1024.0 * 1024.0), ScratchPool.GetUnaliasedBytes() / (1024.0 * 1024.0),
+		double(ScratchPool.GetPeakBytes()) / GetNumCells(Velocity.Resolution));
+}
+
+TRefCountPtr<IPooledRenderTarget> FFireSimulationContext::GetFluidState() const
+{
+	check(IsInRenderingThread());
+	return Scratch.FluidIn != INDEX_NONE ? ScratchPool.GetPooledTexture(Scratch.FluidIn) : nullptr;
+}
+
+TRefCountPtr<IPooledRenderTarget> FFireSimulationContext::GetVelocityState() const
+{
+	check(IsInRenderingThread());
+	return Scratch.VelocityIn != INDEX_NONE ? ScratchPool.GetPooledTexture(Scratch.VelocityIn) : nullptr;
+}
+
+TRefCountPtr<IPooledRenderTarget> FFireSimulationContext::GetPreviousFluidState() const
+{
+	check(IsInRenderingThread());
+	// swapped in at the end of the last step, overwritten only once the next step has advected the current state
+	return Layout.bKeepPreviousFluid && Scratch.TmpFluid4[1] != INDEX_NONE ? ScratchPool.GetPooledTexture(Scratch.TmpFluid4[1]) : nullptr;
+}
+
+uint64 FFireSimulationContext::GetPersistentBytes() const
+{
+	const uint64 NumBricks = GetNumCells(Velocity.ThreadCount);
+	uint64 Bytes = GetNumCells(Velocity.Resolution) * GPixelFormats[PF_R16F].BlockBytes;
+	Bytes += NumBricks * (FFireShaderPackObstaclesCS::BrickWords + 1) * sizeof(uint32);
+	if (Layout.bSparse)
+	{
+		Bytes += NumBricks * 2 * sizeof(uint32);
+	}
+	return Bytes;
+}
+
+void FFireSimulationContext::LogStorageReport()
+{
+	// the cost per cell barely depends on the resolution, a fixed grid with the default options stands in for all volumes
+	const FIntVector Resolution(64, 64, 64);
+	const FFireSimulationConfig DefaultConfig;
+	const EFireStoragePrecision Precisions[] = { EFireStoragePrecision::Half, EFireStoragePrecision::Full, EFireStoragePrecision::UNorm8 };
+	const TCHAR* PrecisionNames[] = { TEXT("Half"), TEXT("Full"), TEXT("UNorm8") };
+
+	FScratchLayout ReportLayout;
+	ReportLayout.bFused = CVarFireSimulationFusedKernels.GetValueOnAnyThread() != 0;
+	ReportLayout.bWarmStart = DefaultConfig.bWarmStartPressure;
+
+	UE_LOG(LogFireSimulation, Display, TEXT("Scratch bytes per velocity cell, %dx%dx%d grid, fluid resolution scale %d%s"),
+		Resolution.X, Resolution.Y, Resolution.Z, DefaultConfig.FluidResolutionScale, ReportLayout.bFused ? TEXT(", fused") : TEXT(""));
+	UE_LOG(LogFireSimulation, Display, TEXT("Velocity Fluid  Pressure Divergence   Peak Unaliased"));
+
+	// velocity, pressure and divergence are signed, UNorm8 would repeat the Half rows
+	for (int32 VelocityIndex = 0; VelocityIndex < 2; ++VelocityIndex)
+	{
+		for (int32 FluidIndex = 0; FluidIndex < 3; ++FluidIndex)
+		{
+			for (int32 PressureIndex = 0; PressureIndex < 2; ++PressureIndex)
+			{
+				for (int32 DivergenceIndex = 0; DivergenceIndex < 2; ++DivergenceIndex)
+				{
+					FFireSimulationConfig Config = DefaultConfig;
+					Config.VelocityPrecision = Precisions[VelocityIndex];
+					Config.FluidPrecision = Precisions[FluidIndex];
+					Config.PressurePrecision = Precisions[PressureIndex];
+					Config.DivergencePrecision = Precisions[DivergenceIndex];
+					ReportLayout.SetStorage(Config);
+
+					FFireSimulationContext Context;
+					Context.InitializeResolution(Resolution, DefaultConfig.FluidResolutionScale, FVector(Resolution));
+					Context.PlanScratchTextures(ReportLayout);
+
+					const double NumCells = GetNumCells(Resolution);
+					UE_LOG(LogFireSimulation, Display, TEXT("%-8s %-6s %-8s %-10s %6.1f %9.1f"),
+						PrecisionNames[VelocityIndex], PrecisionNames[FluidIndex], PrecisionNames[PressureIndex], PrecisionNames[DivergenceIndex],
+						Context.ScratchPool.GetPeakBytes() / NumCells, Context.ScratchPool.GetUnaliasedBytes() / NumCells);
+				}
+			}
+		}
+	}
+}
+
+static FAutoConsoleCommand CCmdFireSimulationStorageReport(
+	TEXT("r.FireSimulation.StorageReport"),
+	TEXT("Logs the scratch memory per velocity cell of every combination of storage precisions"),
+	FConsoleCommandDelegate::CreateStatic(&FFireSimulationContext::LogStorageReport));
+
+/** Sampler of the grid kernels, lookups are clamped to the grid in the shader and wrap around the edges of scrolled textures */
+static FRHISamplerState* GetGridSampler()
+{
+	return TStaticSamplerState<SF_Point, AM_Wrap, AM_Wrap, AM_Wrap>::GetRHI();
+}
+
+/** Resamples Source into a new pooled texture of Desc and multiplies it by Scale, null without a source */
+static TRefCountPtr<IPooledRenderTarget> AddResamplePass(FRDGBuilder& GraphBuilder, const TRefCountPtr<IPooledRenderTarget>& Source, const FRDGTextureDesc& Desc, float Scale, const TCHAR* Name)
+{
+	if (!Source.IsValid())
+	{
+		return nullptr;
+	}
+
+	TRefCountPtr<IPooledRenderTarget> Target = GRenderTargetPool.FindFreeElement(Desc, Name);
+	FRDGTextureRef SourceTexture = GraphBuilder.RegisterExternalTexture(Source);
+	FRDGTextureRef TargetTexture = GraphBuilder.RegisterExternalTexture(Target);
+
+	const FIntVector Resolution(Desc.Extent.X, Desc.Extent.Y, Desc.Depth);
+	const auto GroupCount = FComputeShaderUtils::GetGroupCount(Resolution, THREAD_COUNT);
+	if (GPixelFormats[Desc.Format].NumComponents == 4)
+	{
+		FFireShaderResampleCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderResampleCS::FParameters>();
+		Params->ResampleBounds = Resolution - FIntVector(1);
+		Params->ResampleScale = FVector4f(Scale, Scale, Scale, Scale);
+		Params->_LinearClamp = TStaticSamplerState<>::GetRHI();
+		Params->resampleIn = GraphBuilder.CreateSRV(SourceTexture);
+		Params->outputFloat4 = GraphBuilder.CreateUAV(TargetTexture);
+
+		TShaderMapRef<FFireShaderResampleCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Resample %s", Name),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+	else
+	{
+		FFireShaderResampleFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderResampleFloatCS::FParameters>();
+		Params->ResampleBounds = Resolution - FIntVector(1);
+		Params->ResampleScale = FVector4f(Scale, Scale, Scale, Scale);
+		Params->_LinearClamp = TStaticSamplerState<>::GetRHI();
+		Params->resampleFloatIn = GraphBuilder.CreateSRV(SourceTexture);
+		Params->outputFloat = GraphBuilder.CreateUAV(TargetTexture);
+
+		TShaderMapRef<FFireShaderResampleFloatCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Resample %s", Name),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+	return Target;
+}
+
+void FFireSimulationContext::AddResamplePasses(FRDGBuilder& GraphBuilder, const FIntVector& Resolution)
+{
+	check(IsInRenderingThread());
+	check(!Atlas.IsValid());
+	if (Resolution == Velocity.Resolution)
+	{
+		return;
+	}
+
+	RDG_EVENT_SCOPE(GraphBuilder, "FireSimulation Resample %dx%dx%d to %dx%dx%d",
+		Velocity.Resolution.X, Velocity.Resolution.Y, Velocity.Resolution.Z, Resolution.X, Resolution.Y, Resolution.Z);
+	UE_LOG(LogFireSimulation, Verbose, TEXT("Resampling fire volume from %dx%dx%d to %dx%dx%d"),
+		Velocity.Resolution.X, Velocity.Resolution.Y, Velocity.Resolution.Z, Resolution.X, Resolution.Y, Resolution.Z);
+
+	// state of the old grid, null before the first step
+	const TRefCountPtr<IPooledRenderTarget> VelocityState = ScratchPool.GetPooledTexture(Scratch.VelocityIn);
+	const TRefCountPtr<IPooledRenderTarget> FluidState = ScratchPool.GetPooledTexture(Scratch.FluidIn);
+	const TRefCountPtr<IPooledRenderTarget> PressureState = Layout.bWarmStart ? ScratchPool.GetPooledTexture(Scratch.PressureState) : nullptr;
+	const FVector3f OldWorldToGrid = WorldToGrid;
+
+	const int32 FluidResolutionScale = FMath::RoundToInt32(TScale.X);
+	Velocity.Init(Resolution);
+	Fluid.Init(Resolution * FluidResolutionScale);
+	WorldToGrid = { Resolution.X / LocalSize.X, Resolution.Y / LocalSize.Y, Resolution.Z / LocalSize.Z };
+	const FScratchLayout StepLayout = Layout;
+	PlanScratchTextures(StepLayout);
+
+	// velocities are stored in world units and carry over unscaled, pressure is solved in cells and scales with the cell size
+	const float CellScale = (WorldToGrid / OldWorldToGrid).GetAbsMax();
+	ScratchPool.SetPooledTexture(Scratch.VelocityIn, AddResamplePass(GraphBuilder, VelocityState,
+		CreateTextureDesc(Velocity.Resolution, Layout.VelocityFormat), 1.0f, TEXT("FireSimulation.Velocity")));
+	ScratchPool.SetPooledTexture(Scratch.FluidIn, AddResamplePass(GraphBuilder, FluidState,
+		CreateTextureDesc(Fluid.Resolution, Layout.FluidFormat), 1.0f, TEXT("FireSimulation.Fluid")));
+	if (Layout.bWarmStart)
+	{
+		ScratchPool.SetPooledTexture(Scratch.PressureState, AddResamplePass(GraphBuilder, PressureState,
+			CreateTextureDesc(Velocity.Resolution, Layout.PressureFormat), CellScale, TEXT("FireSimulation.Pressure")));
+	}
+
+	// the packed obstacle mask is rebuilt from the resampled obstacles, cells above one half stay solid
+	Obstacles = AddResamplePass(GraphBuilder, Obstacles, CreateTextureDesc(Velocity.Resolution, PF_R16F), 1.0f, TEXT("Obstacles"));
+	ObstacleMask.SafeRelease();
+	ObstacleBricks.SafeRelease();
+	bObstaclesDirty = true;
+
+	// moving bodies are rasterized into the new grid with their next update
+	DynamicObstacles.SafeRelease();
+	DynamicObstacleBricks.Empty();
+	Emitters.SafeRelease();
+	EmitterBricks.Empty();
+
+	// the latest velocity maximum was measured in cells of the old grid
+	MaxCellsPerSecond *= CellScale;
+}
+
+/** Clears the cells of Texture that entered its scrolling grid, skipped before the texture exists */
+static void AddScrollClearPass(FRDGBuilder& GraphBuilder, const TRefCountPtr<IPooledRenderTarget>& Texture, const FIntVector& Resolution, const FIntVector& Offset, const FIntVector& Delta)
+{
+	if (!Texture.IsValid())
+	{
+		return;
+	}
+
+	FRDGTextureRef ScrolledTexture = GraphBuilder.RegisterExternalTexture(Texture);
+	const auto GroupCount = FComputeShaderUtils::GetGroupCount(Resolution, THREAD_COUNT);
+	if (GPixelFormats[ScrolledTexture->Desc.Format].NumComponents == 4)
+	{
+		FFireShaderScrollClearCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderScrollClearCS::FParameters>();
+		Params->ScrollBounds = Resolution - FIntVector(1);
+		Params->ScrollOffset = Offset;
+		Params->ScrollDelta = Delta;
+		Params->outputFloat4 = GraphBuilder.CreateUAV(ScrolledTexture);
+
+		TShaderMapRef<FFireShaderScrollClearCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Scroll Clear %s", ScrolledTexture->Name),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+	else
+	{
+		FFireShaderScrollClearFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderScrollClearFloatCS::FParameters>();
+		Params->ScrollBounds = Resolution - FIntVector(1);
+		Params->ScrollOffset = Offset;
+		Params->ScrollDelta = Delta;
+		Params->outputFloat = GraphBuilder.CreateUAV(ScrolledTexture);
+
+		TShaderMapRef<FFireShaderScrollClearFloatCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Scroll Clear %s", ScrolledTexture->Name),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+}
+
+void FFireSimulationContext::SetDynamicObstacles(const FFireDynamicObstacles& Obstacles)
+{
+	check(IsInRenderingThread());
+	PendingDynamicObstacles = Obstacles;
+	bDynamicObstaclesPending = true;
+}
+
+void FFireSimulationContext::SetEmitters(const FFireEmitterBatch& InEmitters)
+{
+	check(IsInRenderingThread());
+	PendingEmitters = InEmitters;
+}
+
+void FFireSimulationContext::SetImpulses(const TArray<FFireImpulse>& Impulses)
+{
+	check(IsInRenderingThread());
+	PendingImpulses = Impulses;
+}
+
+void FFireSimulationContext::SetStaticObstacles(TArray<uint32>&& Bits, const FIntVector& Resolution)
+{
+	check(IsInRenderingThread());
+	check(Bits.Num() == FMath::DivideAndRoundUp(Resolution.X * Resolution.Y * Resolution.Z, 32));
+	StaticObstacleBits = MoveTemp(Bits);
+	StaticObstacleResolution = Resolution;
+}
+
+FIntVector FFireSimulationContext::ComputeGridCell(const FVector& Location) const
+{
+	const FVector Corner = Location - 0.5 * FVector(LocalSize);
+	return FIntVector(
+		FMath::FloorToInt32(Corner.X * WorldToGrid.X),
+		FMath::FloorToInt32(Corner.Y * WorldToGrid.Y),
+		FMath::FloorToInt32(Corner.Z * WorldToGrid.Z));
+}
+
+void FFireSimulationContext::AddScrollPasses(FRDGBuilder& GraphBuilder, const FIntVector& InGridCell)
+{
+	check(IsInRenderingThread());
+	check(!Atlas.IsValid());
+
+	const FIntVector Delta = InGridCell - GridCell;
+	GridCell = InGridCell;
+	if (!bGridCellValid || Delta == FIntVector::ZeroValue)
+	{
+		bGridCellValid = true;
+		return;
+	}
+
+	// local cell 0 moves to the texel that held the world cell it now covers, the wrapped offsets stay in [0, resolution)
+	const FIntVector& Resolution = Velocity.Resolution;
+	VelocityScroll.X = (VelocityScroll.X + Delta.X % Resolution.X + Resolution.X) % Resolution.X;
+	VelocityScroll.Y = (VelocityScroll.Y + Delta.Y % Resolution.Y + Resolution.Y) % Resolution.Y;
+	VelocityScroll.Z = (VelocityScroll.Z + Delta.Z % Resolution.Z + Resolution.Z) % Resolution.Z;
+
+	RDG_EVENT_SCOPE(GraphBuilder, "FireSimulation Scroll %d %d %d", Delta.X, Delta.Y, Delta.Z);
+
+	// a jump past the grid clears all of it
+	const FIntVector VelocityDelta(FMath::Clamp(Delta.X, -Resolution.X, Resolution.X), FMath::Clamp(Delta.Y, -Resolution.Y, Resolution.Y), FMath::Clamp(Delta.Z, -Resolution.Z, Resolution.Z));
+	const int32 FluidResolutionScale = FMath::RoundToInt32(TScale.X);
+	AddScrollClearPass(GraphBuilder, ScratchPool.GetPooledTexture(Scratch.VelocityIn), Velocity.Resolution, VelocityScroll, VelocityDelta);
+	AddScrollClearPass(GraphBuilder, ScratchPool.GetPooledTexture(Scratch.FluidIn), Fluid.Resolution, VelocityScroll * FluidResolutionScale, VelocityDelta * FluidResolutionScale);
+	if (Layout.bWarmStart)
+	{
+		AddScrollClearPass(GraphBuilder, ScratchPool.GetPooledTexture(Scratch.PressureState), Velocity.Resolution, VelocityScroll, VelocityDelta);
+	}
+	AddScrollClearPass(GraphBuilder, Obstacles, Velocity.Resolution, VelocityScroll, VelocityDelta);
+	bObstaclesDirty = true;
+}
+
+void FFireSimulationContext::AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, const FFireSimulationAtlasBinding* AtlasBinding)
+{
+	check(IsInRenderingThread());
+
+	ReadbackVelocityMax();
+	ReadbackField();
+	NumSubSteps = ComputeSubSteps(TimeStep, Config);
+	CSV_CUSTOM_STAT(FireSimulation, SubSteps, NumSubSteps, ECsvCustomStatOp::Accumulate);
+
+	// the emitters of a step are splatted once, every sub-step adds its share
+	FRDGTextureRef EmitterTexture = AtlasBinding ? nullptr : AddEmitterPasses(GraphBuilder);
+
+	FFireImpulseParameters ImpulseParameters;
+	ImpulseParameters.NumImpulses = 0;
+	ImpulseParameters.ImpulseCellSize = FVector3f(LocalSize) * Velocity.RcpSize;
+	if (!AtlasBinding)
+	{
+		// a sphere covers at least one cell, so that its falloff does not divide by zero
+		const float MinRadius = ImpulseParameters.ImpulseCellSize.GetMax();
+		for (const FFireImpulse& Impulse : PendingImpulses)
+		{
+			if (ImpulseParameters.NumImpulses == FireSimulationCommands::MaxImpulses)
+			{
+				break;
+			}
+			const int32 Index = ImpulseParameters.NumImpulses++;
+			ImpulseParameters.ImpulseSpheres[Index] = FVector4f(FVector3f(Impulse.Location - GridOrigin), FMath::Max(Impulse.Radius, MinRadius));
+			ImpulseParameters.ImpulseVelocities[Index] = FVector4f(FVector3f(Impulse.Velocity) / NumSubSteps, 0.0f);
+		}
+	}
+	PendingImpulses.Reset();
+
+	// slots of new volumes are cleared once, before the first sub-step
+	FFireSimulationAtlasBinding SubStepBinding;
+	const FFireSimulationAtlasBinding* Binding = AtlasBinding;
+	for (int32 SubStep = 0; SubStep < NumSubSteps; ++SubStep)
+	{
+		RDG_EVENT_SCOPE_CONDITIONAL(GraphBuilder, NumSubSteps > 1, "SubStep %d/%d", SubStep + 1, NumSubSteps);
+		AddStepPasses(GraphBuilder, TimeStep / NumSubSteps, Config, Binding, Config.bAdaptiveSubSteps && SubStep == NumSubSteps - 1, EmitterTexture, ImpulseParameters);
+
+		if (AtlasBinding && AtlasBinding->ResetBricks)
+		{
+			SubStepBinding = *AtlasBinding;
+			SubStepBinding.ResetBricks = nullptr;
+			Binding = &SubStepBinding;
+		}
+	}
+
+	if (Field.IsValid() && !AtlasBinding)
+	{
+		const uint32 FieldStep = Field->AdvanceStep();
+		const int32 Interval = GetFieldReadbackInterval();
+		if (Interval > 0 && FieldStep % Interval == 0)
+		{
+			AddFieldReadbackPasses(GraphBuilder, Config, FieldStep);
+		}
+	}
+}
+
+void FFireSimulationContext::AddStepPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, const FFireSimulationAtlasBinding* AtlasBinding, bool bMeasureVelocity,
+	FRDGTextureRef EmitterTexture, const FFireImpulseParameters& ImpulseParameters)
+{
+	{
+		RDG_EVENT_SCOPE(GraphBuilder, "FireSimulationVolume");
+
+		FFireShaderPermutation Permutation;
+		FFireAtlasParameters AtlasParameters;
+		FIntVector VelocityGroupCount = Velocity.ThreadCount;
+		FIntVector FluidGroupCount = Fluid.ThreadCount;
+		if (AtlasBinding)
+		{
+			Permutation.bAtlas = true;
+			AtlasParameters.AtlasSlots = AtlasBinding->Slots;
+			AtlasParameters.AtlasSlotSize = AtlasBinding->SlotSize;
+			AtlasParameters.AtlasFluidSlotSize = AtlasBinding->FluidSlotSize;
+			AtlasParameters.Bricks = AtlasBinding->Bricks;
+			VelocityGroupCount = AtlasBinding->VelocityGroupCount;
+			FluidGroupCount = AtlasBinding->FluidGroupCount;
+		}
+		else
+		{
+			AtlasParameters.VelocityScroll = VelocityScroll;
+			AtlasParameters.FluidScroll = VelocityScroll * FMath::RoundToInt32(TScale.X);
+		}
+
+		const FFireStorageParameters StorageParameters = GetStorageParameters(Config);
+
+		FFireEmitterParameters EmitterParameters;
+		EmitterParameters.EmitterActive = EmitterTexture ? 1 : 0;
+		EmitterParameters.EmitterFraction = 1.0f / NumSubSteps;
+		EmitterParameters.emitterScale = Config.EmitterScale;
+		EmitterParameters.vaporMinTemperature = Config.VaporMinTemperature;
+		EmitterParameters.vaporTemperatureScale = Config.VaporTemperatureScale;
+		EmitterParameters.vaporDensity = Config.VaporDensity;
+		EmitterParameters.emitterIn = GraphBuilder.CreateSRV(EmitterTexture ? EmitterTexture : GSystemTextures.GetVolumetricBlackDummy(GraphBuilder));
+
+		FRDGTextureRef PrevVelocityTexture = nullptr;
+		FRDGTextureRef PrevFluidDataTexture = nullptr;
+		FRDGTextureRef ObstaclesTexture = nullptr;
+		FFireObstacleParameters ObstacleParameters;
+		FFireSparseParameters VelocitySparse;
+		FFireSparseParameters FluidSparse;
+		FRDGBufferUAVRef SparseContent = nullptr;
+		{
+			FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Setup);
+
+			ReadbackResidual();
+			AdaptPressureIterations(Config);
+			++StepIndex;
+
+			const FScratchLayout StepLayout = MakeLayout(Config, AtlasBinding != nullptr);
+			if (StepLayout != Layout)
+			{
+				// keep the simulation state across the new plan, a field whose format changed starts over from zero
+				TRefCountPtr<IPooledRenderTarget> VelocityState;
+				if (Layout.VelocityFormat == StepLayout.VelocityFormat)
+				{
+					VelocityState = ScratchPool.GetPooledTexture(Scratch.VelocityIn);
+				}
+				TRefCountPtr<IPooledRenderTarget> FluidState;
+				if (Layout.FluidFormat == StepLayout.FluidFormat)
+				{
+					FluidState = ScratchPool.GetPooledTexture(Scratch.FluidIn);
+				}
+				TRefCountPtr<IPooledRenderTarget> PressureState;
+				if (Layout.bWarmStart && Layout.PressureFormat == StepLayout.PressureFormat)
+				{
+					PressureState = ScratchPool.GetPooledTexture(Scratch.PressureState);
+				}
+				PlanScratchTextures(StepLayout);
+				ScratchPool.SetPooledTexture(Scratch.VelocityIn, VelocityState);
+				ScratchPool.SetPooledTexture(Scratch.FluidIn, FluidState);
+				if (Layout.bWarmStart)
+				{
+					ScratchPool.SetPooledTexture(Scratch.PressureState, PressureState);
+				}
+			}
+			Permutation.bSparse = Layout.bSparse;
+
+			ScratchPool.BeginStep(GraphBuilder);
+
+			PrevVelocityTexture = ScratchPool.Get(Scratch.VelocityIn);
+			PrevFluidDataTexture = ScratchPool.Get(Scratch.FluidIn);
+
+			if (ScratchPool.WasAllocated(Scratch.VelocityIn))
+			{
+				FFireShaderClearFloat4CS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloat4CS::FParameters>();
+				Params->outputFloat4 = GraphBuilder.CreateUAV(PrevVelocityTexture);
+
+				const auto GroupCount = Velocity.ThreadCount;
+				TShaderMapRef<FFireShaderClearFloat4CS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				GraphBuilder.AddPass(
+					RDG_EVENT_NAME("Clear Velocity"),
+					Params,
+					ERDGPassFlags::AsyncCompute,
+					[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+					{
+						FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+					});
+			}
+
+			if (ScratchPool.WasAllocated(Scratch.FluidIn))
+			{
+				FFireShaderClearFluidCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFluidCS::FParameters>();
+				Params->outputFloat4 = GraphBuilder.CreateUAV(PrevFluidDataTexture);
+
+				const auto GroupCount = Fluid.ThreadCount;
+				TShaderMapRef<FFireShaderClearFluidCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				GraphBuilder.AddPass(
+					RDG_EVENT_NAME("Clear FluidData"),
+					Params,
+					ERDGPassFlags::AsyncCompute,
+					[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+					{
+						FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+					});
+			}
+
+			if (!Obstacles.IsValid())
+			{
+				FRDGTextureDesc ObstaclesDesc(CreateTextureDesc(Velocity.Resolution, PF_R16F));
+				ObstaclesTexture = GraphBuilder.CreateTexture(ObstaclesDesc, TEXT("Obstacles"));
+		
+				FFireShaderClearFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloatCS::FParameters>();
+				Params->outputFloat = GraphBuilder.CreateUAV(ObstaclesTexture);
+
+				const auto GroupCount = Velocity.ThreadCount;
+				TShaderMapRef<FFireShaderClearFloatCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				GraphBuilder.AddPass(
+					RDG_EVENT_NAME("Clear Obstacles"),
+					Params,
+					ERDGPassFlags::AsyncCompute,
+					[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+					{
+						FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+					});
+
+				GraphBuilder.QueueTextureExtraction(ObstaclesTexture, &Obstacles);
+				bObstaclesDirty = true;
+			}
+			else
+			{
+				ObstaclesTexture = GraphBuilder.RegisterExternalTexture(Obstacles);
+			}
+
+			// clear the atlas slots that were assigned to new volumes
+			if (AtlasBinding && AtlasBinding->ResetBricks)
+			{
+				FFireAtlasParameters ResetParameters = AtlasParameters;
+				ResetParameters.Bricks = AtlasBinding->ResetBricks;
+
+				// Reset velocity
+				{
+					FFireShaderClearFloat4CS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloat4CS::FParameters>();
+					Params->Atlas = ResetParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV(PrevVelocityTexture);
+
+					const auto GroupCount = VelocityGroupCount;
+					TShaderMapRef<FFireShaderClearFloat4CS> Shader = Permutation.Get<FFireShaderClearFloat4CS>();
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Reset Velocity"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+
+				// Reset fluid
+				{
+					FFireShaderClearFluidCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFluidCS::FParameters>();
+					Params->Atlas = ResetParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV(PrevFluidDataTexture);
+
+					const auto GroupCount = FluidGroupCount;
+					TShaderMapRef<FFireShaderClearFluidCS> Shader = Permutation.Get<FFireShaderClearFluidCS>();
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Reset FluidData"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+
+				// Reset pressure
+				if (Layout.bWarmStart)
+				{
+					FFireShaderClearFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloatCS::FParameters>();
+					Params->Atlas = ResetParameters;
+					Params->outputFloat = GraphBuilder.CreateUAV(ScratchPool.Get(Scratch.PressureState));
+
+					const auto GroupCount = VelocityGroupCount;
+					TShaderMapRef<FFireShaderClearFloatCS> Shader = Permutation.Get<FFireShaderClearFloatCS>();
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Reset Pressure"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+
+				// Reset obstacles
+				{
+					FFireShaderClearFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloatCS::FParameters>();
+					Params->Atlas = ResetParameters;
+					Params->outputFloat = GraphBuilder.CreateUAV(ObstaclesTexture);
+
+					const auto GroupCount = VelocityGroupCount;
+					TShaderMapRef<FFireShaderClearFloatCS> Shader = Permutation.Get<FFireShaderClearFloatCS>();
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Reset Obstacles"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+						});
+					bObstaclesDirty = true;
+				}
+			}
+
+			if (!StaticObstacleBits.IsEmpty() && !AtlasBinding)
+			{
+				FFireShaderStaticObstaclesCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderStaticObstaclesCS::FParameters>();
+				Params->StaticObstacleBounds = Velocity.Bounds;
+				Params->StaticObstacleResolution = StaticObstacleResolution;
+				Params->staticObstaclesIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.StaticObstacles"), StaticObstacleBits));
+				Params->outputFloat = GraphBuilder.CreateUAV(ObstaclesTexture);
+
+				const auto GroupCount = Velocity.ThreadCount;
+				TShaderMapRef<FFireShaderStaticObstaclesCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				GraphBuilder.AddPass(
+					RDG_EVENT_NAME("Static Obstacles"),
+					Params,
+					ERDGPassFlags::AsyncCompute,
+					[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+					{
+						FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+					});
+
+				StaticObstacleBits.Empty();
+				bObstaclesDirty = true;
+			}
+
+			FRDGTextureRef DynamicTexture = nullptr;
+			int32 NumDynamicBricks = 0;
+			FRDGBufferRef DynamicBricks = AtlasBinding ? nullptr : AddDynamicObstaclePasses(GraphBuilder, DynamicTexture, NumDynamicBricks);
+			ObstacleParameters = AddObstaclePasses(GraphBuilder, ObstaclesTexture, DynamicTexture, DynamicBricks, NumDynamicBricks);
+
+			// simulate only the active bricks of a sparse grid, the indirect arguments are built on the GPU
+			if (Layout.bSparse)
+			{
+				SparseContent = AddSparsePasses(GraphBuilder, Config, VelocitySparse, FluidSparse);
+			}
+		}
+
+		const bool bFused = Layout.bFused;
+		const bool bMultigrid = Layout.bMultigrid;
+
+		{
+			FRDGTextureRef Phi[2] =
+			{
+				ScratchPool.Get(Scratch.Phi[0]),
+				ScratchPool.Get(Scratch.Phi[1])
+			};
+
+			FRDGTextureRef Divergence = ScratchPool.Get(Scratch.Divergence);
+
+			FRDGTextureRef Pressure[2] =
+			{
+				ScratchPool.Get(Scratch.Pressure[0]),
+				ScratchPool.Get(Scratch.Pressure[1])
+			};
+
+			FRDGTextureRef TmpFluid4[2] =
+			{
+				ScratchPool.Get(Scratch.TmpFluid4[0]),
+				ScratchPool.Get(Scratch.TmpFluid4[1]),
+			};
+			FRDGTextureRef TmpVelocity4[3] =
+			{
+				ScratchPool.Get(Scratch.TmpVelocity4[0]),
+				ScratchPool.Get(Scratch.TmpVelocity4[1]),
+				ScratchPool.Get(Scratch.TmpVelocity4[2]),
+			};
+			FRDGTextureRef Vorticity = ScratchPool.Get(Scratch.Vorticity);
+			FRDGTextureRef NewVelocity = ScratchPool.Get(Scratch.VelocityOut);
+
+			// cells covered by the dispatches, an upper bound of the cells a sparse step processes
+			const int32 NumVelocityCells = VelocityGroupCount.X * VelocityGroupCount.Y * VelocityGroupCount.Z * THREAD_COUNT.X * THREAD_COUNT.Y * THREAD_COUNT.Z;
+			const int32 NumFluidCells = FluidGroupCount.X * FluidGroupCount.Y * FluidGroupCount.Z * THREAD_COUNT.X * THREAD_COUNT.Y * THREAD_COUNT.Z;
+
+			// Advect Fluid
+			{
+				FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, AdvectFluid);
+				FIRE_SIMULATION_STAGE_CELLS(AdvectFluid, NumFluidCells);
+
+				// Prepare advection forward
+				{
+					FFireShaderPrepareFluidDataAdvectionCS::FParameters* ParamsFwd = GraphBuilder.AllocParameters<FFireShaderPrepareFluidDataAdvectionCS::FParameters>();
+					ParamsFwd->Atlas = AtlasParameters;
+					ParamsFwd->Sparse = FluidSparse;
+					ParamsFwd->TScale = TScale;
+					ParamsFwd->Forward = TimeStep;
+					ParamsFwd->WorldToGrid = WorldToGrid;
+					ParamsFwd->RcpVelocitySize = Velocity.RcpSize;
+					ParamsFwd->RcpFluidSize = Fluid.RcpSize;
+					ParamsFwd->VelocityBounds = Velocity.Bounds;
+					ParamsFwd->FluidBounds = Fluid.Bounds;
+					ParamsFwd->_LinearClamp = GetGridSampler();
+				
+					ParamsFwd->Obstacles = ObstacleParameters;
+					ParamsFwd->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+					ParamsFwd->phiIn = GraphBuilder.CreateSRV(PrevFluidDataTexture);
+					ParamsFwd->outputFloat4 = GraphBuilder.CreateUAV(Phi[1]);
+
+					TShaderMapRef<FFireShaderPrepareFluidDataAdvectionCS> PrepareFluidDataAdvectCS = Permutation.Get<FFireShaderPrepareFluidDataAdvectionCS>();
+					const auto GroupCount = FluidGroupCount;
+					
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Prepare Fluid Advection Fwd"),
+						ParamsFwd,
+						ERDGPassFlags::AsyncCompute,
+						[ParamsFwd, PrepareFluidDataAdvectCS, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, PrepareFluidDataAdvectCS, *ParamsFwd, GroupCount);
+						});
+				}
+
+				// Prepare advection backwards
+				{
+					FFireShaderPrepareFluidDataAdvectionCS::FParameters* ParamsBack = GraphBuilder.AllocParameters<FFireShaderPrepareFluidDataAdvectionCS::FParameters>();
+					ParamsBack->Atlas = AtlasParameters;
+					ParamsBack->Sparse = FluidSparse;
+					ParamsBack->TScale = TScale;
+					ParamsBack->Forward = -TimeStep;
+					ParamsBack->WorldToGrid = WorldToGrid;
+					ParamsBack->RcpVelocitySize = Velocity.RcpSize;
+					ParamsBack->RcpFluidSize = Fluid.RcpSize;
+					ParamsBack->VelocityBounds = Velocity.Bounds;
+					ParamsBack->FluidBounds = Fluid.Bounds;
+					ParamsBack->_LinearClamp = GetGridSampler();
+				
+					ParamsBack->Obstacles = ObstacleParameters;
+					ParamsBack->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+					ParamsBack->phiIn = GraphBuilder.CreateSRV(Phi[1]);
+					ParamsBack->outputFloat4 = GraphBuilder.CreateUAV(Phi[0]);
+
+					TShaderMapRef<FFireShaderPrepareFluidDataAdvectionCS> PrepareFluidDataAdvectCS = Permutation.Get<FFireShaderPrepareFluidDataAdvectionCS>();
+					const auto GroupCount = FluidGroupCount;
+
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Prepare Fluid Advection Back"),
+						ParamsBack,
+						ERDGPassFlags::AsyncCompute,
+						[ParamsBack, PrepareFluidDataAdvectCS, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, PrepareFluidDataAdvectCS, *ParamsBack, GroupCount);
+						});
+				}
+
+				if (bFused)
+				{
+					// Advect fluid and extinguish
+					{
+						FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Extinguish);
+						FIRE_SIMULATION_STAGE_CELLS(Extinguish, NumFluidCells);
+
+						FFireShaderAdvectFluidExtinguishCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderAdvectFluidExtinguishCS::FParameters>();
+						Params->Atlas = AtlasParameters;
+						Params->Sparse = FluidSparse;
+						Params->Sparse.SparseContentOut = SparseContent;
+						Params->Storage = StorageParameters;
+						Params->TScale = TScale;
+						Params->Forward = TimeStep;
+						Params->FluidDissipation = Config.FluidDissipation;
+						Params->FluidDecay = Config.FluidDecay * TimeStep;
+						Params->Amount = Config.ReactionAmount;
+						Params->Extinguishment = FVector3f(Config.VaporCooling, Config.VaporExtinguish, Config.ReactionExtinguish);
+						Params->TempDistribution = Config.TemperatureDistribution * TimeStep;
+						Params->WorldToGrid = WorldToGrid;
+						Params->RcpVelocitySize = Velocity.RcpSize;
+						Params->RcpFluidSize = Fluid.RcpSize;
+						Params->FluidBounds = Fluid.Bounds;
+						Params->VelocityBounds = Velocity.Bounds;
+						Params->_LinearClamp = GetGridSampler();
+						Params->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+						Params->fluidDataIn = GraphBuilder.CreateSRV(PrevFluidDataTexture);
+						Params->phi0 = GraphBuilder.CreateSRV(Phi[0]);
+						Params->phi1 = GraphBuilder.CreateSRV(Phi[1]);
+						Params->Obstacles = ObstacleParameters;
+						Params->Emitter = EmitterParameters;
+						Params->outputFloat4 = GraphBuilder.CreateUAV(TmpFluid4[1]);
+
+						TShaderMapRef<FFireShaderAdvectFluidExtinguishCS> Shader = Permutation.Get<FFireShaderAdvectFluidExtinguishCS>();
+						const auto GroupCount = FluidGroupCount;
+
+						GraphBuilder.AddPass(
+							RDG_EVENT_NAME("Fluid Advection + Extinguishment"),
+							Params,
+							ERDGPassFlags::AsyncCompute,
+							[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+							{
+								DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+							});
+					}
+				}
+				else
+				{
+					// Advect fluid
+					{
+						FFireShaderAdvectFluidDataCS::FParameters* AdvectParams = GraphBuilder.AllocParameters<FFireShaderAdvectFluidDataCS::FParameters>();
+						AdvectParams->Atlas = AtlasParameters;
+						AdvectParams->Sparse = FluidSparse;
+						AdvectParams->Storage = StorageParameters;
+						AdvectParams->TScale = TScale;
+						AdvectParams->Forward = TimeStep;
+						AdvectParams->FluidDissipation = Config.FluidDissipation;
+						AdvectParams->FluidDecay = Config.FluidDecay * TimeStep;
+						AdvectParams->WorldToGrid = WorldToGrid;
+						AdvectParams->RcpVelocitySize = Velocity.RcpSize;
+						AdvectParams->RcpFluidSize = Fluid.RcpSize;
+						AdvectParams->FluidBounds = Fluid.Bounds;
+						AdvectParams->VelocityBounds = Velocity.Bounds;
+						AdvectParams->_LinearClamp = GetGridSampler();
+						AdvectParams->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+						AdvectParams->fluidDataIn = GraphBuilder.CreateSRV(PrevFluidDataTexture);
+						AdvectParams->phi0 = GraphBuilder.CreateSRV(Phi[0]);
+						AdvectParams->phi1 = GraphBuilder.CreateSRV(Phi[1]);
+						AdvectParams->Obstacles = ObstacleParameters;
+						AdvectParams->outputFloat4 = GraphBuilder.CreateUAV(TmpFluid4[0]);
+
+						TShaderMapRef<FFireShaderAdvectFluidDataCS> FluidDataAdvectCS = Permutation.Get<FFireShaderAdvectFluidDataCS>();
+						const auto GroupCount = FluidGroupCount;
+
+						GraphBuilder.AddPass(
+							RDG_EVENT_NAME("Fluid Advection"),
+							AdvectParams,
+							ERDGPassFlags::AsyncCompute,
+							[AdvectParams, FluidDataAdvectCS, GroupCount](FRHIComputeCommandList& RHICmdList)
+							{
+								DispatchFireShader(RHICmdList, FluidDataAdvectCS, *AdvectParams, GroupCount);
+							});
+					}
+				}
+			}
+
+			if (bFused)
+			{
+				// Advect Velocity and ApplyBuoyancy
+				// TmpFluid4[1] = current fluid state, buoyancy sees the fluid after extinguishment
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, AdvectVelocity);
+					FIRE_SIMULATION_STAGE_CELLS(AdvectVelocity, NumVelocityCells);
+					FIRE_SIMULATION_STAGE_CELLS(Buoyancy, NumVelocityCells);
+
+					FFireShaderAdvectVelocityBuoyancyCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderAdvectVelocityBuoyancyCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->Storage = StorageParameters;
+					Params->Forward = TimeStep;
+					Params->Dissipation = Config.Dissipation;
+					Params->Buoyancy = Config.Buoyancy * TimeStep;
+					Params->Weight = Config.DensityWeight;
+					Params->AmbientTemperature = Config.AmbientTemperature;
+					Params->Up = FVector3f(FVector::UpVector);
+					Params->WorldToGrid = WorldToGrid;
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->RcpFluidSize = Fluid.RcpSize;
+					Params->TScale = TScale;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->FluidBounds = Fluid.Bounds;
+					Params->_LinearClamp = GetGridSampler();
+					Params->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+					Params->fluidDataIn = GraphBuilder.CreateSRV(TmpFluid4[1]);
+					Params->Impulse = ImpulseParameters;
+					Params->Obstacles = ObstacleParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV(TmpVelocity4[1]);
+
+					TShaderMapRef<FFireShaderAdvectVelocityBuoyancyCS> Shader = Permutation.Get<FFireShaderAdvectVelocityBuoyancyCS>();
+					const auto GroupCount = VelocityGroupCount;
+
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Velocity Advection + Buoyancy"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+			else
+			{
+				// Advect Velocity
+				// TmpFluid4[0] = current fluid state  
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, AdvectVelocity);
+					FIRE_SIMULATION_STAGE_CELLS(AdvectVelocity, NumVelocityCells);
+
+					FFireShaderAdvectVelocityCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderAdvectVelocityCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->Forward = TimeStep;
+					Params->Dissipation = Config.Dissipation;
+					Params->WorldToGrid = WorldToGrid;
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->_LinearClamp = GetGridSampler();
+					Params->velocityIn = GraphBuilder.CreateSRV(PrevVelocityTexture);
+					Params->Obstacles = ObstacleParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV( TmpVelocity4[0]);
+	
+					TShaderMapRef<FFireShaderAdvectVelocityCS> Shader = Permutation.Get<FFireShaderAdvectVelocityCS>();
+					const auto GroupCount = VelocityGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Velocity Advection"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+
+				// ApplyBuoyancy
+				// TmpFluid4[0] = current fluid state
+				// TmpVelocity4[0] = current velocity state
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Buoyancy);
+					FIRE_SIMULATION_STAGE_CELLS(Buoyancy, NumVelocityCells);
+
+					FFireShaderBuoyancyCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderBuoyancyCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->Storage = StorageParameters;
+					Params->Buoyancy = Config.Buoyancy * TimeStep;
+					Params->Weight = Config.DensityWeight;
+					Params->AmbientTemperature = Config.AmbientTemperature;
+					Params->Up = FVector3f(FVector::UpVector);
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->RcpFluidSize = Fluid.RcpSize;
+					Params->TScale = TScale;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->FluidBounds = Fluid.Bounds;
+					Params->_LinearClamp = Params->_LinearClamp = GetGridSampler();
+					Params->fluidDataIn = GraphBuilder.CreateSRV(TmpFluid4[0]);
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[0]);
+					Params->Impulse = ImpulseParameters;
+					Params->Obstacles = ObstacleParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV(TmpVelocity4[1]);
+				
+					TShaderMapRef<FFireShaderBuoyancyCS> Shader = Permutation.Get<FFireShaderBuoyancyCS>();
+					const auto GroupCount = VelocityGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Buoyancy Calculation"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+	
+				// HandleExtinguish
+				// TmpFluid4[0] = current fluid state
+				// TmpVelocity4[1] = current velocity state
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Extinguish);
+					FIRE_SIMULATION_STAGE_CELLS(Extinguish, NumFluidCells);
+
+					FFireShaderExtinguishCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderExtinguishCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = FluidSparse;
+					Params->Sparse.SparseContentOut = SparseContent;
+					Params->Storage = StorageParameters;
+					Params->TScale = TScale;
+					Params->Amount = Config.ReactionAmount;
+					Params->Extinguishment = FVector3f(Config.VaporCooling, Config.VaporExtinguish, Config.ReactionExtinguish);
+					Params->TempDistribution = Config.TemperatureDistribution * TimeStep;
+					Params->FluidBounds = Fluid.Bounds;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->_LinearClamp = Params->_LinearClamp = GetGridSampler();
+					Params->fluidDataIn = GraphBuilder.CreateSRV(TmpFluid4[0]);
+					Params->Obstacles = ObstacleParameters;
+					Params->Emitter = EmitterParameters;
+					Params->outputFloat4 = GraphBuilder.CreateUAV(TmpFluid4[1]);
+	
+					TShaderMapRef<FFireShaderExtinguishCS> Shader = Permutation.Get<FFireShaderExtinguishCS>();
+					const auto GroupCount = FluidGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Extinguishment"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+	
+			if (bFused)
+			{
+				// Vorticity and Confinement
+				// TmpVelocity4[1] = current velocity state
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Vorticity);
+					FIRE_SIMULATION_STAGE_CELLS(Vorticity, NumVelocityCells);
+
+					FFireShaderVorticityConfinementCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderVorticityConfinementCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->Strength = Config.VorticityStrength * TimeStep;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[1]);
+					Params->outputFloat4 = GraphBuilder.CreateUAV(TmpVelocity4[2]);
+
+					TShaderMapRef<FFireShaderVorticityConfinementCS> Shader = Permutation.Get<FFireShaderVorticityConfinementCS>();
+					const auto GroupCount = VelocityGroupCount;
+
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Vorticity + Confinement"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+			else
+			{
+				FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Vorticity);
+				FIRE_SIMULATION_STAGE_CELLS(Vorticity, NumVelocityCells);
+
+				// CalculateVorticity
+				// TmpFluid4[1] = current fluid state
+				// TmpVelocity4[1] = current velocity state
+				{
+					FFireShaderVorticityCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderVorticityCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[1]);
+					Params->outputFloat4 = GraphBuilder.CreateUAV(Vorticity);
+	
+					TShaderMapRef<FFireShaderVorticityCS> Shader = Permutation.Get<FFireShaderVorticityCS>();
+					const auto GroupCount = VelocityGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Vorticity"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+	
+				// Update Confinement
+				// TmpVelocity4[1] = current velocity state
+				// Vorticity = vorticity result
+				{
+					FFireShaderConfinementCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderConfinementCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->Strength = Config.VorticityStrength * TimeStep;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[1]);
+					Params->vorticityIn = GraphBuilder.CreateSRV(Vorticity);
+					Params->outputFloat4 = GraphBuilder.CreateUAV(TmpVelocity4[2]);
+	
+					TShaderMapRef<FFireShaderConfinementCS> Shader = Permutation.Get<FFireShaderConfinementCS>();
+					const auto GroupCount = VelocityGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Vorticity"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+	
+			if (bFused)
+			{
+				// Calculate Divergence and PreparePressure
+				// TmpVelocity4[2] = current velocity state
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Divergence);
+					FIRE_SIMULATION_STAGE_CELLS(Divergence, NumVelocityCells);
+
+					FFireShaderDivergencePreparePressureCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderDivergencePreparePressureCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->_LinearClamp = GetGridSampler();
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[2]);
+					Params->Obstacles = ObstacleParameters;
+					Params->outputFloat = GraphBuilder.CreateUAV(Divergence);
+					Params->pressureOut = GraphBuilder.CreateUAV(Pressure[0]);
+
+					TShaderMapRef<FFireShaderDivergencePreparePressureCS> Shader = Permutation.Get<FFireShaderDivergencePreparePressureCS>();
+					const auto GroupCount = VelocityGroupCount;
+
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Divergence + PreparePressure"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+			else
+			{
+				// Calculate Divergence
+				// TmpVelocity4[2] = current velocity state
+				{
+					FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Divergence);
+					FIRE_SIMULATION_STAGE_CELLS(Divergence, NumVelocityCells);
+
+					FFireShaderDivergenceCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderDivergenceCS::FParameters>();
+					Params->Atlas = AtlasParameters;
+					Params->Sparse = VelocitySparse;
+					Params->VelocityBounds = Velocity.Bounds;
+					Params->RcpVelocitySize = Velocity.RcpSize;
+					Params->_LinearClamp = Params->_LinearClamp = GetGridSampler();
+					Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[2]);
+					Params->Obstacles = ObstacleParameters;
+					Params->outputFloat = GraphBuilder.CreateUAV(Divergence);
+	
+					TShaderMapRef<FFireShaderDivergenceCS> Shader = Permutation.Get<FFireShaderDivergenceCS>();
+					const auto GroupCount = VelocityGroupCount;
+				
+					GraphBuilder.AddPass(
+						RDG_EVENT_NAME("Divergence"),
+						Params,
+						ERDGPassFlags::AsyncCompute,
+						[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+						{
+							DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+						});
+				}
+			}
+
+			// Solve Pressure
+			// TmpVelocity4[2] = current velocity state
+			// TmpVelocity1[0] = divergence result
+			// a warm started solve continues from the solution of the previous step instead of the prepared guess,
+			// which counts as the first iteration otherwise
+			const bool bWarmStart = Layout.bWarmStart && !ScratchPool.WasAllocated(Scratch.PressureState);
+			const int32 NumIterations = bMultigrid ? Config.NumMultigridCycles
+				: Config.bAdaptivePressureIterations ? PressureIterations : Config.NumPressureIterations;
+			const int32 FirstIteration = bWarmStart ? 0 : 1;
+
+			int32 PressureHandles[2] = { Scratch.Pressure[0], Scratch.Pressure[1] };
+			if (bWarmStart)
+			{
+				PressureHandles[0] = Scratch.PressureState;
+				Pressure[0] = ScratchPool.Get(Scratch.PressureState);
+			}
+
+			int32 SolvedIndex = 0;
+			{
+				FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Pressure);
+				FIRE_SIMULATION_STAGE_CELLS(Pressure, NumVelocityCells * FMath::Max(NumIterations - FirstIteration, 0));
+
+				if (NumIterations > 0)
+				{
+					// the fused divergence kernel already wrote the initial pressure
+					if (!bFused && !bWarmStart)
+					{
+						TShaderMapRef<FFireShaderPreparePressureCS> Shader = Permutation.Get<FFireShaderPreparePressureCS>();
+						const auto GroupCount = VelocityGroupCount;
+
+						FFireShaderPreparePressureCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderPreparePressureCS::FParameters>();
+						Params->Atlas = AtlasParameters;
+						Params->Sparse = VelocitySparse;
+						Params->divergenceIn = GraphBuilder.CreateSRV(Divergence);
+						Params->outputFloat = GraphBuilder.CreateUAV(Pressure[0]);
+
+						GraphBuilder.AddPass(
+							RDG_EVENT_NAME("PreparePressure"),
+							Params,
+							ERDGPassFlags::AsyncCompute,
+							[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+							{
+								DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+							});
+					}
+
+					const int32 NumSweeps = FMath::Clamp(Config.PressureSweepsPerDispatch, 1, FFireShaderPressureTiledCS::MaxSweeps);
+					if (bMultigrid)
+					{
+						SolvedIndex = AddMultigridPasses(GraphBuilder, Config, ObstacleParameters, Divergence, Pressure);
+					}
+					else if (NumSweeps > 1)
+					{
+						FFireShaderPressureTiledCS::FPermutationDomain PermutationVector;
+						PermutationVector.Set<FFireShaderBaseCS::FAtlasDim>(Permutation.bAtlas);
+						PermutationVector.Set<FFireShaderBaseCS::FSparseDim>(Permutation.bSparse);
+						PermutationVector.Set<FFireShaderPressureTiledCS::FSweepsDim>(NumSweeps);
+						TShaderMapRef<FFireShaderPressureTiledCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+						const auto GroupCount = VelocityGroupCount;
+
+						int32 SourceIndex = 0;
+						int32 DestIndex = 1;
+
+						// the last dispatch runs the remaining sweeps, the halo of the permutation covers any smaller count
+						for (int32 I = FirstIteration; I < NumIterations; I += NumSweeps)
+						{
+							FFireShaderPressureTiledCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderPressureTiledCS::FParameters>();
+							Params->Atlas = AtlasParameters;
+							Params->Sparse = VelocitySparse;
+							Params->NumSweeps = FMath::Min(NumSweeps, NumIterations - I);
+							Params->VelocityBounds = Velocity.Bounds;
+							Params->Obstacles = ObstacleParameters;
+							Params->divergenceIn = GraphBuilder.CreateSRV(Divergence);
+							Params->pressureIn = GraphBuilder.CreateSRV(Pressure[SourceIndex]);
+							Params->outputFloat = GraphBuilder.CreateUAV(Pressure[DestIndex]);
+
+							GraphBuilder.AddPass(
+								RDG_EVENT_NAME("Pressure %d x%d", I, Params->NumSweeps),
+								Params,
+								ERDGPassFlags::AsyncCompute,
+								[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+								{
+									DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+								});
+
+							Swap(SourceIndex, DestIndex);
+						}
+						SolvedIndex = SourceIndex;
+					}
+					else
+					{
+						TShaderMapRef<FFireShaderPressureCS> Shader = Permutation.Get<FFireShaderPressureCS>();
+						const auto GroupCount = VelocityGroupCount;
+
+						int32 SourceIndex = 0;
+						int32 DestIndex = 1;
+					
+						for(int32 I=FirstIteration; I < NumIterations; ++I)
+						{
+							FFireShaderPressureCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderPressureCS::FParameters>();
+							Params->Atlas = AtlasParameters;
+							Params->Sparse = VelocitySparse;
+							Params->VelocityBounds = Velocity.Bounds;
+							Params->Obstacles = ObstacleParameters;
+							Params->divergenceIn = GraphBuilder.CreateSRV(Divergence);
+							Params->pressureIn = GraphBuilder.CreateSRV(Pressure[SourceIndex]);
+							Params->outputFloat = GraphBuilder.CreateUAV(Pressure[DestIndex]);
+				
+							GraphBuilder.AddPass(
+								RDG_EVENT_NAME("Pressure %d", I),
+								Params,
+								ERDGPassFlags::AsyncCompute,
+								[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+								{
+									DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+								});
+
+							Swap(SourceIndex, DestIndex);
+						}
+						SolvedIndex = SourceIndex;
+					}
+				}
+			}
+	
+			FRDGTextureRef SolvedPressure = Pressure[SolvedIndex];
+			if (Layout.bWarmStart)
+			{
+				// the solution is the initial guess of the next step
+				ScratchPool.SwapPhysical(Scratch.PressureState, PressureHandles[SolvedIndex]);
+			}
+
+			if (Config.bAdaptivePressureIterations || CVarFireSimulationPressureResidual.GetValueOnRenderThread() > 0)
+			{
+				AddResidualPasses(GraphBuilder, Permutation.bAtlas, AtlasParameters, VelocityGroupCount, ObstacleParameters, Divergence, SolvedPressure, NumIterations);
+			}
+
+			// DoProjection
+			// TmpVelocity4[2] = current velocity state
+			{
+				FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Projection);
+				FIRE_SIMULATION_STAGE_CELLS(Projection, NumVelocityCells);
+
+				FFireShaderProjectionCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderProjectionCS::FParameters>();
+				Params->Atlas = AtlasParameters;
+				Params->Sparse = VelocitySparse;
+				Params->Sparse.SparseContentOut = SparseContent;
+				Params->VelocityBounds = Velocity.Bounds;
+				Params->Obstacles = ObstacleParameters;
+				Params->pressureIn = GraphBuilder.CreateSRV(SolvedPressure);
+				Params->velocityIn = GraphBuilder.CreateSRV(TmpVelocity4[2]);
+				Params->outputFloat4 = GraphBuilder.CreateUAV(NewVelocity);
+				
+				TShaderMapRef<FFireShaderProjectionCS> Shader = Permutation.Get<FFireShaderProjectionCS>();
+				const auto GroupCount = VelocityGroupCount;
+				
+				GraphBuilder.AddPass(
+					RDG_EVENT_NAME("Projection"),
+					Params,
+					ERDGPassFlags::AsyncCompute,
+					[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+					{
+						DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+					});
+			}
+
+			if (bMeasureVelocity)
+			{
+				AddVelocityMaxPasses(GraphBuilder, Permutation.bAtlas, AtlasParameters, VelocityGroupCount, NewVelocity);
+			}
+		}
+
+		// the outputs of this step are the inputs of the next one
+		ScratchPool.SwapPhysical(Scratch.VelocityIn, Scratch.VelocityOut);
+		ScratchPool.SwapPhysical(Scratch.FluidIn, Scratch.TmpFluid4[1]);
+	}
+}
+
+namespace FireMultigrid
+{
+	/** Textures of one multigrid level for the current step */
+	struct FLevel
+	{
+		FIntVector Resolution = FIntVector::ZeroValue;
+		float CellArea = 1.0f;
+		FRDGTextureRef Obstacles = nullptr;
+		FRDGTextureRef Rhs = nullptr;
+		FRDGTextureRef Pressure[2] = { nullptr, nullptr };
+		FRDGTextureRef Residual = nullptr;
+		int32 Current = 0;
+
+		FIntVector GetBounds() const { return Resolution - FIntVector(1, 1, 1); }
+		FIntVector GetGroupCount() const { return FComputeShaderUtils::GetGroupCount(Resolution, THREAD_COUNT); }
+	};
+
+	static void AddObstaclesPass(FRDGBuilder& GraphBuilder, const FFireObstacleParameters& ObstacleParameters, const FLevel& Level)
+	{
+		FFireShaderMultigridObstaclesCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderMultigridObstaclesCS::FParameters>();
+		Params->LevelBounds = Level.GetBounds();
+		Params->Obstacles = ObstacleParameters;
+		Params->obstaclesOut = GraphBuilder.CreateUAV(Level.Obstacles);
+
+		TShaderMapRef<FFireShaderMultigridObstaclesCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const auto GroupCount = Level.GetGroupCount();
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Obstacles %dx%dx%d", Level.Resolution.X, Level.Resolution.Y, Level.Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	static void AddSmoothPass(FRDGBuilder& GraphBuilder, FLevel& Level)
+	{
+		FFireShaderMultigridSmoothCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderMultigridSmoothCS::FParameters>();
+		Params->LevelBounds = Level.GetBounds();
+		Params->CellArea = Level.CellArea;
+		Params->pressureIn = GraphBuilder.CreateSRV(Level.Pressure[Level.Current]);
+		Params->rhsIn = GraphBuilder.CreateSRV(Level.Rhs);
+		Params->obstaclesIn = GraphBuilder.CreateSRV(Level.Obstacles);
+		Params->outputFloat = GraphBuilder.CreateUAV(Level.Pressure[1 - Level.Current]);
+
+		TShaderMapRef<FFireShaderMultigridSmoothCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const auto GroupCount = Level.GetGroupCount();
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Smooth %dx%dx%d", Level.Resolution.X, Level.Resolution.Y, Level.Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+
+		Level.Current = 1 - Level.Current;
+	}
+
+	static void AddResidualPass(FRDGBuilder& GraphBuilder, const FLevel& Level)
+	{
+		FFireShaderMultigridResidualCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderMultigridResidualCS::FParameters>();
+		Params->LevelBounds = Level.GetBounds();
+		Params->CellArea = Level.CellArea;
+		Params->pressureIn = GraphBuilder.CreateSRV(Level.Pressure[Level.Current]);
+		Params->rhsIn = GraphBuilder.CreateSRV(Level.Rhs);
+		Params->obstaclesIn = GraphBuilder.CreateSRV(Level.Obstacles);
+		Params->outputFloat = GraphBuilder.CreateUAV(Level.Residual);
+
+		TShaderMapRef<FFireShaderMultigridResidualCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const auto GroupCount = Level.GetGroupCount();
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Residual %dx%dx%d", Level.Resolution.X, Level.Resolution.Y, Level.Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	/** Restricts the residual of Fine into the right hand side of Coarse and runs the first sweep from a zero guess */
+	static void AddRestrictPass(FRDGBuilder& GraphBuilder, const FLevel& Fine, FLevel& Coarse)
+	{
+		FFireShaderMultigridRestrictCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderMultigridRestrictCS::FParameters>();
+		Params->LevelBounds = Coarse.GetBounds();
+		Params->CellArea = Coarse.CellArea;
+		Params->rhsIn = GraphBuilder.CreateSRV(Fine.Residual);
+		Params->obstaclesIn = GraphBuilder.CreateSRV(Fine.Obstacles);
+		Params->outputFloat = GraphBuilder.CreateUAV(Coarse.Rhs);
+		Params->pressureOut = GraphBuilder.CreateUAV(Coarse.Pressure[0]);
+		Params->obstaclesOut = GraphBuilder.CreateUAV(Coarse.Obstacles);
+
+		TShaderMapRef<FFireShaderMultigridRestrictCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const auto GroupCount = Coarse.GetGroupCount();
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Restrict %dx%dx%d", Coarse.Resolution.X, Coarse.Resolution.Y, Coarse.Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+
+		Coarse.Current = 0;
+	}
+
+	/** Adds the interpolated correction of Coarse to Fine */
+	static void AddProlongPass(FRDGBuilder& GraphBuilder, FLevel& Fine, const FLevel& Coarse)
+	{
+		FFireShaderMultigridProlongCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderMultigridProlongCS::FParameters>();
+		Params->LevelBounds = Fine.GetBounds();
+		Params->RcpLevelSize = FVector3f(1.0f / Fine.Resolution.X, 1.0f / Fine.Resolution.Y, 1.0f / Fine.Resolution.Z);
+		Params->_LinearClamp = TStaticSamplerState<SF_Trilinear>::GetRHI();
+		Params->pressureIn = GraphBuilder.CreateSRV(Fine.Pressure[Fine.Current]);
+		Params->coarseIn = GraphBuilder.CreateSRV(Coarse.Pressure[Coarse.Current]);
+		Params->obstaclesIn = GraphBuilder.CreateSRV(Fine.Obstacles);
+		Params->outputFloat = GraphBuilder.CreateUAV(Fine.Pressure[1 - Fine.Current]);
+
+		TShaderMapRef<FFireShaderMultigridProlongCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const auto GroupCount = Fine.GetGroupCount();
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Prolong %dx%dx%d", Fine.Resolution.X, Fine.Resolution.Y, Fine.Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+
+		Fine.Current = 1 - Fine.Current;
+	}
+
+	static void AddCycle(FRDGBuilder& GraphBuilder, TArrayView<FLevel> Levels, int32 Index, int32 SmoothingSteps)
+	{
+		FLevel& Level = Levels[Index];
+		if (Index == Levels.Num() - 1)
+		{
+			for (int32 Sweep = 0; Sweep < MultigridCoarsestSweeps; ++Sweep)
+			{
+				AddSmoothPass(GraphBuilder, Level);
+			}
+			return;
+		}
+
+		for (int32 Step = 0; Step < SmoothingSteps; ++Step)
+		{
+			AddSmoothPass(GraphBuilder, Level);
+		}
+
+		AddResidualPass(GraphBuilder, Level);
+		AddRestrictPass(GraphBuilder, Level, Levels[Index + 1]);
+		AddCycle(GraphBuilder, Levels, Index + 1, SmoothingSteps);
+		AddProlongPass(GraphBuilder, Level, Levels[Index + 1]);
+
+		for (int32 Step = 0; Step < SmoothingSteps; ++Step)
+		{
+			AddSmoothPass(GraphBuilder, Level);
+		}
+	}
+}
+
+int32 FFireSimulationContext::AddMultigridPasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, const FFireObstacleParameters& ObstacleParameters, FRDGTextureRef Divergence, FRDGTextureRef (&Pressure)[2])
+{
+	using namespace FireMultigrid;
+	RDG_EVENT_SCOPE(GraphBuilder, "Multigrid");
+
+	TArray<FLevel, TInlineAllocator<MaxMultigridLevels + 1>> Levels;
+	{
+		FLevel& Level = Levels.AddDefaulted_GetRef();
+		Level.Resolution = Velocity.Resolution;
+		Level.Obstacles = ScratchPool.Get(Scratch.MultigridObstacles);
+		Level.Rhs = Divergence;
+		Level.Pressure[0] = Pressure[0];
+		Level.Pressure[1] = Pressure[1];
+		Level.Residual = ScratchPool.Get(Scratch.Residual);
+	}
+
+	for (const FScratchTextures::FMultigridLevel& Textures : Scratch.Multigrid)
+	{
+		const float CellArea = Levels.Last().CellArea * 4.0f;
+
+		FLevel& Level = Levels.AddDefaulted_GetRef();
+		Level.Resolution = Textures.Resolution;
+		Level.CellArea = CellArea;
+		Level.Obstacles = ScratchPool.Get(Textures.Obstacles);
+		Level.Rhs = ScratchPool.Get(Textures.Rhs);
+		Level.Pressure[0] = ScratchPool.Get(Textures.Pressure[0]);
+		Level.Pressure[1] = ScratchPool.Get(Textures.Pressure[1]);
+		Level.Residual = ScratchPool.Get(Textures.Residual);
+	}
+
+	// the finest level closes the same cells as the Jacobi solver, moving bodies included
+	AddObstaclesPass(GraphBuilder, ObstacleParameters, Levels[0]);
+
+	// the finest level starts from the prepared guess or the solution of the previous step
+	const int32 SmoothingSteps = FMath::Max(Config.MultigridSmoothingSteps, 1);
+	for (int32 Cycle = 0; Cycle < FMath::Max(Config.NumMultigridCycles, 1); ++Cycle)
+	{
+		RDG_EVENT_SCOPE_CONDITIONAL(GraphBuilder, FireSimulationProfiling::IsEnabled(), "Cycle %d", Cycle);
+		AddCycle(GraphBuilder, Levels, 0, SmoothingSteps);
+	}
+
+	return Levels[0].Current;
+}
+
+void FFireSimulationContext::AddResidualPasses(FRDGBuilder& GraphBuilder, bool bAtlas, const FFireAtlasParameters& AtlasParameters, const FIntVector& GroupCount,
+	const FFireObstacleParameters& ObstacleParameters, FRDGTextureRef Divergence, FRDGTextureRef Pressure, int32 Iterations)
+{
+	if (ResidualReadbacks.IsEmpty())
+	{
+		ResidualReadbacks.SetNum(NumReadbacks);
+	}
+
+	FResidualReadback* Entry = ResidualReadbacks.FindByPredicate([](const FResidualReadback& Readback) { return !Readback.bPending; });
+	if (!Entry)
+	{
+		return;
+	}
+
+	RDG_EVENT_SCOPE(GraphBuilder, "PressureResidual");
+
+	const int32 NumPartials = GroupCount.X * GroupCount.Y * GroupCount.Z;
+	FRDGBufferRef Partials = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(FVector4f), NumPartials), TEXT("FireSimulation.ResidualPartials"));
+	FRDGBufferRef Result = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(FVector4f), 1), TEXT("FireSimulation.Residual"));
+
+	{
+		FFireShaderResidualNormCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderResidualNormCS::FParameters>();
+		Params->Atlas = AtlasParameters;
+		Params->NumGroups = GroupCount;
+		Params->VelocityBounds = Velocity.Bounds;
+		Params->pressureIn = GraphBuilder.CreateSRV(Pressure);
+		Params->divergenceIn = GraphBuilder.CreateSRV(Divergence);
+		Params->Obstacles = ObstacleParameters;
+		Params->residualOut = GraphBuilder.CreateUAV(Partials);
+
+		FFireShaderResidualNormCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FFireShaderBaseCS::FAtlasDim>(bAtlas);
+		TShaderMapRef<FFireShaderResidualNormCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Residual Norm"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	{
+		FFireShaderResidualReduceCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderResidualReduceCS::FParameters>();
+		Params->NumPartials = NumPartials;
+		Params->residualIn = GraphBuilder.CreateSRV(Partials);
+		Params->residualOut = GraphBuilder.CreateUAV(Result);
+
+		TShaderMapRef<FFireShaderResidualReduceCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Residual Reduce"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, FIntVector(1, 1, 1));
+			});
+	}
+
+	if (!Entry->Readback)
+	{
+		Entry->Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("FireSimulation.ResidualReadback"));
+	}
+	AddEnqueueCopyPass(GraphBuilder, Entry->Readback.Get(), Result, sizeof(FVector4f));
+	Entry->Step = StepIndex;
+	Entry->Solver = Layout.bMultigrid ? EFirePressureSolver::Multigrid : EFirePressureSolver::Jacobi;
+	Entry->Iterations = Iterations;
+	Entry->bPending = true;
+}
+
+void FFireSimulationContext::ReadbackResidual()
+{
+	for (FResidualReadback& Entry : ResidualReadbacks)
+	{
+		if (!Entry.bPending || !Entry.Readback->IsReady())
+		{
+			continue;
+		}
+
+		const FVector4f Result = *static_cast<const FVector4f*>(Entry.Readback->Lock(sizeof(FVector4f)));
+		Entry.Readback->Unlock();
+		Entry.bPending = false;
+
+		// readbacks may complete out of order, keep the most recent step
+		if (Entry.Step < PressureResidual.Step)
+		{
+			continue;
+		}
+
+		PressureResidual.NumFluidCells = FMath::RoundToInt32(Result.Z);
+		PressureResidual.Rms = PressureResidual.NumFluidCells > 0 ? FMath::Sqrt(Result.X / PressureResidual.NumFluidCells) : 0.0f;
+		PressureResidual.Max = Result.Y;
+		PressureResidual.Step = Entry.Step;
+		PressureResidual.Solver = Entry.Solver;
+		PressureResidual.Iterations = Entry.Iterations;
+
+		if (CVarFireSimulationPressureResidual.GetValueOnRenderThread() > 1)
+		{
+			UE_LOG(LogFireSimulation, Log, TEXT("Pressure residual %dx%dx%d (%s x%d): rms %g, max %g, %d fluid cells"),
+				Velocity.Resolution.X, Velocity.Resolution.Y, Velocity.Resolution.Z,
+				PressureResidual.Solver == EFirePressureSolver::Multigrid ? TEXT("multigrid") : TEXT("jacobi"), PressureResidual.Iterations,
+				PressureResidual.Rms, PressureResidual.Max, PressureResidual.NumFluidCells);
+		}
+	}
+}
+
+void FFireSimulationContext::AddVelocityMaxPasses(FRDGBuilder& GraphBuilder, bool bAtlas, const FFireAtlasParameters& AtlasParameters, const FIntVector& GroupCount, FRDGTextureRef NewVelocity)
+{
+	if (VelocityReadbacks.IsEmpty())
+	{
+		VelocityReadbacks.SetNum(NumReadbacks);
+	}
+
+	FVelocityReadback* Entry = VelocityReadbacks.FindByPredicate([](const FVelocityReadback& Readback) { return !Readback.bPending; });
+	if (!Entry)
+	{
+		return;
+	}
+
+	RDG_EVENT_SCOPE(GraphBuilder, "VelocityMax");
+
+	const int32 NumPartials = GroupCount.X * GroupCount.Y * GroupCount.Z;
+	FRDGBufferRef Partials = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(FVector4f), NumPartials), TEXT("FireSimulation.VelocityMaxPartials"));
+	FRDGBufferRef Result = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(FVector4f), 1), TEXT("FireSimulation.VelocityMax"));
+
+	{
+		FFireShaderVelocityMaxCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderVelocityMaxCS::FParameters>();
+		Params->Atlas = AtlasParameters;
+		Params->NumGroups = GroupCount;
+		Params->VelocityBounds = Velocity.Bounds;
+		Params->WorldToGrid = WorldToGrid;
+		Params->velocityIn = GraphBuilder.CreateSRV(NewVelocity);
+		Params->residualOut = GraphBuilder.CreateUAV(Partials);
+
+		FFireShaderVelocityMaxCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FFireShaderBaseCS::FAtlasDim>(bAtlas);
+		TShaderMapRef<FFireShaderVelocityMaxCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Velocity Max"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	{
+		FFireShaderResidualReduceCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderResidualReduceCS::FParameters>();
+		Params->NumPartials = NumPartials;
+		Params->residualIn = GraphBuilder.CreateSRV(Partials);
+		Params->residualOut = GraphBuilder.CreateUAV(Result);
+
+		TShaderMapRef<FFireShaderResidualReduceCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Velocity Max Reduce"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, FIntVector(1, 1, 1));
+			});
+	}
+
+	if (!Entry->Readback)
+	{
+		Entry->Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("FireSimulation.VelocityMaxReadback"));
+	}
+	AddEnqueueCopyPass(GraphBuilder, Entry->Readback.Get(), Result, sizeof(FVector4f));
+	Entry->Step = StepIndex;
+	Entry->bPending = true;
+}
+
+void FFireSimulationContext::ReadbackVelocityMax()
+{
+	for (FVelocityReadback& Entry : VelocityReadbacks)
+	{
+		if (!Entry.bPending || !Entry.Readback->IsReady())
+		{
+			continue;
+		}
+
+		const FVector4f Result = *static_cast<const FVector4f*>(Entry.Readback->Lock(sizeof(FVector4f)));
+		Entry.Readback->Unlock();
+		Entry.bPending = false;
+
+		// readbacks may complete out of order, keep the most recent step
+		if (Entry.Step >= MaxVelocityStep)
+		{
+			MaxCellsPerSecond = Result.Y;
+			MaxVelocityStep = Entry.Step;
+		}
+	}
+}
+
+void FFireSimulationContext::AddFieldReadbackPasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, uint32 FieldStep)
+{
+	if (FieldReadbacks.IsEmpty())
+	{
+		FieldReadbacks.SetNum(NumReadbacks);
+	}
+
+	FFieldReadback* Entry = FieldReadbacks.FindByPredicate([](const FFieldReadback& Readback) { return !Readback.bPending; });
+	const TRefCountPtr<IPooledRenderTarget> VelocityState = GetVelocityState();
+	const TRefCountPtr<IPooledRenderTarget> FluidState = GetFluidState();
+	if (!Entry || !VelocityState.IsValid() || !FluidState.IsValid())
+	{
+		return;
+	}
+
+	const int32 Factor = GetFieldReadbackDownsample();
+	const FIntVector Resolution = FIntVector::DivideAndRoundUp(Velocity.Resolution, Factor);
+	const int32 NumCells = Resolution.X * Resolution.Y * Resolution.Z;
+	FRDGBufferRef Result = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(FUintVector4), NumCells), TEXT("FireSimulation.Field"));
+
+	{
+		FFireShaderReadbackFieldCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderReadbackFieldCS::FParameters>();
+		Params->Storage = GetStorageParameters(Config);
+		Params->ReadbackBounds = Resolution - FIntVector(1);
+		Params->ReadbackFactor = Factor;
+		Params->VelocityScroll = VelocityScroll;
+		Params->FluidScroll = VelocityScroll * FMath::RoundToInt32(TScale.X);
+		Params->RcpVelocitySize = Velocity.RcpSize;
+		Params->TScale = TScale;
+		Params->VelocityBounds = Velocity.Bounds;
+		Params->FluidBounds = Fluid.Bounds;
+		Params->_LinearClamp = GetGridSampler();
+		Params->velocityIn = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalTexture(VelocityState));
+		Params->fluidDataIn = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalTexture(FluidState));
+		Params->readbackOut = GraphBuilder.CreateUAV(Result);
+
+		TShaderMapRef<FFireShaderReadbackFieldCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		const FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(Resolution, THREAD_COUNT);
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Field Readback %dx%dx%d", Resolution.X, Resolution.Y, Resolution.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	if (!Entry->Readback)
+	{
+		Entry->Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("FireSimulation.FieldReadback"));
+	}
+	AddEnqueueCopyPass(GraphBuilder, Entry->Readback.Get(), Result, NumCells * sizeof(FUintVector4));
+
+	FFireFieldSnapshot& Snapshot = Entry->Snapshot;
+	Snapshot.Resolution = Resolution;
+	Snapshot.GridOrigin = GridOrigin;
+	Snapshot.Size = FVector(LocalSize);
+	Snapshot.CellSize = FVector(LocalSize) * Factor / FVector(Velocity.Resolution);
+	Snapshot.Step = FieldStep;
+	Snapshot.Time = FPlatformTime::Seconds();
+	Entry->bPending = true;
+}
+
+void FFireSimulationContext::ReadbackField()
+{
+	for (FFieldReadback& Entry : FieldReadbacks)
+	{
+		if (!Entry.bPending || !Entry.Readback->IsReady())
+		{
+			continue;
+		}
+		Entry.bPending = false;
+
+		// the cells are decoded into a new snapshot, queries keep the one they hold until they are done
+		TSharedRef<FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FFireFieldSnapshot, ESPMode::ThreadSafe>(Entry.Snapshot);
+		const int32 NumCells = Snapshot->Resolution.X * Snapshot->Resolution.Y * Snapshot->Resolution.Z;
+		Snapshot->Fluid.SetNumUninitialized(NumCells);
+		Snapshot->Velocity.SetNumUninitialized(NumCells);
+
+		const auto Unpack = [](uint32 Packed, int32 Half)
+		{
+			FFloat16 Value;
+			Value.Encoded = uint16(Packed >> (Half * 16));
+			return Value.GetFloat();
+		};
+		const FUintVector4* Cells = static_cast<const FUintVector4*>(Entry.Readback->Lock(NumCells * sizeof(FUintVector4)));
+		for (int32 Index = 0; Index < NumCells; ++Index)
+		{
+			const FUintVector4& Cell = Cells[Index];
+			Snapshot->Fluid[Index] = FVector4f(Unpack(Cell.X, 0), Unpack(Cell.X, 1), Unpack(Cell.Y, 0), 0.0f);
+			Snapshot->Velocity[Index] = FVector3f(Unpack(Cell.Y, 1), Unpack(Cell.Z, 0), Unpack(Cell.Z, 1));
+		}
+		Entry.Readback->Unlock();
+
+		// readbacks may complete out of order, the field keeps the most recent step
+		Field->Publish(Snapshot);
+	}
+}
+
+int32 FFireSimulationContext::ComputeSubSteps(float TimeStep, const FFireSimulationConfig& Config) const
+{
+	if (!Config.bAdaptiveSubSteps)
+	{
+		return 1;
+	}
+	const int32 MaxSubSteps = FMath::Max(Config.MaxSubSteps, 1);
+
+	// a diverged simulation reports inf or nan, it gets the full budget
+	const float Cells = TimeStep * MaxCellsPerSecond;
+	if (!FMath::IsFinite(Cells))
+	{
+		return MaxSubSteps;
+	}
+	return FMath::Clamp(FMath::CeilToInt32(Cells / FMath::Max(Config.CflNumber, UE_KINDA_SMALL_NUMBER)), 1, MaxSubSteps);
+}
+
+void FFireSimulationContext::AdaptPressureIterations(const FFireSimulationConfig& Config)
+{
+	const int32 MinIterations = FMath::Max(Config.MinPressureIterations, 0);
+	const int32 MaxIterations = FMath::Max(Config.MaxPressureIterations, MinIterations);
+	if (PressureIterations == INDEX_NONE)
+	{
+		PressureIterations = Config.NumPressureIterations;
+	}
+	PressureIterations = FMath::Clamp(PressureIterations, MinIterations, MaxIterations);
+
+	// only residuals measured with the current count say something about it, older readbacks are still in flight
+	if (!Config.bAdaptivePressureIterations || PressureResidual.Step <= AdaptedStep || PressureResidual.Iterations != PressureIterations
+		|| PressureResidual.Solver != EFirePressureSolver::Jacobi)
+	{
+		return;
+	}
+	AdaptedStep = PressureResidual.Step;
+
+	// grow fast to catch up with violent fires, shrink slowly to avoid oscillating around the target
+	if (PressureResidual.Rms > Config.PressureResidualTarget)
+	{
+		PressureIterations = FMath::Min(MaxIterations, FMath::Max(PressureIterations + 1, FMath::CeilToInt32(PressureIterations * 1.5f)));
+	}
+	else if (PressureResidual.Rms < Config.PressureResidualTarget * 0.5f)
+	{
+		PressureIterations = FMath::Max(MinIterations, PressureIterations - 1);
+	}
+}
+
+FFireObstacleParameters FFireSimulationContext::AddObstaclePasses(FRDGBuilder& GraphBuilder, FRDGTextureRef ObstaclesTexture, FRDGTextureRef DynamicTexture,
+	FRDGBufferRef DynamicBricks, int32 NumDynamicBricks)
+{
+	// the obstacle texture has the velocity resolution, also in an atlas
+	const FIntVector BrickCount = Velocity.ThreadCount;
+	const int32 NumBricks = BrickCount.X * BrickCount.Y * BrickCount.Z;
+	if (!DynamicTexture)
+	{
+		DynamicTexture = GSystemTextures.GetVolumetricBlackDummy(GraphBuilder);
+	}
+
+	// with a brick list one group packs each of its bricks, otherwise one group packs each brick of the texture
+	const auto AddPackPass = [&](FRDGBufferRef Mask, FRDGBufferRef Bricks, FRDGBufferRef BrickList, const FIntVector& GroupCount)
+	{
+		FFireShaderPackObstaclesCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderPackObstaclesCS::FParameters>();
+		Params->ObstacleBrickCount = BrickCount;
+		Params->PackBrickList = BrickList ? 1 : 0;
+		Params->obstaclesIn = GraphBuilder.CreateSRV(ObstaclesTexture);
+		Params->dynamicObstaclesIn = GraphBuilder.CreateSRV(DynamicTexture);
+		Params->dynamicBricksIn = GraphBuilder.CreateSRV(BrickList ? BrickList : GSystemTextures.GetDefaultStructuredBuffer(GraphBuilder, sizeof(FUintVector4)));
+		Params->obstacleMaskOut = GraphBuilder.CreateUAV(Mask, PF_R32_UINT);
+		Params->obstacleBricksOut = GraphBuilder.CreateUAV(Bricks, PF_R32_UINT);
+
+		TShaderMapRef<FFireShaderPackObstaclesCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Pack Obstacles %d bricks", GroupCount.X * GroupCount.Y * GroupCount.Z),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	};
+
+	FRDGBufferRef Mask;
+	FRDGBufferRef Bricks;
+	if (bObstaclesDirty || !ObstacleMask.IsValid())
+	{
+		Mask = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), NumBricks * FFireShaderPackObstaclesCS::BrickWords), TEXT("FireSimulation.ObstacleMask"));
+		Bricks = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), NumBricks), TEXT("FireSimulation.ObstacleBricks"));
+		AddPackPass(Mask, Bricks, nullptr, BrickCount);
+
+		GraphBuilder.QueueBufferExtraction(Mask, &ObstacleMask);
+		GraphBuilder.QueueBufferExtraction(Bricks, &ObstacleBricks);
+		bObstaclesDirty = false;
+	}
+	else
+	{
+		Mask = GraphBuilder.RegisterExternalBuffer(ObstacleMask);
+		Bricks = GraphBuilder.RegisterExternalBuffer(ObstacleBricks);
+
+		// only the bricks the moving bodies covered now or at their last update can have changed
+		if (DynamicBricks)
+		{
+			AddPackPass(Mask, Bricks, DynamicBricks, FIntVector(NumDynamicBricks, 1, 1));
+		}
+	}
+
+	FFireObstacleParameters Parameters;
+	Parameters.ObstacleBrickCount = BrickCount;
+	Parameters.obstacleMaskIn = GraphBuilder.CreateSRV(Mask, PF_R32_UINT);
+	Parameters.obstacleBricksIn = GraphBuilder.CreateSRV(Bricks, PF_R32_UINT);
+	Parameters.dynamicObstaclesIn = GraphBuilder.CreateSRV(DynamicTexture);
+	return Parameters;
+}
+
+/** Texel ranges of the local cells [Min, Max] along one axis of a scrolling grid, the range splits where it wraps */
+static int32 GetTexelRanges(int32 Min, int32 Max, int32 Scroll, int32 Resolution, FIntPoint (&OutRanges)[2])
+{
+	const int32 Start = (Min + Scroll) % Resolution;
+	const int32 End = Start + Max - Min;
+	if (End < Resolution)
+	{
+		OutRanges[0] = FIntPoint(Start, End);
+		return 1;
+	}
+	OutRanges[0] = FIntPoint(Start, Resolution - 1);
+	OutRanges[1] = FIntPoint(0, End - Resolution);
+	return 2;
+}
+
+FRDGBufferRef FFireSimulationContext::AddDynamicObstaclePasses(FRDGBuilder& GraphBuilder, FRDGTextureRef& OutTexture, int32& OutNumBricks)
+{
+	OutTexture = DynamicObstacles.IsValid() ? GraphBuilder.RegisterExternalTexture(DynamicObstacles) : nullptr;
+	OutNumBricks = 0;
+	if (!bDynamicObstaclesPending)
+	{
+		return nullptr;
+	}
+	bDynamicObstaclesPending = false;
+	const FFireDynamicObstacles Obstacles = MoveTemp(PendingDynamicObstacles);
+	if (Obstacles.Shapes.IsEmpty() && !DynamicObstacles.IsValid())
+	{
+		return nullptr;
+	}
+
+	const FIntVector BrickCount = Velocity.ThreadCount;
+	const int32 NumBricks = BrickCount.X * BrickCount.Y * BrickCount.Z;
+	if (DynamicObstacleBricks.Num() != NumBricks)
+	{
+		DynamicObstacleBricks.Init(false, NumBricks);
+	}
+
+	// shapes per brick of the texture, a scrolling grid wraps the box of a shape into up to eight boxes of texels
+	const FVector CellSize = FVector(LocalSize) / FVector(Velocity.Resolution);
+	TMap<int32, TArray<int32, TInlineAllocator<4>>> BrickShapes;
+	TBitArray<> CoveredBricks(false, NumBricks);
+	for (int32 ShapeIndex = 0; ShapeIndex < Obstacles.Shapes.Num(); ++ShapeIndex)
+	{
+		const FBox& Bounds = Obstacles.ShapeBounds[ShapeIndex];
+		const FVector MinCell = (Bounds.Min - Obstacles.GridOrigin) / CellSize;
+		const FVector MaxCell = (Bounds.Max - Obstacles.GridOrigin) / CellSize;
+		FIntPoint Ranges[3][2];
+		int32 NumRanges[3];
+		bool bInside = true;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const int32 Min = FMath::Max(FMath::FloorToInt32(MinCell[Axis]), 0);
+			const int32 Max = FMath::Min(FMath::FloorToInt32(MaxCell[Axis]), Velocity.Bounds[Axis]);
+			bInside &= Min <= Max;
+			NumRanges[Axis] = bInside ? GetTexelRanges(Min, Max, VelocityScroll[Axis], Velocity.Resolution[Axis], Ranges[Axis]) : 0;
+		}
+		if (!bInside)
+		{
+			continue;
+		}
+
+		for (int32 RangeZ = 0; RangeZ < NumRanges[2]; ++RangeZ)
+		for (int32 RangeY = 0; RangeY < NumRanges[1]; ++RangeY)
+		for (int32 RangeX = 0; RangeX < NumRanges[0]; ++RangeX)
+		{
+			for (int32 Z = Ranges[2][RangeZ].X / 8; Z <= Ranges[2][RangeZ].Y / 8; ++Z)
+			for (int32 Y = Ranges[1][RangeY].X / 8; Y <= Ranges[1][RangeY].Y / 8; ++Y)
+			for (int32 X = Ranges[0][RangeX].X / 8; X <= Ranges[0][RangeX].Y / 8; ++X)
+			{
+				const int32 Brick = (Z * BrickCount.Y + Y) * BrickCount.X + X;
+				TArray<int32, TInlineAllocator<4>>& Shapes = BrickShapes.FindOrAdd(Brick);
+				if (Shapes.IsEmpty() || Shapes.Last() != ShapeIndex)
+				{
+					Shapes.Add(ShapeIndex);
+				}
+				CoveredBricks[Brick] = true;
+			}
+		}
+	}
+
+	// bricks the bodies left are cleared by rasterizing no shapes into them
+	TArray<FUintVector4> Bricks;
+	TArray<uint32> ShapeIndices;
+	const TBitArray<> DirtyBricks = TBitArray<>::BitwiseOR(CoveredBricks, DynamicObstacleBricks, EBitwiseOperatorFlags::MaxSize);
+	for (TConstSetBitIterator<> It(DirtyBricks); It; ++It)
+	{
+		const int32 Brick = It.GetIndex();
+		const FIntVector Coord(Brick % BrickCount.X, (Brick / BrickCount.X) % BrickCount.Y, Brick / (BrickCount.X * BrickCount.Y));
+		const TArray<int32, TInlineAllocator<4>>* Shapes = BrickShapes.Find(Brick);
+		Bricks.Add(FUintVector4(uint32(Coord.X) | (uint32(Coord.Y) << 10) | (uint32(Coord.Z) << 20), ShapeIndices.Num(), Shapes ? Shapes->Num() : 0, 0));
+		if (Shapes)
+		{
+			ShapeIndices.Append(*Shapes);
+		}
+	}
+	DynamicObstacleBricks = MoveTemp(CoveredBricks);
+	if (Bricks.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	FRDGTextureRef DynamicTexture = OutTexture;
+	if (!DynamicTexture)
+	{
+		DynamicTexture = GraphBuilder.CreateTexture(CreateTextureDesc(Velocity.Resolution, PF_FloatRGBA), TEXT("FireSimulation.DynamicObstacles"));
+
+		FFireShaderClearFloat4CS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloat4CS::FParameters>();
+		Params->outputFloat4 = GraphBuilder.CreateUAV(DynamicTexture);
+
+		const auto GroupCount = Velocity.ThreadCount;
+		TShaderMapRef<FFireShaderClearFloat4CS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Clear DynamicObstacles"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+		GraphBuilder.QueueTextureExtraction(DynamicTexture, &DynamicObstacles);
+		OutTexture = DynamicTexture;
+	}
+
+	TArray<FFireObstacleShape> Shapes = Obstacles.Shapes;
+	TArray<FVector4f> Planes = Obstacles.Planes;
+	Shapes.SetNum(FMath::Max(Shapes.Num(), 1));
+	Planes.SetNum(FMath::Max(Planes.Num(), 1));
+	ShapeIndices.SetNum(FMath::Max(ShapeIndices.Num(), 1));
+	FRDGBufferRef BrickBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.DynamicBricks"), Bricks);
+
+	FFireShaderDynamicObstaclesCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderDynamicObstaclesCS::FParameters>();
+	Params->DynamicBounds = Velocity.Bounds;
+	Params->DynamicScroll = VelocityScroll;
+	Params->DynamicOrigin = FVector3f(Obstacles.GridOrigin);
+	Params->DynamicCellSize = FVector3f(CellSize);
+	Params->dynamicBricksIn = GraphBuilder.CreateSRV(BrickBuffer);
+	Params->dynamicShapeIndicesIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.DynamicShapeIndices"), ShapeIndices));
+	Params->dynamicShapesIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.DynamicShapes"), Shapes));
+	Params->dynamicPlanesIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.DynamicPlanes"), Planes));
+	Params->dynamicObstaclesOut = GraphBuilder.CreateUAV(DynamicTexture);
+
+	const FIntVector GroupCount(Bricks.Num(), 1, 1);
+	TShaderMapRef<FFireShaderDynamicObstaclesCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("Dynamic Obstacles %d shapes %d bricks", Obstacles.Shapes.Num(), Bricks.Num()),
+		Params,
+		ERDGPassFlags::AsyncCompute,
+		[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+		{
+			FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+		});
+
+	OutNumBricks = Bricks.Num();
+	return BrickBuffer;
+}
+
+FRDGTextureRef FFireSimulationContext::AddEmitterPasses(FRDGBuilder& GraphBuilder)
+{
+	const FFireEmitterBatch Batch = MoveTemp(PendingEmitters);
+	if (Batch.Emitters.IsEmpty() && EmitterBricks.Find(true) == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	const FIntVector BrickCount = Velocity.ThreadCount;
+	const int32 NumBricks = BrickCount.X * BrickCount.Y * BrickCount.Z;
+	if (EmitterBricks.Num() != NumBricks)
+	{
+		EmitterBricks.Init(false, NumBricks);
+	}
+
+	// emitters per brick by a counting sort, the bounds grow by the one cell footprint of points and of shape edges
+	const FVector CellSize = FVector(LocalSize) / FVector(Velocity.Resolution);
+	TArray<FFireEmitterRecord> Records;
+	TArray<FIntVector> BrickRanges;
+	TArray<uint32> Counts;
+	Counts.SetNumZeroed(NumBricks);
+	for (const FFireEmitter& Emitter : Batch.Emitters)
+	{
+		FBox Bounds;
+		const FFireEmitterRecord Record = FireSimulationEmitters::MakeRecord(Emitter, Batch.GridOrigin, Bounds);
+		const FVector MinCell = (Bounds.Min - CellSize) / CellSize;
+		const FVector MaxCell = (Bounds.Max + CellSize) / CellSize;
+		FIntVector MinBrick;
+		FIntVector MaxBrick;
+		bool bInside = true;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const int32 Min = FMath::Max(FMath::FloorToInt32(MinCell[Axis]), 0);
+			const int32 Max = FMath::Min(FMath::FloorToInt32(MaxCell[Axis]), Velocity.Bounds[Axis]);
+			bInside &= Min <= Max;
+			MinBrick[Axis] = Min / 8;
+			MaxBrick[Axis] = Max / 8;
+		}
+		if (!bInside)
+		{
+			continue;
+		}
+
+		for (int32 Z = MinBrick.Z; Z <= MaxBrick.Z; ++Z)
+		for (int32 Y = MinBrick.Y; Y <= MaxBrick.Y; ++Y)
+		for (int32 X = MinBrick.X; X <= MaxBrick.X; ++X)
+		{
+			++Counts[(Z * BrickCount.Y + Y) * BrickCount.X + X];
+		}
+		Records.Add(Record);
+		BrickRanges.Add(MinBrick);
+		BrickRanges.Add(MaxBrick);
+	}
+
+	TArray<uint32> First;
+	First.SetNumUninitialized(NumBricks);
+	TBitArray<> CoveredBricks(false, NumBricks);
+	uint32 NumIndices = 0;
+	for (int32 Brick = 0; Brick < NumBricks; ++Brick)
+	{
+		First[Brick] = NumIndices;
+		NumIndices += Counts[Brick];
+		CoveredBricks[Brick] = Counts[Brick] > 0;
+	}
+
+	TArray<uint32> Indices;
+	Indices.SetNumUninitialized(FMath::Max<uint32>(NumIndices, 1));
+	TArray<uint32> Filled;
+	Filled.SetNumZeroed(NumBricks);
+	for (int32 Index = 0; Index < Records.Num(); ++Index)
+	{
+		const FIntVector& MinBrick = BrickRanges[Index * 2];
+		const FIntVector& MaxBrick = BrickRanges[Index * 2 + 1];
+		for (int32 Z = MinBrick.Z; Z <= MaxBrick.Z; ++Z)
+		for (int32 Y = MinBrick.Y; Y <= MaxBrick.Y; ++Y)
+		for (int32 X = MinBrick.X; X <= MaxBrick.X; ++X)
+		{
+			const int32 Brick = (Z * BrickCount.Y + Y) * BrickCount.X + X;
+			Indices[First[Brick] + Filled[Brick]++] = Index;
+		}
+	}
+
+	// bricks the emitters left are cleared by splatting no emitters into them
+	TArray<FUintVector4> Bricks;
+	const TBitArray<> DirtyBricks = TBitArray<>::BitwiseOR(CoveredBricks, EmitterBricks, EBitwiseOperatorFlags::MaxSize);
+	for (TConstSetBitIterator<> It(DirtyBricks); It; ++It)
+	{
+		const int32 Brick = It.GetIndex();
+		const FIntVector Coord(Brick % BrickCount.X, (Brick / BrickCount.X) % BrickCount.Y, Brick / (BrickCount.X * BrickCount.Y));
+		Bricks.Add(FUintVector4(uint32(Coord.X) | (uint32(Coord.Y) << 10) | (uint32(Coord.Z) << 20), First[Brick], Counts[Brick], 0));
+	}
+	const bool bEmitting = CoveredBricks.Find(true) != INDEX_NONE;
+	EmitterBricks = MoveTemp(CoveredBricks);
+	if (Bricks.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	FRDGTextureRef EmitterTexture;
+	if (!Emitters.IsValid())
+	{
+		EmitterTexture = GraphBuilder.CreateTexture(CreateTextureDesc(Velocity.Resolution, PF_FloatRGBA), TEXT("FireSimulation.Emitters"));
+
+		FFireShaderClearFloat4CS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloat4CS::FParameters>();
+		Params->outputFloat4 = GraphBuilder.CreateUAV(EmitterTexture);
+
+		const auto GroupCount = Velocity.ThreadCount;
+		TShaderMapRef<FFireShaderClearFloat4CS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Clear Emitters"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+		GraphBuilder.QueueTextureExtraction(EmitterTexture, &Emitters);
+	}
+	else
+	{
+		EmitterTexture = GraphBuilder.RegisterExternalTexture(Emitters);
+	}
+
+	// the bricks of a sparse grid are built from the content marked by the previous step, emitters add theirs before the update
+	const bool bMarkContent = Layout.bSparse && SparseBrickContent.IsValid();
+	FRDGBufferRef Content = bMarkContent ? GraphBuilder.RegisterExternalBuffer(SparseBrickContent)
+		: GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), 1), TEXT("FireSimulation.EmitterContent"));
+
+	const int32 NumRecords = Records.Num();
+	Records.SetNum(FMath::Max(NumRecords, 1));
+
+	FFireShaderAddEmitterCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderAddEmitterCS::FParameters>();
+	Params->EmitterBounds = Velocity.Bounds;
+	Params->EmitterCellSize = FVector3f(CellSize);
+	Params->EmitterMarkContent = bMarkContent ? 1 : 0;
+	Params->SparseBrickCount = BrickCount;
+	Params->emitterBricksIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.EmitterBricks"), Bricks));
+	Params->emitterIndicesIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.EmitterIndices"), Indices));
+	Params->emittersIn = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("FireSimulation.Emitters"), Records));
+	Params->SparseContentOut = GraphBuilder.CreateUAV(Content, PF_R32_UINT);
+	Params->emitterOut = GraphBuilder.CreateUAV(EmitterTexture);
+
+	const FIntVector GroupCount(Bricks.Num(), 1, 1);
+	TShaderMapRef<FFireShaderAddEmitterCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("Add Emitters %d emitters %d bricks", NumRecords, Bricks.Num()),
+		Params,
+		ERDGPassFlags::AsyncCompute,
+		[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+		{
+			FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+		});
+
+	return bEmitting ? EmitterTexture : nullptr;
+}
+
+FRDGBufferUAVRef FFireSimulationContext::AddSparsePasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, FFireSparseParameters& OutVelocity, FFireSparseParameters& OutFluid)
+{
+	RDG_EVENT_SCOPE(GraphBuilder, "SparseBricks");
+
+	// a brick is the cell block of one velocity thread group
+	const FIntVector BrickCount = Velocity.ThreadCount;
+	const int32 NumBricks = BrickCount.X * BrickCount.Y * BrickCount.Z;
+
+	// content and state of the bricks persist across steps, new buffers mark every brick active and with content, so the
+	// first step writes every scratch texture and the next one retires and clears the bricks without content
+	const FRDGBufferDesc BrickDesc = FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), NumBricks);
+	FRDGBufferRef BrickContent;
+	FRDGBufferRef BrickState;
+	if (!SparseBrickContent.IsValid())
+	{
+		BrickContent = GraphBuilder.CreateBuffer(BrickDesc, TEXT("FireSimulation.BrickContent"));
+		BrickState = GraphBuilder.CreateBuffer(BrickDesc, TEXT("FireSimulation.BrickState"));
+		AddClearUAVPass(GraphBuilder, GraphBuilder.CreateUAV(BrickContent, PF_R32_UINT), 1u, ERDGPassFlags::AsyncCompute);
+		AddClearUAVPass(GraphBuilder, GraphBuilder.CreateUAV(BrickState, PF_R32_UINT), 1u, ERDGPassFlags::AsyncCompute);
+		GraphBuilder.QueueBufferExtraction(BrickContent, &SparseBrickContent);
+		GraphBuilder.QueueBufferExtraction(BrickState, &SparseBrickState);
+	}
+	else
+	{
+		BrickContent = GraphBuilder.RegisterExternalBuffer(SparseBrickContent);
+		BrickState = GraphBuilder.RegisterExternalBuffer(SparseBrickState);
+	}
+
+	FRDGBufferRef ActiveBricks = GraphBuilder.CreateBuffer(BrickDesc, TEXT("FireSimulation.ActiveBricks"));
+	FRDGBufferRef RetiredBricks = GraphBuilder.CreateBuffer(BrickDesc, TEXT("FireSimulation.RetiredBricks"));
+	FRDGBufferRef Counters = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), 2), TEXT("FireSimulation.BrickCounters"));
+	// velocity and fluid arguments of the active and the retired bricks
+	FRDGBufferRef Args = GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateIndirectDesc<FRHIDispatchIndirectParameters>(4), TEXT("FireSimulation.BrickArgs"));
+
+	FRDGBufferUAVRef CountersUAV = GraphBuilder.CreateUAV(Counters, PF_R32_UINT);
+	AddClearUAVPass(GraphBuilder, CountersUAV, 0u, ERDGPassFlags::AsyncCompute);
+
+	// Update bricks
+	{
+		FFireShaderSparseUpdateBricksCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderSparseUpdateBricksCS::FParameters>();
+		Params->SparseBrickCount = BrickCount;
+		Params->brickContentIn = GraphBuilder.CreateSRV(BrickContent, PF_R32_UINT);
+		Params->brickStateOut = GraphBuilder.CreateUAV(BrickState, PF_R32_UINT);
+		Params->activeBricksOut = GraphBuilder.CreateUAV(ActiveBricks, PF_R32_UINT);
+		Params->retiredBricksOut = GraphBuilder.CreateUAV(RetiredBricks, PF_R32_UINT);
+		Params->brickCountersOut = CountersUAV;
+
+		const FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(NumBricks, 64);
+		TShaderMapRef<FFireShaderSparseUpdateBricksCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Update Bricks"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	// Build arguments
+	{
+		FFireShaderSparseBuildArgsCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderSparseBuildArgsCS::FParameters>();
+		Params->SparseFluidScale = FMath::RoundToInt32(TScale.X);
+		Params->brickCountersIn = GraphBuilder.CreateSRV(Counters, PF_R32_UINT);
+		Params->brickArgsOut = GraphBuilder.CreateUAV(Args, PF_R32_UINT);
+
+		TShaderMapRef<FFireShaderSparseBuildArgsCS> Shader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Build Brick Arguments"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader](FRHIComputeCommandList& RHICmdList)
+			{
+				FComputeShaderUtils::Dispatch(RHICmdList, Shader, *Params, FIntVector(1, 1, 1));
+			});
+	}
+
+	OutVelocity.SparseBrickCount = BrickCount;
+	OutVelocity.SparseFluidScale = FMath::RoundToInt32(TScale.X);
+	OutVelocity.SparseThreshold = Config.SparseThreshold;
+	OutVelocity.SparseBricks = GraphBuilder.CreateSRV(ActiveBricks, PF_R32_UINT);
+	OutVelocity.SparseArgs = Args;
+	OutVelocity.SparseArgsOffset = 0;
+
+	OutFluid = OutVelocity;
+	OutFluid.SparseArgsOffset = 2 * sizeof(FRHIDispatchIndirectParameters);
+
+	FFireSparseParameters RetiredVelocity = OutVelocity;
+	RetiredVelocity.SparseBricks = GraphBuilder.CreateSRV(RetiredBricks, PF_R32_UINT);
+	RetiredVelocity.SparseArgsOffset = sizeof(FRHIDispatchIndirectParameters);
+
+	FFireSparseParameters RetiredFluid = RetiredVelocity;
+	RetiredFluid.SparseArgsOffset = 3 * sizeof(FRHIDispatchIndirectParameters);
+
+	// clear the retired bricks in every texture, neighbors of active bricks are read as zero
+	FFireShaderPermutation Permutation;
+	Permutation.bSparse = true;
+
+	const int32 Velocity4Textures[] = { Scratch.VelocityIn, Scratch.TmpVelocity4[0], Scratch.TmpVelocity4[1], Scratch.TmpVelocity4[2], Scratch.Vorticity, Scratch.VelocityOut };
+	for (const int32 Handle : Velocity4Textures)
+	{
+		if (Handle == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FFireShaderClearFloat4CS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloat4CS::FParameters>();
+		Params->Sparse = RetiredVelocity;
+		Params->outputFloat4 = GraphBuilder.CreateUAV(ScratchPool.Get(Handle));
+
+		const auto GroupCount = Velocity.ThreadCount;
+		TShaderMapRef<FFireShaderClearFloat4CS> Shader = Permutation.Get<FFireShaderClearFloat4CS>();
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Clear Retired Bricks"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	const int32 Velocity1Textures[] = { Scratch.PressureState, Scratch.Divergence, Scratch.Pressure[0], Scratch.Pressure[1] };
+	for (const int32 Handle : Velocity1Textures)
+	{
+		if (Handle == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FFireShaderClearFloatCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFloatCS::FParameters>();
+		Params->Sparse = RetiredVelocity;
+		Params->outputFloat = GraphBuilder.CreateUAV(ScratchPool.Get(Handle));
+
+		const auto GroupCount = Velocity.ThreadCount;
+		TShaderMapRef<FFireShaderClearFloatCS> Shader = Permutation.Get<FFireShaderClearFloatCS>();
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Clear Retired Bricks"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	const int32 FluidTextures[] = { Scratch.FluidIn, Scratch.Phi[0], Scratch.Phi[1], Scratch.TmpFluid4[0], Scratch.TmpFluid4[1] };
+	for (const int32 Handle : FluidTextures)
+	{
+		if (Handle == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FFireShaderClearFluidCS::FParameters* Params = GraphBuilder.AllocParameters<FFireShaderClearFluidCS::FParameters>();
+		Params->Sparse = RetiredFluid;
+		Params->outputFloat4 = GraphBuilder.CreateUAV(ScratchPool.Get(Handle));
+
+		const auto GroupCount = Fluid.ThreadCount;
+		TShaderMapRef<FFireShaderClearFluidCS> Shader = Permutation.Get<FFireShaderClearFluidCS>();
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Clear Retired Bricks"),
+			Params,
+			ERDGPassFlags::AsyncCompute,
+			[Params, Shader, GroupCount](FRHIComputeCommandList& RHICmdList)
+			{
+				DispatchFireShader(RHICmdList, Shader, *Params, GroupCount);
+			});
+	}
+
+	// the simulation of this step marks the content the bricks of the next step are built from
+	FRDGBufferUAVRef ContentUAV = GraphBuilder.CreateUAV(BrickContent, PF_R32_UINT);
+	AddClearUAVPass(GraphBuilder, ContentUAV, 0u, ERDGPassFlags::AsyncCompute);
+	return ContentUAV;
+}
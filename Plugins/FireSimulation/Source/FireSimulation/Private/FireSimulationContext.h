@@ -0,0 +1,352 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireScratchPool.h"
+#include "FireSimulationCommandQueue.h"
+#include "FireSimulationConfig.h"
+#include "FireSimulationDynamicObstacles.h"
+#include "FireSimulationEmitterBatch.h"
+#include "FireSimulationField.h"
+#include "RendererInterface.h"
+#include "RenderGraphFwd.h"
+#include <atomic>
+
+class FFireSimulationAtlas;
+class FRHIGPUBufferReadback;
+struct FFireAtlasParameters;
+struct FFireImpulseParameters;
+struct FFireObstacleParameters;
+struct FFireSparseParameters;
+
+/** Slots of an atlas that are simulated by one AddPasses call */
+struct FFireSimulationAtlasBinding
+{
+	FRDGBufferSRVRef Bricks = nullptr;
+	/** Bricks whose slots are cleared before the step, null if there are none */
+	FRDGBufferSRVRef ResetBricks = nullptr;
+	FIntVector Slots = FIntVector::ZeroValue;
+	int32 SlotSize = 0;
+	int32 FluidSlotSize = 0;
+	FIntVector VelocityGroupCount = FIntVector::ZeroValue;
+	FIntVector FluidGroupCount = FIntVector::ZeroValue;
+};
+
+/** Residual of the pressure solve, measured when r.FireSimulation.PressureResidual is enabled */
+struct FFirePressureResidual
+{
+	/** Root mean square and maximum of the residual over all fluid cells */
+	float Rms = 0.0f;
+	float Max = 0.0f;
+	int32 NumFluidCells = 0;
+	/** Step the residual was measured in, the readback lags a few steps behind */
+	uint32 Step = 0;
+	EFirePressureSolver Solver = EFirePressureSolver::Jacobi;
+	/** Jacobi iterations or V-cycles of the measured step */
+	int32 Iterations = 0;
+};
+
+/**
+ * Simulation state of a single fire volume.
+ * Initialize is called on the game thread, AddPasses records one simulation step into a graph owned by the caller.
+ * A context that lives in an atlas slot has no textures of its own and is stepped by its atlas.
+ */
+class FFireSimulationContext
+{
+public:
+	FFireSimulationContext();
+	~FFireSimulationContext();
+
+	/** Velocity resolution of a volume, snapped to the sizes the simulation supports */
+	static FIntVector ComputeResolution(const FVector& Size, const FFireSimulationConfig& Config);
+	/** GPU memory a standalone volume of this resolution plans for its textures and buffers */
+	static uint64 EstimateBytes(const FIntVector& Resolution, int32 FluidResolutionScale, const FFireSimulationConfig& Config);
+	/** r.FireSimulation.MemoryBudgetMB in bytes, 0 without a budget */
+	static uint64 GetMemoryBudgetBytes();
+	/** r.FireSimulation.FieldReadbackInterval and r.FireSimulation.FieldReadbackDownsample clamped to 1..8, any thread */
+	static int32 GetFieldReadbackInterval();
+	static int32 GetFieldReadbackDownsample();
+
+	/**
+	 * ReservedBytes is the memory of all other volumes. A volume that does not fit into the rest of the memory budget lowers
+	 * its fluid resolution scale first and then its resolution, down to the smallest grid.
+	 */
+	void Initialize(const FVector& Size, const FFireSimulationConfig& Config, uint64 ReservedBytes = 0);
+	void InitializeResolution(const FIntVector& Resolution, int32 FluidResolutionScale, const FVector& Size);
+	/** Initializes the next coarser level of a cascade, the resolution of Finer at twice its size, see FFireSimulationCascade */
+	void InitializeCoarser(const FFireSimulationContext& Finer, const FFireSimulationConfig& Config);
+	/**
+	 * Moves a standalone volume to another velocity resolution before its next step. Velocity, fluid, warm start pressure
+	 * and obstacles are resampled to the new grid on the GPU. Rendering thread only.
+	 */
+	void AddResamplePasses(FRDGBuilder& GraphBuilder, const FIntVector& Resolution);
+	/**
+	 * Moves a scrolling volume so that its grid starts at the world cell InGridCell, see FFireSimulationConfig::bScrolling.
+	 * Only the offset of the wrapped addressing changes, the cells that enter the grid are cleared. Rendering thread only.
+	 */
+	void AddScrollPasses(FRDGBuilder& GraphBuilder, const FIntVector& InGridCell);
+	/**
+	 * Solid cells of the voxelized static geometry, one bit per cell of a grid of Resolution with x fastest. They are added to
+	 * the obstacles before the next step of a standalone volume. Rendering thread only.
+	 */
+	void SetStaticObstacles(TArray<uint32>&& Bits, const FIntVector& Resolution);
+	/**
+	 * Moving bodies of the next step of a standalone volume. Only the bricks they cover in this or the previous update are
+	 * rasterized again. Rendering thread only.
+	 */
+	void SetDynamicObstacles(const FFireDynamicObstacles& Obstacles);
+	/** Emitters of the next step of a standalone volume, splatted in one dispatch and added over its sub-steps. Rendering thread only. */
+	void SetEmitters(const FFireEmitterBatch& Emitters);
+	/** Impulses of the next step of a standalone volume, added over its sub-steps. Rendering thread only. */
+	void SetImpulses(const TArray<FFireImpulse>& Impulses);
+	/** World position of the minimum corner of local cell 0 at the next step of a standalone volume, rendering thread only */
+	void SetGridOrigin(const FVector& InGridOrigin) { GridOrigin = InGridOrigin; }
+	/** CPU copy of the field of a standalone volume, set before its first step */
+	void SetField(const FFireSimulationFieldPtr& InField) { Field = InField; }
+	/** World cell of the grid minimum corner of a scrolling volume centered at Location */
+	FIntVector ComputeGridCell(const FVector& Location) const;
+	/** Grid cell of the last scroll and texel of local cell 0, rendering thread only */
+	const FIntVector& GetGridCell() const { return GridCell; }
+	const FIntVector& GetVelocityScroll() const { return VelocityScroll; }
+	/** Records the sub-steps of one step, see FFireSimulationConfig::bAdaptiveSubSteps */
+	void AddPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, const FFireSimulationAtlasBinding* AtlasBinding = nullptr);
+
+	const FIntVector& GetVelocityResolution() const { return Velocity.Resolution; }
+	/** Resolution chosen by Initialize, LOD levels halve its largest axis down to r.FireSimulation.LodMinResolution */
+	const FIntVector& GetBaseResolution() const { return BaseResolution; }
+	int32 GetNumLodLevels() const;
+	FIntVector GetLodResolution(int32 LodLevel, const FFireSimulationConfig& Config) const;
+	const FVector3f& GetLocalSize() const { return LocalSize; }
+	const FIntVector& GetFluidResolution() const { return Fluid.Resolution; }
+	const FVector3f& GetWorldToGrid() const { return WorldToGrid; }
+	const FVector2f& GetTScale() const { return TScale; }
+	const FFireScratchPool& GetScratchPool() const { return ScratchPool; }
+	/** Memory of the current scratch plan plus the persistent obstacle and brick data, any thread */
+	uint64 GetPlannedBytes() const { return PlannedBytes.load(std::memory_order_relaxed); }
+	/** Latest residual that reached the CPU, rendering thread only */
+	const FFirePressureResidual& GetPressureResidual() const { return PressureResidual; }
+	/** Jacobi iterations chosen by the adaptive iteration count, rendering thread only */
+	int32 GetPressureIterations() const { return PressureIterations; }
+	/** Largest velocity in cells per second that reached the CPU and the sub-steps of the last step, rendering thread only */
+	float GetMaxCellsPerSecond() const { return MaxCellsPerSecond; }
+	int32 GetNumSubSteps() const { return NumSubSteps; }
+	/**
+	 * Fluid state after the last step and, with Config.bInterpolateOutput, the state before its last sub-step. Null before
+	 * the first step. Volumes in an atlas read the state of the atlas context. Rendering thread only.
+	 */
+	TRefCountPtr<IPooledRenderTarget> GetFluidState() const;
+	TRefCountPtr<IPooledRenderTarget> GetPreviousFluidState() const;
+	/** Velocity state after the last step, null before the first step. Rendering thread only. */
+	TRefCountPtr<IPooledRenderTarget> GetVelocityState() const;
+
+	void SetAtlasSlot(const TSharedPtr<FFireSimulationAtlas, ESPMode::ThreadSafe>& InAtlas, int32 InSlot);
+	FFireSimulationAtlas* GetAtlas() const { return Atlas.Get(); }
+	int32 GetAtlasSlot() const { return AtlasSlot; }
+	/** Returns true once after the context was placed into an atlas slot, rendering thread only */
+	bool ConsumeAtlasReset();
+
+	/** Logs the scratch memory per velocity cell of every combination of storage precisions */
+	static void LogStorageReport();
+
+private:
+	struct FBufferDesc
+	{
+		FIntVector Resolution = FIntVector::ZeroValue;
+		FIntVector Bounds = FIntVector::ZeroValue;
+		FVector3f RcpSize = FVector3f::ZeroVector;
+		FIntVector ThreadCount = FIntVector::ZeroValue;
+
+		void Init(FIntVector Res);
+	};
+
+	FVector3f LocalSize = FVector3f::ZeroVector;
+	FIntVector BaseResolution = FIntVector::ZeroValue;
+	/** Scrolling volumes only, the grid starts at GridCell in world cells and local cell 0 lives at texel VelocityScroll */
+	FIntVector GridCell = FIntVector::ZeroValue;
+	FIntVector VelocityScroll = FIntVector::ZeroValue;
+	bool bGridCellValid = false;
+	FVector2f TScale = FVector2f::ZeroVector;
+	FVector3f WorldToGrid = FVector3f::ZeroVector;
+	
+	FBufferDesc Velocity;
+	FBufferDesc Fluid;
+
+	/** Handles of the logical textures of a step, VelocityIn/FluidIn hold the state of the previous step */
+	struct FScratchTextures
+	{
+		int32 VelocityIn = INDEX_NONE;
+		int32 FluidIn = INDEX_NONE;
+		/** Solved pressure of the previous step, the initial guess of a warm started solve */
+		int32 PressureState = INDEX_NONE;
+		int32 Phi[2] = { INDEX_NONE, INDEX_NONE };
+		int32 TmpFluid4[2] = { INDEX_NONE, INDEX_NONE };
+		int32 TmpVelocity4[3] = { INDEX_NONE, INDEX_NONE, INDEX_NONE };
+		int32 Vorticity = INDEX_NONE;
+		int32 Divergence = INDEX_NONE;
+		int32 Pressure[2] = { INDEX_NONE, INDEX_NONE };
+		int32 VelocityOut = INDEX_NONE;
+
+		/** Coarse levels of the multigrid solver, the finest level uses the pressure textures above */
+		struct FMultigridLevel
+		{
+			FIntVector Resolution = FIntVector::ZeroValue;
+			int32 Obstacles = INDEX_NONE;
+			int32 Rhs = INDEX_NONE;
+			int32 Pressure[2] = { INDEX_NONE, INDEX_NONE };
+			int32 Residual = INDEX_NONE;
+		};
+		int32 Residual = INDEX_NONE;
+		/** Obstacles of the finest multigrid level, static and dynamic */
+		int32 MultigridObstacles = INDEX_NONE;
+		TArray<FMultigridLevel, TInlineAllocator<4>> Multigrid;
+	};
+
+	/** Options that change the set of scratch textures of a step */
+	struct FScratchLayout
+	{
+		bool bFused = false;
+		bool bMultigrid = false;
+		bool bWarmStart = false;
+		bool bSparse = false;
+		/** The fluid input lives through the whole step, so that it survives as the previous state */
+		bool bKeepPreviousFluid = false;
+		/** Storage formats of the simulated fields */
+		EPixelFormat VelocityFormat = PF_FloatRGBA;
+		EPixelFormat FluidFormat = PF_FloatRGBA;
+		EPixelFormat PressureFormat = PF_R16F;
+		EPixelFormat DivergenceFormat = PF_R16F;
+
+		void SetStorage(const FFireSimulationConfig& Config);
+
+		bool operator==(const FScratchLayout& Other) const
+		{
+			return bFused == Other.bFused && bMultigrid == Other.bMultigrid && bWarmStart == Other.bWarmStart && bSparse == Other.bSparse
+				&& bKeepPreviousFluid == Other.bKeepPreviousFluid
+				&& VelocityFormat == Other.VelocityFormat && FluidFormat == Other.FluidFormat
+				&& PressureFormat == Other.PressureFormat && DivergenceFormat == Other.DivergenceFormat;
+		}
+		bool operator!=(const FScratchLayout& Other) const { return !(*this == Other); }
+	};
+
+	/** Records a single sub-step, the velocity maximum is measured on the last one */
+	void AddStepPasses(FRDGBuilder& GraphBuilder, float TimeStep, const FFireSimulationConfig& Config, const FFireSimulationAtlasBinding* AtlasBinding, bool bMeasureVelocity,
+		FRDGTextureRef EmitterTexture, const FFireImpulseParameters& ImpulseParameters);
+
+	/** Layout of a step with Config, volumes in an atlas can not run sparse or multigrid steps */
+	static FScratchLayout MakeLayout(const FFireSimulationConfig& Config, bool bAtlas);
+	/** Declares the scratch textures of a step, the fused kernels need fewer intermediate textures */
+	void PlanScratchTextures(const FScratchLayout& InLayout);
+	/** Memory kept across steps outside of the scratch pool */
+	uint64 GetPersistentBytes() const;
+
+	/** Records NumMultigridCycles V-cycles, returns the index of the pressure texture that holds the solution */
+	int32 AddMultigridPasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, const FFireObstacleParameters& ObstacleParameters, FRDGTextureRef Divergence, FRDGTextureRef (&Pressure)[2]);
+
+	/** Reduces the residual of the solved pressure on the GPU and queues its readback */
+	void AddResidualPasses(FRDGBuilder& GraphBuilder, bool bAtlas, const FFireAtlasParameters& AtlasParameters, const FIntVector& GroupCount,
+		const FFireObstacleParameters& ObstacleParameters, FRDGTextureRef Divergence, FRDGTextureRef Pressure, int32 Iterations);
+	void ReadbackResidual();
+
+	/** Reduces the largest velocity of the step on the GPU and queues its readback */
+	void AddVelocityMaxPasses(FRDGBuilder& GraphBuilder, bool bAtlas, const FFireAtlasParameters& AtlasParameters, const FIntVector& GroupCount, FRDGTextureRef NewVelocity);
+	void ReadbackVelocityMax();
+	/** Downsamples the state after the step into a buffer and queues its readback into Field */
+	void AddFieldReadbackPasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, uint32 FieldStep);
+	void ReadbackField();
+	/** Sub-steps that keep the latest velocity maximum within Config.CflNumber cells per sub-step */
+	int32 ComputeSubSteps(float TimeStep, const FFireSimulationConfig& Config) const;
+	/** Moves the Jacobi iteration count towards Config.PressureResidualTarget based on the latest residual */
+	void AdaptPressureIterations(const FFireSimulationConfig& Config);
+
+	/**
+	 * Packs the obstacle texture and the moving bodies into bits and brick summaries when the obstacles changed, or only the
+	 * DynamicBricks list when the moving bodies did. Returns the packed obstacles of the step.
+	 */
+	FFireObstacleParameters AddObstaclePasses(FRDGBuilder& GraphBuilder, FRDGTextureRef ObstaclesTexture, FRDGTextureRef DynamicTexture = nullptr,
+		FRDGBufferRef DynamicBricks = nullptr, int32 NumDynamicBricks = 0);
+	/**
+	 * Rasterizes the pending moving bodies, returns the list of rewritten bricks or null without an update. OutTexture is the
+	 * texture of the moving bodies, null while the volume never had one.
+	 */
+	FRDGBufferRef AddDynamicObstaclePasses(FRDGBuilder& GraphBuilder, FRDGTextureRef& OutTexture, int32& OutNumBricks);
+	/** Splats the pending emitters and marks the sparse bricks they fill, returns the emitter texture or null when nothing is emitted */
+	FRDGTextureRef AddEmitterPasses(FRDGBuilder& GraphBuilder);
+
+	/**
+	 * Builds the active brick list of a sparse step from the content of the previous step and clears the bricks that became
+	 * inactive. Returns the content flags the step marks, the brick lists are returned as velocity and fluid dispatches.
+	 */
+	FRDGBufferUAVRef AddSparsePasses(FRDGBuilder& GraphBuilder, const FFireSimulationConfig& Config, FFireSparseParameters& OutVelocity, FFireSparseParameters& OutFluid);
+
+	FFireScratchPool ScratchPool;
+	FScratchTextures Scratch;
+	FScratchLayout Layout;
+	std::atomic<uint64> PlannedBytes = 0;
+	/** Obstacles as written by the simulation, kernels read the packed mask built from it */
+	TRefCountPtr<IPooledRenderTarget> Obstacles;
+	TRefCountPtr<FRDGPooledBuffer> ObstacleMask;
+	TRefCountPtr<FRDGPooledBuffer> ObstacleBricks;
+	bool bObstaclesDirty = true;
+	/** Static obstacles waiting for the next step, see SetStaticObstacles */
+	TArray<uint32> StaticObstacleBits;
+	FIntVector StaticObstacleResolution = FIntVector::ZeroValue;
+	/** Velocity and coverage of the moving bodies, the bricks they covered at the last update and the pending update */
+	TRefCountPtr<IPooledRenderTarget> DynamicObstacles;
+	TBitArray<> DynamicObstacleBricks;
+	FFireDynamicObstacles PendingDynamicObstacles;
+	bool bDynamicObstaclesPending = false;
+	/** Emitters of the last step in local cells, the bricks they covered and the emitters of the next step */
+	TRefCountPtr<IPooledRenderTarget> Emitters;
+	TBitArray<> EmitterBricks;
+	FFireEmitterBatch PendingEmitters;
+	TArray<FFireImpulse> PendingImpulses;
+	FVector GridOrigin = FVector::ZeroVector;
+	/** Per brick content flags marked by the last step and activity of the last step, sparse layout only */
+	TRefCountPtr<FRDGPooledBuffer> SparseBrickContent;
+	TRefCountPtr<FRDGPooledBuffer> SparseBrickState;
+
+	struct FResidualReadback
+	{
+		TUniquePtr<FRHIGPUBufferReadback> Readback;
+		uint32 Step = 0;
+		EFirePressureSolver Solver = EFirePressureSolver::Jacobi;
+		int32 Iterations = 0;
+		bool bPending = false;
+	};
+
+	TArray<FResidualReadback> ResidualReadbacks;
+	FFirePressureResidual PressureResidual;
+
+	struct FVelocityReadback
+	{
+		TUniquePtr<FRHIGPUBufferReadback> Readback;
+		uint32 Step = 0;
+		bool bPending = false;
+	};
+
+	TArray<FVelocityReadback> VelocityReadbacks;
+
+	struct FFieldReadback
+	{
+		TUniquePtr<FRHIGPUBufferReadback> Readback;
+		/** Snapshot without its cells, filled in once the readback is ready */
+		FFireFieldSnapshot Snapshot;
+		bool bPending = false;
+	};
+
+	TArray<FFieldReadback> FieldReadbacks;
+	FFireSimulationFieldPtr Field;
+	float MaxCellsPerSecond = 0.0f;
+	uint32 MaxVelocityStep = 0;
+	int32 NumSubSteps = 1;
+	uint32 StepIndex = 0;
+	int32 PressureIterations = INDEX_NONE;
+	uint32 AdaptedStep = 0;
+
+	TSharedPtr<FFireSimulationAtlas, ESPMode::ThreadSafe> Atlas;
+	int32 AtlasSlot = INDEX_NONE;
+	bool bAtlasReset = false;
+};
+
+using FFireSimulationContextPtr = TSharedPtr<FFireSimulationContext, ESPMode::ThreadSafe>;
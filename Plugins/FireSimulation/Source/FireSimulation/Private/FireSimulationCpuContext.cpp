@@ -0,0 +1,650 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationCpuContext.h"
+
+#include "Async/ParallelFor.h"
+#include "FireSimulationContext.h"
+#include "FireSimulationProfiling.h"
+#include "Math/Float16.h"
+#include "Misc/App.h"
+
+static TAutoConsoleVariable<int32> CVarFireSimulationBackend(
+	TEXT("r.FireSimulation.Backend"),
+	0,
+	TEXT("Simulation backend of volumes that begin play afterwards\n")
+	TEXT("0: GPU, CPU when the process can not render (default)\n")
+	TEXT("1: GPU\n")
+	TEXT("2: CPU"),
+	ECVF_Default);
+
+namespace FireCpu
+{
+	/** Cells are processed in tiles of the GPU group size, a tile and its neighbors stay in the caches of one core */
+	static constexpr int32 TileSize = 8;
+
+	/** Calls Function(Cell, Index) for every cell of a grid, tiles run in parallel and cells of a row are contiguous */
+	template<typename FunctionType>
+	static void ParallelForCells(const FIntVector& Resolution, const FunctionType& Function)
+	{
+		const FIntVector NumTiles = (Resolution + FIntVector(TileSize - 1)) / TileSize;
+		ParallelFor(NumTiles.X * NumTiles.Y * NumTiles.Z, [&Resolution, &NumTiles, &Function](int32 TileIndex)
+		{
+			const FIntVector Begin = FIntVector(TileIndex % NumTiles.X, (TileIndex / NumTiles.X) % NumTiles.Y, TileIndex / (NumTiles.X * NumTiles.Y)) * TileSize;
+			const FIntVector End(FMath::Min(Begin.X + TileSize, Resolution.X), FMath::Min(Begin.Y + TileSize, Resolution.Y), FMath::Min(Begin.Z + TileSize, Resolution.Z));
+			for (int32 Z = Begin.Z; Z < End.Z; ++Z)
+			{
+				for (int32 Y = Begin.Y; Y < End.Y; ++Y)
+				{
+					int32 Index = (Z * Resolution.Y + Y) * Resolution.X + Begin.X;
+					for (int32 X = Begin.X; X < End.X; ++X, ++Index)
+					{
+						Function(FIntVector(X, Y, Z), Index);
+					}
+				}
+			}
+		});
+	}
+
+	static FIntVector ClampCell(const FIntVector& Cell, const FIntVector& Resolution)
+	{
+		return FIntVector(FMath::Clamp(Cell.X, 0, Resolution.X - 1), FMath::Clamp(Cell.Y, 0, Resolution.Y - 1), FMath::Clamp(Cell.Z, 0, Resolution.Z - 1));
+	}
+
+	static bool IsOutside(const FIntVector& Cell, const FIntVector& Resolution)
+	{
+		return Cell.X < 0 || Cell.Y < 0 || Cell.Z < 0 || Cell.X >= Resolution.X || Cell.Y >= Resolution.Y || Cell.Z >= Resolution.Z;
+	}
+
+	static VectorRegister4Float Lerp(const VectorRegister4Float& A, const VectorRegister4Float& B, const VectorRegister4Float& Alpha)
+	{
+		return VectorMultiplyAdd(VectorSubtract(B, A), Alpha, A);
+	}
+
+	/**
+	 * Trilinear sample of a float4 field at a position in texel units like a linear clamp sampler of the shaders, texel centers
+	 * lie at i + 0.5 and positions are clamped to the centers of the border texels, as velocityUV and fluidUV do.
+	 */
+	static VectorRegister4Float SampleLinear(const TArray<FVector4f>& Field, const FIntVector& Resolution, const FVector3f& Position)
+	{
+		const FVector3f P(
+			FMath::Clamp(Position.X - 0.5f, 0.0f, float(Resolution.X - 1)),
+			FMath::Clamp(Position.Y - 0.5f, 0.0f, float(Resolution.Y - 1)),
+			FMath::Clamp(Position.Z - 0.5f, 0.0f, float(Resolution.Z - 1)));
+		const FIntVector C0(int32(P.X), int32(P.Y), int32(P.Z));
+		const FIntVector C1(FMath::Min(C0.X + 1, Resolution.X - 1), FMath::Min(C0.Y + 1, Resolution.Y - 1), FMath::Min(C0.Z + 1, Resolution.Z - 1));
+
+		const FVector4f* Data = Field.GetData();
+		const int32 Row0 = (C0.Z * Resolution.Y + C0.Y) * Resolution.X;
+		const int32 Row1 = (C0.Z * Resolution.Y + C1.Y) * Resolution.X;
+		const int32 Row2 = (C1.Z * Resolution.Y + C0.Y) * Resolution.X;
+		const int32 Row3 = (C1.Z * Resolution.Y + C1.Y) * Resolution.X;
+
+		const VectorRegister4Float Fx = VectorSetFloat1(P.X - C0.X);
+		const VectorRegister4Float X00 = Lerp(VectorLoad(&Data[Row0 + C0.X].X), VectorLoad(&Data[Row0 + C1.X].X), Fx);
+		const VectorRegister4Float X10 = Lerp(VectorLoad(&Data[Row1 + C0.X].X), VectorLoad(&Data[Row1 + C1.X].X), Fx);
+		const VectorRegister4Float X01 = Lerp(VectorLoad(&Data[Row2 + C0.X].X), VectorLoad(&Data[Row2 + C1.X].X), Fx);
+		const VectorRegister4Float X11 = Lerp(VectorLoad(&Data[Row3 + C0.X].X), VectorLoad(&Data[Row3 + C1.X].X), Fx);
+
+		const VectorRegister4Float Fy = VectorSetFloat1(P.Y - C0.Y);
+		return Lerp(Lerp(X00, X10, Fy), Lerp(X01, X11, Fy), VectorSetFloat1(P.Z - C0.Z));
+	}
+
+	static FVector4f ToVector4(const VectorRegister4Float& Register)
+	{
+		FVector4f Result;
+		VectorStore(Register, &Result.X);
+		return Result;
+	}
+
+	static FVector3f ToVector3(const FVector4f& Value)
+	{
+		return FVector3f(Value.X, Value.Y, Value.Z);
+	}
+
+	/** Share of an emitter in the cell at Position relative to the grid origin, see getEmitterWeight */
+	static float GetEmitterWeight(const FFireEmitterRecord& Emitter, const FVector3f& Position, const FVector3f& CellSize)
+	{
+		FVector3f P;
+		for (int32 Row = 0; Row < 3; ++Row)
+		{
+			const FVector4f& Transform = Emitter.GridToShape[Row];
+			P[Row] = Transform.X * Position.X + Transform.Y * Position.Y + Transform.Z * Position.Z + Transform.W;
+		}
+
+		const EFireEmitterShape Shape = EFireEmitterShape(FMath::RoundToInt32(Emitter.Extent.W));
+		if (Shape == EFireEmitterShape::Point)
+		{
+			const FVector3f W = (FVector3f(1.0f) - P.GetAbs() / CellSize).ComponentMax(FVector3f::ZeroVector);
+			return W.X * W.Y * W.Z;
+		}
+
+		// coverage of the cell along the surface, so that shapes smaller than a cell still emit
+		if (Shape == EFireEmitterShape::Sphere)
+		{
+			return FMath::Clamp((Emitter.Extent.X - P.Size()) / CellSize.GetMin() + 0.5f, 0.0f, 1.0f);
+		}
+		const FVector3f W = ((FVector3f(Emitter.Extent.X, Emitter.Extent.Y, Emitter.Extent.Z) - P.GetAbs()) / CellSize + 0.5f)
+			.ComponentMax(FVector3f::ZeroVector).ComponentMin(FVector3f(1.0f));
+		return W.X * W.Y * W.Z;
+	}
+}
+
+bool FFireSimulationCpuContext::IsEnabled()
+{
+	const int32 Backend = CVarFireSimulationBackend.GetValueOnAnyThread();
+	return Backend == 2 || (Backend == 0 && !FApp::CanEverRender());
+}
+
+void FFireSimulationCpuContext::Initialize(const FVector& Size, const FFireSimulationConfig& Config)
+{
+	InitializeResolution(FFireSimulationContext::ComputeResolution(Size, Config), Config.FluidResolutionScale, Size);
+}
+
+void FFireSimulationCpuContext::InitializeResolution(const FIntVector& Resolution, int32 InFluidResolutionScale, const FVector& Size)
+{
+	VelocityResolution = Resolution;
+	FluidResolutionScale = InFluidResolutionScale;
+	FluidResolution = Resolution * FluidResolutionScale;
+	LocalSize = FVector3f(Size);
+	WorldToGrid = FVector3f(Resolution.X / Size.X, Resolution.Y / Size.Y, Resolution.Z / Size.Z);
+
+	const int32 NumVelocityCells = VelocityResolution.X * VelocityResolution.Y * VelocityResolution.Z;
+	const int32 NumFluidCells = FluidResolution.X * FluidResolution.Y * FluidResolution.Z;
+
+	Velocity.SetNumZeroed(NumVelocityCells);
+	Fluid.SetNumZeroed(NumFluidCells);
+	Pressure.SetNumZeroed(NumVelocityCells);
+	Obstacles.SetNumZeroed(NumVelocityCells);
+	bPressureValid = false;
+
+	Phi[0].SetNumZeroed(NumFluidCells);
+	Phi[1].SetNumZeroed(NumFluidCells);
+	AdvectedFluid.SetNumZeroed(NumFluidCells);
+	BuoyantVelocity.SetNumZeroed(NumVelocityCells);
+	Vorticity.SetNumZeroed(NumVelocityCells);
+	ConfinedVelocity.SetNumZeroed(NumVelocityCells);
+	Divergence.SetNumZeroed(NumVelocityCells);
+	PressureScratch.SetNumZeroed(NumVelocityCells);
+	EmitterAmounts.SetNumZeroed(NumVelocityCells);
+	bEmitterActive = false;
+}
+
+bool FFireSimulationCpuContext::IsObstacleCell(const FIntVector& Cell) const
+{
+	return Obstacles[VelocityIndex(Cell)] != 0;
+}
+
+bool FFireSimulationCpuContext::IsObstacle(const FVector3f& Position) const
+{
+	const FIntVector Cell(FMath::FloorToInt32(Position.X), FMath::FloorToInt32(Position.Y), FMath::FloorToInt32(Position.Z));
+	return IsObstacleCell(FireCpu::ClampCell(Cell, VelocityResolution));
+}
+
+bool FFireSimulationCpuContext::IsClosed(const FIntVector& Cell) const
+{
+	return FireCpu::IsOutside(Cell, VelocityResolution) || IsObstacleCell(Cell);
+}
+
+const TCHAR* FFireSimulationCpuContext::GetStageName(EFireCpuStage Stage)
+{
+	static const TCHAR* Names[] = { TEXT("Emitters"), TEXT("FluidAdvection"), TEXT("Extinguish"), TEXT("VelocityAdvection"), TEXT("Vorticity"), TEXT("Divergence"), TEXT("Pressure"), TEXT("Projection") };
+	static_assert(UE_ARRAY_COUNT(Names) == int32(EFireCpuStage::Num), "Every stage needs a name");
+	return Names[int32(Stage)];
+}
+
+uint64 FFireSimulationCpuContext::GetAllocatedBytes() const
+{
+	uint64 Bytes = Velocity.GetAllocatedSize() + Fluid.GetAllocatedSize() + Pressure.GetAllocatedSize() + Obstacles.GetAllocatedSize();
+	Bytes += Phi[0].GetAllocatedSize() + Phi[1].GetAllocatedSize() + AdvectedFluid.GetAllocatedSize();
+	Bytes += BuoyantVelocity.GetAllocatedSize() + Vorticity.GetAllocatedSize() + ConfinedVelocity.GetAllocatedSize();
+	Bytes += Divergence.GetAllocatedSize() + PressureScratch.GetAllocatedSize() + EmitterAmounts.GetAllocatedSize();
+	return Bytes;
+}
+
+void FFireSimulationCpuContext::SetStaticObstacles(const TArray<uint32>& Bits, const FIntVector& Resolution)
+{
+	check(Bits.Num() == FMath::DivideAndRoundUp(Resolution.X * Resolution.Y * Resolution.Z, 32));
+
+	// nearest cell of the voxelized grid like CSStaticObstacles, the grids differ when the volume shrank to fit the budget
+	FireCpu::ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FIntVector Source(
+			FMath::Min(int32((Cell.X + 0.5f) * Resolution.X / VelocityResolution.X), Resolution.X - 1),
+			FMath::Min(int32((Cell.Y + 0.5f) * Resolution.Y / VelocityResolution.Y), Resolution.Y - 1),
+			FMath::Min(int32((Cell.Z + 0.5f) * Resolution.Z / VelocityResolution.Z), Resolution.Z - 1));
+		const int32 Bit = (Source.Z * Resolution.Y + Source.Y) * Resolution.X + Source.X;
+		if ((Bits[Bit >> 5] >> (Bit & 31)) & 1)
+		{
+			Obstacles[Index] = 1;
+		}
+	});
+}
+
+void FFireSimulationCpuContext::SetEmitters(const FFireEmitterBatch& Emitters)
+{
+	PendingEmitters = Emitters;
+}
+
+void FFireSimulationCpuContext::Step(float TimeStep, const FFireSimulationConfig& Config)
+{
+	check(VelocityResolution.GetMin() > 0);
+
+	double StageStart = FPlatformTime::Seconds();
+	auto EndStage = [this, &StageStart](EFireCpuStage Stage)
+	{
+		const double Now = FPlatformTime::Seconds();
+		StageSeconds[int32(Stage)] = Now - StageStart;
+		StageStart = Now;
+	};
+
+	const int32 NumVelocityCells = VelocityResolution.X * VelocityResolution.Y * VelocityResolution.Z;
+	const int32 NumFluidCells = FluidResolution.X * FluidResolution.Y * FluidResolution.Z;
+	FIRE_SIMULATION_STAGE_CELLS(AdvectFluid, NumFluidCells);
+	FIRE_SIMULATION_STAGE_CELLS(Extinguish, NumFluidCells);
+	FIRE_SIMULATION_STAGE_CELLS(AdvectVelocity, NumVelocityCells);
+	FIRE_SIMULATION_STAGE_CELLS(Buoyancy, NumVelocityCells);
+	FIRE_SIMULATION_STAGE_CELLS(Vorticity, NumVelocityCells);
+	FIRE_SIMULATION_STAGE_CELLS(Divergence, NumVelocityCells);
+	FIRE_SIMULATION_STAGE_CELLS(Pressure, NumVelocityCells * FMath::Max(Config.NumPressureIterations - (Config.bWarmStartPressure && bPressureValid ? 0 : 1), 0));
+	FIRE_SIMULATION_STAGE_CELLS(Projection, NumVelocityCells);
+
+	SplatEmitters();
+	EndStage(EFireCpuStage::Emitters);
+	AdvectFluid(TimeStep, Config);
+	EndStage(EFireCpuStage::FluidAdvection);
+	Extinguish(TimeStep, Config);
+	EndStage(EFireCpuStage::Extinguish);
+	AdvectVelocityBuoyancy(TimeStep, Config);
+	EndStage(EFireCpuStage::VelocityAdvection);
+	VorticityConfinement(TimeStep, Config);
+	EndStage(EFireCpuStage::Vorticity);
+	ComputeDivergence();
+	EndStage(EFireCpuStage::Divergence);
+	SolvePressure(Config);
+	EndStage(EFireCpuStage::Pressure);
+	Project();
+	EndStage(EFireCpuStage::Projection);
+
+	if (Field.IsValid())
+	{
+		const uint32 FieldStep = Field->AdvanceStep();
+		const int32 Interval = FFireSimulationContext::GetFieldReadbackInterval();
+		if (Interval > 0 && FieldStep % Interval == 0)
+		{
+			PublishField(FieldStep);
+		}
+	}
+}
+
+void FFireSimulationCpuContext::SplatEmitters()
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(AddEmitter);
+	using namespace FireCpu;
+
+	const FFireEmitterBatch Batch = MoveTemp(PendingEmitters);
+	bEmitterActive = !Batch.Emitters.IsEmpty();
+	if (!bEmitterActive)
+	{
+		return;
+	}
+
+	// emitters overlap, so they are splatted one after the other, the bounds grow by the one cell footprint of points and of shape edges
+	FMemory::Memzero(EmitterAmounts.GetData(), EmitterAmounts.Num() * sizeof(FVector4f));
+	const FVector3f CellSize = LocalSize / FVector3f(VelocityResolution);
+	for (const FFireEmitter& Emitter : Batch.Emitters)
+	{
+		FBox Bounds;
+		const FFireEmitterRecord Record = FireSimulationEmitters::MakeRecord(Emitter, Batch.GridOrigin, Bounds);
+		const FVector MinCell = (Bounds.Min - FVector(CellSize)) / FVector(CellSize);
+		const FVector MaxCell = (Bounds.Max + FVector(CellSize)) / FVector(CellSize);
+		FIntVector Min;
+		FIntVector Max;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			Min[Axis] = FMath::Max(FMath::FloorToInt32(MinCell[Axis]), 0);
+			Max[Axis] = FMath::Min(FMath::FloorToInt32(MaxCell[Axis]), VelocityResolution[Axis] - 1);
+		}
+
+		for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+		{
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			{
+				for (int32 X = Min.X; X <= Max.X; ++X)
+				{
+					const FIntVector Cell(X, Y, Z);
+					const float Weight = GetEmitterWeight(Record, (FVector3f(Cell) + 0.5f) * CellSize, CellSize);
+					if (Weight > 0.0f)
+					{
+						EmitterAmounts[VelocityIndex(Cell)] += Record.Amount * Weight;
+					}
+				}
+			}
+		}
+	}
+}
+
+void FFireSimulationCpuContext::AdvectFluid(float TimeStep, const FFireSimulationConfig& Config)
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(AdvectFluid);
+	using namespace FireCpu;
+
+	const float RcpScale = 1.0f / FluidResolutionScale;
+	const FIntVector FluidBounds = FluidResolution - FIntVector(1);
+
+	// position a fluid cell is advected from along the velocity of the previous step, see getFluidAdvectedPosition
+	auto AdvectedPosition = [this, RcpScale](const FIntVector& Cell, float Forward)
+	{
+		const FVector3f Position(Cell);
+		const FVector3f V = ToVector3(ToVector4(SampleLinear(Velocity, VelocityResolution, Position * RcpScale)));
+		return Position + 0.5f - Forward * WorldToGrid * V;
+	};
+
+	// MacCormack advection, phi1 is the forward advected state and phi0 the backward advected phi1
+	const TArray<FVector4f>* PhiIn[2] = { &Fluid, &Phi[1] };
+	TArray<FVector4f>* PhiOut[2] = { &Phi[1], &Phi[0] };
+	const float Forward[2] = { TimeStep, -TimeStep };
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		ParallelForCells(FluidResolution, [&, Pass](const FIntVector& Cell, int32 Index)
+		{
+			const FVector3f FireCell = FVector3f(Cell) * RcpScale;
+			(*PhiOut[Pass])[Index] = IsObstacle(FireCell) ? FVector4f(0.0f, 0.0f, 0.0f, 0.0f)
+				: ToVector4(SampleLinear(*PhiIn[Pass], FluidResolution, AdvectedPosition(Cell, Forward[Pass])));
+		});
+	}
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+	const VectorRegister4Float Retained = VectorSubtract(VectorSetFloat1(1.0f), VectorLoad(&Config.FluidDissipation.X));
+	const FVector4f Decay = Config.FluidDecay * TimeStep;
+	const VectorRegister4Float DecayRegister = VectorLoad(&Decay.X);
+	ParallelForCells(FluidResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FVector3f FireCell = FVector3f(Cell) * RcpScale;
+		if (IsObstacle(FireCell))
+		{
+			AdvectedFluid[Index] = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		const FVector3f Position = AdvectedPosition(Cell, TimeStep);
+
+		// same selection as isBorder in advectFluid, the limited correction runs on cells that fail the test
+		VectorRegister4Float R;
+		if (FireCell.X > 0 && FireCell.X < FluidBounds.X && FireCell.Y > 0 && FireCell.Y < FluidBounds.Y && FireCell.Z > 0 && FireCell.Z < FluidBounds.Z)
+		{
+			R = SampleLinear(Fluid, FluidResolution, Position);
+		}
+		else
+		{
+			VectorRegister4Float MinPhi = VectorSetFloat1(UE_BIG_NUMBER);
+			VectorRegister4Float MaxPhi = VectorSetFloat1(-UE_BIG_NUMBER);
+			for (int32 Node = 0; Node < 8; ++Node)
+			{
+				const FIntVector Neighbor = ClampCell(Cell + FIntVector(Node & 4 ? 1 : -1, Node & 2 ? 1 : -1, Node & 1 ? 1 : -1), FluidResolution);
+				const VectorRegister4Float Value = VectorLoad(&Fluid[FluidIndex(Neighbor)].X);
+				MinPhi = VectorMin(MinPhi, Value);
+				MaxPhi = VectorMax(MaxPhi, Value);
+			}
+
+			const VectorRegister4Float Correction = VectorSubtract(VectorLoad(&Fluid[Index].X), VectorLoad(&Phi[0][Index].X));
+			R = VectorMultiplyAdd(Half, Correction, SampleLinear(Phi[1], FluidResolution, Position));
+			R = VectorMax(VectorMin(R, MaxPhi), MinPhi);
+		}
+
+		VectorStore(VectorMax(Zero, VectorSubtract(VectorMultiply(R, Retained), DecayRegister)), &AdvectedFluid[Index].X);
+	});
+}
+
+void FFireSimulationCpuContext::Extinguish(float TimeStep, const FFireSimulationConfig& Config)
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Extinguish);
+	using namespace FireCpu;
+
+	// the advected fluid becomes the new fluid state
+	const float RcpScale = 1.0f / FluidResolutionScale;
+	const FVector3f Extinguishment(Config.VaporCooling, Config.VaporExtinguish, Config.ReactionExtinguish);
+	const FVector3f TempDistribution = Config.TemperatureDistribution * TimeStep;
+	ParallelForCells(FluidResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		auto NeighborTemperature = [&](int32 X, int32 Y, int32 Z)
+		{
+			return AdvectedFluid[FluidIndex(ClampCell(Cell + FIntVector(X, Y, Z), FluidResolution))].X;
+		};
+
+		// x = temperature, y = reaction, z = vapor, w = smoke
+		FVector4f Trdv = AdvectedFluid[Index];
+		if (bEmitterActive)
+		{
+			// x = heat, y = reaction, z = vapor, w = temperature sink, water turns into vapor and smoke where it is hot enough
+			const FVector4f Amount = ToVector4(SampleLinear(EmitterAmounts, VelocityResolution, (FVector3f(Cell) + 0.5f) * RcpScale));
+			FVector3f Emit = ToVector3(Amount) * Config.EmitterScale;
+			Emit.Z *= FMath::Clamp((Trdv.X + Emit.X - Config.VaporMinTemperature) * Config.VaporTemperatureScale, 0.0f, 1.0f);
+			Trdv += FVector4f(Emit, Emit.Z * Config.VaporDensity);
+			Trdv.X = FMath::Max(0.0f, Trdv.X - Amount.W);
+		}
+
+		if (Trdv.Y > 0 && Trdv.Y < Extinguishment.Z)
+		{
+			Trdv.W += Config.ReactionAmount * Trdv.Y;
+		}
+
+		if (!IsObstacle(FVector3f(Cell) * RcpScale))
+		{
+			const FVector3f TNeg(NeighborTemperature(-1, 0, 0), NeighborTemperature(0, -1, 0), NeighborTemperature(0, 0, -1));
+			const FVector3f TPos(NeighborTemperature(1, 0, 0), NeighborTemperature(0, 1, 0), NeighborTemperature(0, 0, 1));
+			const FVector3f D = (TNeg - Trdv.X).ComponentMax(FVector3f::ZeroVector) + (TPos - Trdv.X).ComponentMax(FVector3f::ZeroVector);
+			Trdv.X += TempDistribution | D;
+		}
+
+		Trdv.X = FMath::Max(0.0f, Trdv.X - Extinguishment.X * Trdv.Z);
+		Trdv.Y = FMath::Max(0.0f, Trdv.Y - Extinguishment.Y * Trdv.Z);
+		Fluid[Index] = Trdv;
+	});
+}
+
+void FFireSimulationCpuContext::AdvectVelocityBuoyancy(float TimeStep, const FFireSimulationConfig& Config)
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(AdvectVelocity);
+	using namespace FireCpu;
+
+	const VectorRegister4Float Retained = VectorSubtract(VectorSetFloat1(1.0f), VectorLoadFloat3(&Config.Dissipation.X));
+	const float Buoyancy = Config.Buoyancy * TimeStep;
+	const float Scale = FluidResolutionScale;
+	ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FVector3f Position(Cell);
+		if (IsObstacle(Position))
+		{
+			BuoyantVelocity[Index] = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		const FVector3f Source = Position + 0.5f - TimeStep * WorldToGrid * ToVector3(Velocity[Index]);
+		FVector4f Result = ToVector4(VectorMultiply(SampleLinear(Velocity, VelocityResolution, Source), Retained));
+
+		// x = temperature, y = reaction, z = vapor, w = smoke
+		const FVector4f Trdv = ToVector4(SampleLinear(Fluid, FluidResolution, Position * Scale));
+		const float DeltaTemperature = FMath::Max(0.0f, Trdv.X - Config.AmbientTemperature);
+		Result.Z += DeltaTemperature * Buoyancy - Trdv.W * Config.DensityWeight;
+		Result.W = 0.0f;
+		BuoyantVelocity[Index] = Result;
+	});
+}
+
+void FFireSimulationCpuContext::VorticityConfinement(float TimeStep, const FFireSimulationConfig& Config)
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Vorticity);
+	using namespace FireCpu;
+
+	auto Neighbor = [this](const TArray<FVector4f>& Field, const FIntVector& Cell, int32 X, int32 Y, int32 Z)
+	{
+		return ToVector3(Field[VelocityIndex(ClampCell(Cell + FIntVector(X, Y, Z), VelocityResolution))]);
+	};
+
+	ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FVector3f L = Neighbor(BuoyantVelocity, Cell, -1, 0, 0);
+		const FVector3f R = Neighbor(BuoyantVelocity, Cell, 1, 0, 0);
+		const FVector3f D = Neighbor(BuoyantVelocity, Cell, 0, -1, 0);
+		const FVector3f T = Neighbor(BuoyantVelocity, Cell, 0, 1, 0);
+		const FVector3f B = Neighbor(BuoyantVelocity, Cell, 0, 0, -1);
+		const FVector3f F = Neighbor(BuoyantVelocity, Cell, 0, 0, 1);
+		const FVector3f Omega = 0.5f * FVector3f((T.Z - D.Z) - (F.Y - B.Y), (F.X - B.X) - (R.Z - L.Z), (R.Y - L.Y) - (T.X - D.X));
+		Vorticity[Index] = FVector4f(Omega, 0.0f);
+	});
+
+	const float Strength = Config.VorticityStrength * TimeStep;
+	ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FVector3f Eta = 0.5f * FVector3f(
+			Neighbor(Vorticity, Cell, 1, 0, 0).Size() - Neighbor(Vorticity, Cell, -1, 0, 0).Size(),
+			Neighbor(Vorticity, Cell, 0, 1, 0).Size() - Neighbor(Vorticity, Cell, 0, -1, 0).Size(),
+			Neighbor(Vorticity, Cell, 0, 0, 1).Size() - Neighbor(Vorticity, Cell, 0, 0, -1).Size());
+		const FVector3f Direction = (Eta + 0.001f).GetUnsafeNormal();
+		const FVector3f Force = Strength * (Direction ^ ToVector3(Vorticity[Index]));
+		ConfinedVelocity[Index] = FVector4f(ToVector3(BuoyantVelocity[Index]) + Force, 0.0f);
+	});
+}
+
+void FFireSimulationCpuContext::ComputeDivergence()
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Divergence);
+	using namespace FireCpu;
+
+	auto NeighborVelocity = [this](const FIntVector& Cell, int32 X, int32 Y, int32 Z)
+	{
+		const FIntVector Neighbor = Cell + FIntVector(X, Y, Z);
+		return IsClosed(Neighbor) ? FVector3f::ZeroVector : ToVector3(ConfinedVelocity[VelocityIndex(Neighbor)]);
+	};
+
+	ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		Divergence[Index] = 0.5f * (
+			(NeighborVelocity(Cell, 1, 0, 0).X - NeighborVelocity(Cell, -1, 0, 0).X) +
+			(NeighborVelocity(Cell, 0, 1, 0).Y - NeighborVelocity(Cell, 0, -1, 0).Y) +
+			(NeighborVelocity(Cell, 0, 0, 1).Z - NeighborVelocity(Cell, 0, 0, -1).Z));
+	});
+}
+
+void FFireSimulationCpuContext::SolvePressure(const FFireSimulationConfig& Config)
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Pressure);
+	using namespace FireCpu;
+
+	// a warm started solve continues from the previous solution, otherwise the prepared guess counts as the first iteration
+	const bool bWarmStart = Config.bWarmStartPressure && bPressureValid;
+	int32 FirstIteration = 0;
+	if (!bWarmStart)
+	{
+		ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+		{
+			Pressure[Index] = -Divergence[Index] / 6.0f;
+		});
+		FirstIteration = 1;
+	}
+
+	static const FIntVector Offsets[6] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	for (int32 Iteration = FirstIteration; Iteration < Config.NumPressureIterations; ++Iteration)
+	{
+		FIRE_SIMULATION_CPU_STAGE_SCOPE(PressureIteration);
+		ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+		{
+			const float Center = Pressure[Index];
+			float Sum = 0.0f;
+			for (const FIntVector& Offset : Offsets)
+			{
+				const FIntVector Neighbor = Cell + Offset;
+				Sum += IsClosed(Neighbor) ? Center : Pressure[VelocityIndex(Neighbor)];
+			}
+			PressureScratch[Index] = (Sum - Divergence[Index]) / 6.0f;
+		});
+		Swap(Pressure, PressureScratch);
+	}
+	bPressureValid = true;
+}
+
+void FFireSimulationCpuContext::Project()
+{
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Projection);
+	using namespace FireCpu;
+
+	ParallelForCells(VelocityResolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		if (IsObstacleCell(Cell))
+		{
+			Velocity[Index] = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		// an axis with a closed neighbor does not move
+		const float Center = Pressure[Index];
+		FVector3f Mask(1.0f, 1.0f, 1.0f);
+		auto NeighborPressure = [&](float& AxisMask, int32 X, int32 Y, int32 Z)
+		{
+			const FIntVector Neighbor = Cell + FIntVector(X, Y, Z);
+			if (IsClosed(Neighbor))
+			{
+				AxisMask = 0.0f;
+				return Center;
+			}
+			return Pressure[VelocityIndex(Neighbor)];
+		};
+
+		const float PL = NeighborPressure(Mask.X, -1, 0, 0);
+		const float PR = NeighborPressure(Mask.X, 1, 0, 0);
+		const float PD = NeighborPressure(Mask.Y, 0, -1, 0);
+		const float PT = NeighborPressure(Mask.Y, 0, 1, 0);
+		const float PB = NeighborPressure(Mask.Z, 0, 0, -1);
+		const float PF = NeighborPressure(Mask.Z, 0, 0, 1);
+
+		const FVector3f V = ToVector3(ConfinedVelocity[Index]) - FVector3f(PR - PL, PT - PD, PF - PB) * 0.5f;
+		Velocity[Index] = FVector4f(V * Mask, 0.0f);
+	});
+}
+
+void FFireSimulationCpuContext::PublishField(uint32 FieldStep)
+{
+	using namespace FireCpu;
+
+	const int32 Factor = FFireSimulationContext::GetFieldReadbackDownsample();
+	TSharedRef<FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FFireFieldSnapshot, ESPMode::ThreadSafe>();
+	Snapshot->Resolution = FIntVector::DivideAndRoundUp(VelocityResolution, Factor);
+	Snapshot->GridOrigin = GridOrigin;
+	Snapshot->Size = FVector(LocalSize);
+	Snapshot->CellSize = FVector(LocalSize) * Factor / FVector(VelocityResolution);
+	Snapshot->Step = FieldStep;
+	Snapshot->Time = FPlatformTime::Seconds();
+
+	const int32 NumCells = Snapshot->Resolution.X * Snapshot->Resolution.Y * Snapshot->Resolution.Z;
+	Snapshot->Fluid.SetNumUninitialized(NumCells);
+	Snapshot->Velocity.SetNumUninitialized(NumCells);
+
+	// rounded to halves as the GPU readback packs them, so that the snapshots of both backends hold the same precision
+	const auto Round = [](float Value) { return FFloat16(FMath::Min(Value, 65504.0f)).GetFloat(); };
+	ParallelForCells(Snapshot->Resolution, [&](const FIntVector& Cell, int32 Index)
+	{
+		const FIntVector First = Cell * Factor;
+		FVector2f MaxTR = FVector2f::ZeroVector;
+		float Smoke = 0.0f;
+		for (int32 Z = 0; Z < Factor; ++Z)
+		{
+			for (int32 Y = 0; Y < Factor; ++Y)
+			{
+				for (int32 X = 0; X < Factor; ++X)
+				{
+					const FIntVector VelocityCell = ClampCell(First + FIntVector(X, Y, Z), VelocityResolution);
+					const FVector4f& Trdv = Fluid[FluidIndex(ClampCell(VelocityCell * FluidResolutionScale, FluidResolution))];
+					MaxTR = FVector2f(FMath::Max(MaxTR.X, Trdv.X), FMath::Max(MaxTR.Y, Trdv.Y));
+					Smoke += Trdv.W;
+				}
+			}
+		}
+		Smoke /= Factor * Factor * Factor;
+		const FVector3f V = ToVector3(ToVector4(SampleLinear(Velocity, VelocityResolution, FVector3f(First) + 0.5f * Factor)));
+
+		Snapshot->Fluid[Index] = FVector4f(Round(MaxTR.X), Round(MaxTR.Y), Round(Smoke), 0.0f);
+		Snapshot->Velocity[Index] = FVector3f(Round(V.X), Round(V.Y), Round(V.Z));
+	});
+	Field->Publish(Snapshot);
+}
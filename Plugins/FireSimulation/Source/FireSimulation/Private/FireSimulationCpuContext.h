@@ -0,0 +1,119 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationConfig.h"
+#include "FireSimulationEmitterBatch.h"
+#include "FireSimulationField.h"
+
+/** Stages of a CPU step in execution order, timed by every step */
+enum class EFireCpuStage : uint8
+{
+	Emitters,
+	FluidAdvection,
+	Extinguish,
+	VelocityAdvection,
+	Vorticity,
+	Divergence,
+	Pressure,
+	Projection,
+	Num
+};
+
+/**
+ * Simulation state of a single fire volume stepped on the CPU, for servers without a GPU, automated tests and as a reference
+ * for the compute shaders. Runs the stage sequence of the fused GPU path with the same boundary handling, Initialize and Step
+ * mirror Initialize and AddPasses of FFireSimulationContext.
+ *
+ * The fields are kept as 32 bit floats, so results differ from the GPU path by the rounding of its storage formats (about 1e-3
+ * relative with Half storage) and by the 8 bit sub texel precision of hardware filtering, which adds up to 1/256 of the
+ * difference between neighboring cells per sample. Multigrid and sparse volumes run dense Jacobi iterations, the adaptive
+ * iteration count is not used. Plugins.FireSimulation.CpuMatchesGpu steps both backends with full precision storage from the
+ * same emitter and obstacles and expects every cell of their fields within 2% of the peak after 16 steps.
+ */
+class FFireSimulationCpuContext
+{
+public:
+	/** True if volumes are stepped on the CPU, see r.FireSimulation.Backend */
+	static bool IsEnabled();
+
+	void Initialize(const FVector& Size, const FFireSimulationConfig& Config);
+	void InitializeResolution(const FIntVector& Resolution, int32 FluidResolutionScale, const FVector& Size);
+	/** Emitters of the next step, splatted like CSAddEmitter and added to the advected fluid like applyEmitter */
+	void SetEmitters(const FFireEmitterBatch& Emitters);
+	/** World position of the minimum corner of local cell 0 at the next step */
+	void SetGridOrigin(const FVector& InGridOrigin) { GridOrigin = InGridOrigin; }
+	/** Copy of the field published every r.FireSimulation.FieldReadbackInterval steps like the readbacks of a GPU volume */
+	void SetField(const FFireSimulationFieldPtr& InField) { Field = InField; }
+	/** Solid cells of the voxelized static geometry, see FFireSimulationContext::SetStaticObstacles */
+	void SetStaticObstacles(const TArray<uint32>& Bits, const FIntVector& Resolution);
+	void Step(float TimeStep, const FFireSimulationConfig& Config);
+
+	const FIntVector& GetVelocityResolution() const { return VelocityResolution; }
+	const FVector3f& GetLocalSize() const { return LocalSize; }
+	const FIntVector& GetFluidResolution() const { return FluidResolution; }
+	/** x = temperature, y = reaction, z = vapor, w = smoke */
+	const TArray<FVector4f>& GetFluid() const { return Fluid; }
+	const TArray<FVector4f>& GetVelocity() const { return Velocity; }
+	const TArray<float>& GetPressure() const { return Pressure; }
+
+	/** Wall time of a stage in the last step */
+	double GetStageSeconds(EFireCpuStage Stage) const { return StageSeconds[int32(Stage)]; }
+	static const TCHAR* GetStageName(EFireCpuStage Stage);
+	/** Memory of all fields including the intermediate ones */
+	uint64 GetAllocatedBytes() const;
+
+private:
+	void SplatEmitters();
+	void AdvectFluid(float TimeStep, const FFireSimulationConfig& Config);
+	void Extinguish(float TimeStep, const FFireSimulationConfig& Config);
+	void AdvectVelocityBuoyancy(float TimeStep, const FFireSimulationConfig& Config);
+	void VorticityConfinement(float TimeStep, const FFireSimulationConfig& Config);
+	void ComputeDivergence();
+	void SolvePressure(const FFireSimulationConfig& Config);
+	void Project();
+	/** Downsamples the state after the step like CSReadbackField and publishes it to Field */
+	void PublishField(uint32 FieldStep);
+
+	bool IsObstacleCell(const FIntVector& Cell) const;
+	/** Tests the velocity cell that contains a position given in local velocity cells */
+	bool IsObstacle(const FVector3f& Position) const;
+	/** Closed neighbors of the pressure solve are outside of the grid or solid */
+	bool IsClosed(const FIntVector& Cell) const;
+
+	int32 VelocityIndex(const FIntVector& Cell) const { return (Cell.Z * VelocityResolution.Y + Cell.Y) * VelocityResolution.X + Cell.X; }
+	int32 FluidIndex(const FIntVector& Cell) const { return (Cell.Z * FluidResolution.Y + Cell.Y) * FluidResolution.X + Cell.X; }
+
+	FIntVector VelocityResolution = FIntVector::ZeroValue;
+	FIntVector FluidResolution = FIntVector::ZeroValue;
+	int32 FluidResolutionScale = 1;
+	FVector3f LocalSize = FVector3f::ZeroVector;
+	FVector3f WorldToGrid = FVector3f::ZeroVector;
+	FVector GridOrigin = FVector::ZeroVector;
+	FFireSimulationFieldPtr Field;
+
+	/** State carried from step to step */
+	TArray<FVector4f> Velocity;
+	TArray<FVector4f> Fluid;
+	TArray<float> Pressure;
+	TArray<uint8> Obstacles;
+	bool bPressureValid = false;
+
+	/** Intermediate fields of a step, kept to avoid allocations */
+	TArray<FVector4f> Phi[2];
+	TArray<FVector4f> AdvectedFluid;
+	TArray<FVector4f> BuoyantVelocity;
+	TArray<FVector4f> Vorticity;
+	TArray<FVector4f> ConfinedVelocity;
+	TArray<float> Divergence;
+	TArray<float> PressureScratch;
+	/** Heat, reaction, vapor and temperature sink of the emitters of a step per velocity cell, valid while bEmitterActive */
+	TArray<FVector4f> EmitterAmounts;
+	FFireEmitterBatch PendingEmitters;
+	bool bEmitterActive = false;
+
+	double StageSeconds[int32(EFireCpuStage::Num)] = {};
+};
+
+using FFireSimulationCpuContextPtr = TSharedPtr<FFireSimulationCpuContext, ESPMode::ThreadSafe>;
@@ -0,0 +1,171 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationDynamicObstacles.h"
+
+#include "FireSimulationCommandQueue.h"
+#include "Chaos/Convex.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsEngine/BodySetup.h"
+
+static int32 GFireSimulationMaxDynamicObstacleShapes = 1024;
+static FAutoConsoleVariableRef CVarFireSimulationMaxDynamicObstacleShapes(
+	TEXT("r.FireSimulation.MaxDynamicObstacleShapes"),
+	GFireSimulationMaxDynamicObstacleShapes,
+	TEXT("Collision shapes of moving bodies rasterized into the obstacles of one fire volume per step."),
+	ECVF_Default);
+
+namespace FireSimulationObstacles
+{
+	static void AddShape(FFireDynamicObstacles& Obstacles, FFireObstacleShape Shape, const FTransform& ShapeToWorld, const FBox& LocalBounds)
+	{
+		// row vectors, so the rows of the shader transform are the columns of the matrix
+		const FMatrix WorldToShape = ShapeToWorld.ToInverseMatrixWithScale();
+		for (int32 Row = 0; Row < 3; ++Row)
+		{
+			Shape.WorldToShape[Row] = FVector4f(WorldToShape.M[0][Row], WorldToShape.M[1][Row], WorldToShape.M[2][Row], WorldToShape.M[3][Row]);
+		}
+		Obstacles.Shapes.Add(Shape);
+		Obstacles.ShapeBounds.Add(LocalBounds.TransformBy(ShapeToWorld));
+	}
+
+	static void AddBody(FFireDynamicObstacles& Obstacles, const UPrimitiveComponent& Component, const FBodyInstance& Body)
+	{
+		const UBodySetup* BodySetup = Body.GetBodySetup();
+		if (!BodySetup)
+		{
+			return;
+		}
+
+		// bodies that are moved without simulating physics only know the velocity of their component
+		FFireObstacleShape Shape;
+		const bool bSimulating = Body.IsInstanceSimulatingPhysics();
+		Shape.LinearVelocity = FVector4f(FVector3f(bSimulating ? Body.GetUnrealWorldVelocity() : Component.GetComponentVelocity()), 0.0f);
+		Shape.AngularVelocity = FVector4f(FVector3f(bSimulating ? Body.GetUnrealWorldAngularVelocityInRadians() : FVector::ZeroVector), 0.0f);
+		Shape.CenterOfMass = FVector4f(FVector3f(Body.GetCOMPosition()), 0.0f);
+
+		const FTransform BodyToWorld = Body.GetUnrealWorldTransform();
+		const FKAggregateGeom& Geometry = BodySetup->AggGeom;
+		for (const FKBoxElem& Box : Geometry.BoxElems)
+		{
+			const FVector Extent = 0.5 * FVector(Box.X, Box.Y, Box.Z);
+			Shape.Type = EFireObstacleShape::Box;
+			Shape.Extent = FVector4f(FVector3f(Extent), 0.0f);
+			AddShape(Obstacles, Shape, Box.GetTransform() * BodyToWorld, FBox(-Extent, Extent));
+		}
+		for (const FKSphereElem& Sphere : Geometry.SphereElems)
+		{
+			Shape.Type = EFireObstacleShape::Sphere;
+			Shape.Extent = FVector4f(Sphere.Radius, 0.0f, 0.0f, 0.0f);
+			AddShape(Obstacles, Shape, Sphere.GetTransform() * BodyToWorld, FBox(FVector(-Sphere.Radius), FVector(Sphere.Radius)));
+		}
+		for (const FKSphylElem& Capsule : Geometry.SphylElems)
+		{
+			const FVector Extent(Capsule.Radius, Capsule.Radius, Capsule.Radius + 0.5f * Capsule.Length);
+			Shape.Type = EFireObstacleShape::Capsule;
+			Shape.Extent = FVector4f(Capsule.Radius, 0.5f * Capsule.Length, 0.0f, 0.0f);
+			AddShape(Obstacles, Shape, Capsule.GetTransform() * BodyToWorld, FBox(-Extent, Extent));
+		}
+		for (const FKConvexElem& Convex : Geometry.ConvexElems)
+		{
+			const auto& ChaosConvex = Convex.GetChaosConvexMesh();
+			Shape.Type = EFireObstacleShape::Convex;
+			Shape.FirstPlane = Obstacles.Planes.Num();
+			Shape.NumPlanes = 0;
+			if (ChaosConvex)
+			{
+				for (int32 Plane = 0; Plane < ChaosConvex->NumPlanes(); ++Plane)
+				{
+					const auto& Face = ChaosConvex->GetPlane(Plane);
+					const FVector3f Normal(Face.Normal());
+					Obstacles.Planes.Add(FVector4f(Normal, FVector3f::DotProduct(Normal, FVector3f(Face.X()))));
+				}
+				Shape.NumPlanes = ChaosConvex->NumPlanes();
+			}
+
+			// a hull without cooked data falls back to its bounds
+			if (Shape.NumPlanes == 0)
+			{
+				Shape.Type = EFireObstacleShape::Box;
+				Shape.Extent = FVector4f(FVector3f(Convex.ElemBox.GetExtent()), 0.0f);
+				AddShape(Obstacles, Shape, FTransform(Convex.ElemBox.GetCenter()) * Convex.GetTransform() * BodyToWorld, FBox(-Convex.ElemBox.GetExtent(), Convex.ElemBox.GetExtent()));
+				continue;
+			}
+			AddShape(Obstacles, Shape, Convex.GetTransform() * BodyToWorld, Convex.ElemBox);
+		}
+	}
+
+	FFireDynamicObstacles Gather(const UWorld& World, const FVector& GridOrigin, const FVector& Size)
+	{
+		FFireDynamicObstacles Obstacles;
+		Obstacles.GridOrigin = GridOrigin;
+
+		TArray<FOverlapResult> Overlaps;
+		World.OverlapMultiByObjectType(Overlaps, GridOrigin + 0.5 * Size, FQuat::Identity,
+			FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllDynamicObjects), FCollisionShape::MakeBox(0.5 * Size));
+
+		TSet<const FBodyInstance*> Visited;
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			const UPrimitiveComponent* Component = Overlap.GetComponent();
+			if (!Component || Component->Mobility != EComponentMobility::Movable)
+			{
+				continue;
+			}
+
+			// the item of a skeletal mesh overlap is the index of its body
+			const FBodyInstance* Body = Component->GetBodyInstance(NAME_None, true, Overlap.ItemIndex);
+			bool bVisited = false;
+			Visited.Add(Body, &bVisited);
+			if (!Body || bVisited)
+			{
+				continue;
+			}
+
+			AddBody(Obstacles, *Component, *Body);
+			if (Obstacles.Shapes.Num() >= GFireSimulationMaxDynamicObstacleShapes)
+			{
+				Obstacles.Shapes.SetNum(GFireSimulationMaxDynamicObstacleShapes);
+				Obstacles.ShapeBounds.SetNum(GFireSimulationMaxDynamicObstacleShapes);
+				break;
+			}
+		}
+		return Obstacles;
+	}
+
+	void Add(FFireDynamicObstacles& Obstacles, const FFireObstacle& Obstacle)
+	{
+		if (Obstacles.Shapes.Num() >= GFireSimulationMaxDynamicObstacleShapes)
+		{
+			return;
+		}
+
+		FFireObstacleShape Shape;
+		Shape.LinearVelocity = FVector4f(FVector3f(Obstacle.Velocity), 0.0f);
+		Shape.CenterOfMass = FVector4f(FVector3f(Obstacle.Transform.GetLocation()), 0.0f);
+		const FVector Extent = Obstacle.Extent.ComponentMax(FVector::ZeroVector);
+		switch (Obstacle.Type)
+		{
+		case EFireObstacleType::Box:
+			Shape.Type = EFireObstacleShape::Box;
+			Shape.Extent = FVector4f(FVector3f(Extent), 0.0f);
+			AddShape(Obstacles, Shape, Obstacle.Transform, FBox(-Extent, Extent));
+			break;
+		case EFireObstacleType::Sphere:
+			Shape.Type = EFireObstacleShape::Sphere;
+			Shape.Extent = FVector4f(Extent.X, 0.0f, 0.0f, 0.0f);
+			AddShape(Obstacles, Shape, Obstacle.Transform, FBox(FVector(-Extent.X), FVector(Extent.X)));
+			break;
+		case EFireObstacleType::Capsule:
+		{
+			const FVector Bounds(Extent.X, Extent.X, Extent.X + Extent.Z);
+			Shape.Type = EFireObstacleShape::Capsule;
+			Shape.Extent = FVector4f(Extent.X, Extent.Z, 0.0f, 0.0f);
+			AddShape(Obstacles, Shape, Obstacle.Transform, FBox(-Bounds, Bounds));
+			break;
+		}
+		}
+	}
+}
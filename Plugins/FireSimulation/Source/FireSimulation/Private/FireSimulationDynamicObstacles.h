@@ -0,0 +1,60 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+struct FFireObstacle;
+
+enum class EFireObstacleShape : uint32
+{
+	Box,
+	Sphere,
+	Capsule,
+	Convex,
+};
+
+/** One collision shape of a moving body, layout matches FObstacleShape in FireSimulation.usf */
+struct FFireObstacleShape
+{
+	/** Rows of the world to shape transform, shapes are tested in their own unscaled space */
+	FVector4f WorldToShape[3];
+	/** Box: half size, sphere: radius in x, capsule: radius in x and half length along z in y */
+	FVector4f Extent = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+	/** Velocity of the body in world units, the velocity of a cell adds the angular part around the center of mass */
+	FVector4f LinearVelocity = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+	FVector4f AngularVelocity = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+	FVector4f CenterOfMass = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+	EFireObstacleShape Type = EFireObstacleShape::Box;
+	/** Planes of a convex hull in FFireDynamicObstacles::Planes */
+	uint32 FirstPlane = 0;
+	uint32 NumPlanes = 0;
+	uint32 Padding = 0;
+};
+static_assert(sizeof(FFireObstacleShape) == 128, "FFireObstacleShape has to match FObstacleShape in FireSimulation.usf");
+
+/** Moving bodies inside a volume at one step, gathered on the game thread */
+struct FFireDynamicObstacles
+{
+	/** World position of the minimum corner of local cell 0 */
+	FVector GridOrigin = FVector::ZeroVector;
+	TArray<FFireObstacleShape> Shapes;
+	/** World bounds of every shape */
+	TArray<FBox> ShapeBounds;
+	/** Outward normal and distance from the shape origin of the convex hull planes */
+	TArray<FVector4f> Planes;
+};
+
+namespace FireSimulationObstacles
+{
+	/**
+	 * Collision shapes of the movable bodies that overlap the box at GridOrigin of Size, up to
+	 * r.FireSimulation.MaxDynamicObstacleShapes. Boxes, spheres, capsules and convex hulls of every body, skeletal meshes such
+	 * as vehicles contribute the bodies of their physics asset. Game thread only.
+	 */
+	FFireDynamicObstacles Gather(const UWorld& World, const FVector& GridOrigin, const FVector& Size);
+
+	/** Adds a shape submitted with FFireSimulationCommandQueue::SubmitObstacle, up to r.FireSimulation.MaxDynamicObstacleShapes */
+	void Add(FFireDynamicObstacles& Obstacles, const FFireObstacle& Obstacle);
+}
@@ -0,0 +1,156 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationEmitterBatch.h"
+
+#include "Algo/BinarySearch.h"
+#include "Engine/StaticMesh.h"
+#include "Math/RandomStream.h"
+#include "StaticMeshResources.h"
+
+static int32 GFireSimulationMaxEmitters = 65536;
+static FAutoConsoleVariableRef CVarFireSimulationMaxEmitters(
+	TEXT("r.FireSimulation.MaxEmitters"),
+	GFireSimulationMaxEmitters,
+	TEXT("Emitters a fire volume collects per step, further emitters of the step are dropped."),
+	ECVF_Default);
+
+static int32 GFireSimulationEmitterMeshPoints = 64;
+static FAutoConsoleVariableRef CVarFireSimulationEmitterMeshPoints(
+	TEXT("r.FireSimulation.EmitterMeshPoints"),
+	GFireSimulationEmitterMeshPoints,
+	TEXT("Points a mesh surface emitter spreads over its mesh, applies to meshes that were not sampled before."),
+	ECVF_Default);
+
+namespace FireSimulationEmitters
+{
+	void Add(FFireEmitterBatch& Batch, const FFireEmitter& Emitter, float DeltaSeconds)
+	{
+		if (Batch.Emitters.Num() >= GFireSimulationMaxEmitters)
+		{
+			return;
+		}
+
+		Batch.Emitters.Add(Scale(Emitter, DeltaSeconds));
+	}
+
+	FFireEmitter Scale(const FFireEmitter& Emitter, float DeltaSeconds)
+	{
+		FFireEmitter Scaled = Emitter;
+		Scaled.Heat *= DeltaSeconds;
+		Scaled.Reaction *= DeltaSeconds;
+		Scaled.Vapor *= DeltaSeconds;
+		Scaled.TemperatureSink *= DeltaSeconds;
+		return Scaled;
+	}
+
+	static TArray<FVector3f> SampleSurface(const UStaticMesh& Mesh)
+	{
+		TArray<FVector3f> Points;
+#if !WITH_EDITOR
+		if (!Mesh.bAllowCPUAccess)
+		{
+			return Points;
+		}
+#endif
+		const FStaticMeshRenderData* RenderData = Mesh.GetRenderData();
+		if (!RenderData || RenderData->LODResources.IsEmpty())
+		{
+			return Points;
+		}
+
+		const FStaticMeshLODResources& Lod = RenderData->LODResources[0];
+		const FPositionVertexBuffer& Positions = Lod.VertexBuffers.PositionVertexBuffer;
+		const int32 NumTriangles = Lod.IndexBuffer.GetNumIndices() / 3;
+		if (NumTriangles == 0 || Positions.GetNumVertices() == 0)
+		{
+			return Points;
+		}
+
+		// triangles are picked by their area, points are uniform within a triangle
+		TArray<float> AreaSums;
+		AreaSums.SetNumUninitialized(NumTriangles);
+		float TotalArea = 0.0f;
+		for (int32 Triangle = 0; Triangle < NumTriangles; ++Triangle)
+		{
+			const FVector3f A = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 0));
+			const FVector3f B = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 1));
+			const FVector3f C = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 2));
+			TotalArea += 0.5f * ((B - A) ^ (C - A)).Size();
+			AreaSums[Triangle] = TotalArea;
+		}
+
+		// a fixed seed keeps the points of a mesh the same across runs
+		FRandomStream Random(0);
+		const int32 NumPoints = FMath::Max(GFireSimulationEmitterMeshPoints, 1);
+		Points.Reserve(NumPoints);
+		for (int32 Point = 0; Point < NumPoints; ++Point)
+		{
+			const int32 Triangle = FMath::Min(Algo::LowerBound(AreaSums, Random.FRand() * TotalArea), NumTriangles - 1);
+			const FVector3f A = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 0));
+			const FVector3f B = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 1));
+			const FVector3f C = Positions.VertexPosition(Lod.IndexBuffer.GetIndex(Triangle * 3 + 2));
+
+			float U = Random.FRand();
+			float V = Random.FRand();
+			if (U + V > 1.0f)
+			{
+				U = 1.0f - U;
+				V = 1.0f - V;
+			}
+			Points.Add(A + U * (B - A) + V * (C - A));
+		}
+		return Points;
+	}
+
+	const TArray<FVector3f>& GetSurfacePoints(const UStaticMesh& Mesh)
+	{
+		check(IsInGameThread());
+		static TMap<TWeakObjectPtr<const UStaticMesh>, TArray<FVector3f>> Cache;
+		if (const TArray<FVector3f>* Points = Cache.Find(&Mesh))
+		{
+			return *Points;
+		}
+
+		// forget the points of unloaded meshes before adding another one
+		for (auto It = Cache.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		return Cache.Add(&Mesh, SampleSurface(Mesh));
+	}
+
+	FFireEmitterRecord MakeRecord(const FFireEmitter& Emitter, const FVector& GridOrigin, FBox& OutBounds)
+	{
+		// points and spheres do not rotate
+		const bool bBox = Emitter.Shape == EFireEmitterShape::Box;
+		const FTransform ShapeToGrid(bBox ? Emitter.Rotation.GetNormalized() : FQuat::Identity, Emitter.Location - GridOrigin);
+
+		// row vectors, so the rows of the shader transform are the columns of the matrix
+		FFireEmitterRecord Record;
+		const FMatrix GridToShape = ShapeToGrid.ToInverseMatrixWithScale();
+		for (int32 Row = 0; Row < 3; ++Row)
+		{
+			Record.GridToShape[Row] = FVector4f(GridToShape.M[0][Row], GridToShape.M[1][Row], GridToShape.M[2][Row], GridToShape.M[3][Row]);
+		}
+
+		FVector Extent = FVector::ZeroVector;
+		if (bBox)
+		{
+			Extent = Emitter.Extent.ComponentMax(FVector::ZeroVector);
+			Record.Extent = FVector4f(FVector3f(Extent), 0.0f);
+		}
+		else if (Emitter.Shape == EFireEmitterShape::Sphere)
+		{
+			Extent = FVector(FMath::Max(Emitter.Radius, 0.0f));
+			Record.Extent = FVector4f(Extent.X, 0.0f, 0.0f, 0.0f);
+		}
+		Record.Extent.W = float(Emitter.Shape);
+		Record.Amount = FVector4f(Emitter.Heat, Emitter.Reaction, Emitter.Vapor, Emitter.TemperatureSink);
+
+		OutBounds = FBox(-Extent, Extent).TransformBy(ShapeToGrid);
+		return Record;
+	}
+}
@@ -0,0 +1,45 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationEmitter.h"
+
+class UStaticMesh;
+
+/** One emitter of a step, layout matches FEmitter in FireSimulation.usf */
+struct FFireEmitterRecord
+{
+	/** Rows of the transform from a position relative to the grid origin into the emitter */
+	FVector4f GridToShape[3];
+	/** Half size of a box or radius of a sphere in x, EFireEmitterShape in w */
+	FVector4f Extent = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+	/** Heat, reaction, vapor and temperature sink of the step */
+	FVector4f Amount = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+};
+static_assert(sizeof(FFireEmitterRecord) == 80, "FFireEmitterRecord has to match FEmitter in FireSimulation.usf");
+
+/** Emitters submitted to a volume since its last step, their rates are already multiplied by the frame time they were submitted for */
+struct FFireEmitterBatch
+{
+	/** World position of the minimum corner of local cell 0 at the step */
+	FVector GridOrigin = FVector::ZeroVector;
+	TArray<FFireEmitter> Emitters;
+};
+
+namespace FireSimulationEmitters
+{
+	/** Adds the amounts Emitter emits over DeltaSeconds, up to r.FireSimulation.MaxEmitters per volume and step */
+	void Add(FFireEmitterBatch& Batch, const FFireEmitter& Emitter, float DeltaSeconds);
+	/** Emitter with the amounts it emits over DeltaSeconds */
+	FFireEmitter Scale(const FFireEmitter& Emitter, float DeltaSeconds);
+
+	/**
+	 * Points spread evenly over the triangles of LOD 0, r.FireSimulation.EmitterMeshPoints per mesh and cached. Empty when a
+	 * cooked mesh keeps no CPU copy of its vertices. Game thread only.
+	 */
+	const TArray<FVector3f>& GetSurfacePoints(const UStaticMesh& Mesh);
+
+	/** Record of an emitter relative to GridOrigin, OutBounds are the bounds of its shape relative to GridOrigin */
+	FFireEmitterRecord MakeRecord(const FFireEmitter& Emitter, const FVector& GridOrigin, FBox& OutBounds);
+}
@@ -0,0 +1,83 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationField.h"
+
+#include "Misc/ScopeRWLock.h"
+
+FFireFieldStaleness FFireSimulationField::Query(TConstArrayView<FVector> Positions, TArrayView<FFireFieldSample> OutSamples) const
+{
+	check(OutSamples.Num() >= Positions.Num());
+
+	FFireFieldStaleness Staleness;
+	const TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> Field = GetSnapshot();
+	if (!Field.IsValid())
+	{
+		for (int32 Index = 0; Index < Positions.Num(); ++Index)
+		{
+			OutSamples[Index] = FFireFieldSample();
+		}
+		return Staleness;
+	}
+
+	Staleness.bValid = true;
+	Staleness.Step = Field->Step;
+	Staleness.StepsBehind = NumSteps.load(std::memory_order_relaxed) - Field->Step;
+	Staleness.AgeSeconds = FPlatformTime::Seconds() - Field->Time;
+
+	const FIntVector& Resolution = Field->Resolution;
+	const auto CellIndex = [&Resolution](int32 X, int32 Y, int32 Z) { return (Z * Resolution.Y + Y) * Resolution.X + X; };
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		FFireFieldSample& Sample = OutSamples[Index];
+		Sample = FFireFieldSample();
+
+		const FVector Local = Positions[Index] - Field->GridOrigin;
+		if (Local.X < 0.0 || Local.Y < 0.0 || Local.Z < 0.0 || Local.X > Field->Size.X || Local.Y > Field->Size.Y || Local.Z > Field->Size.Z)
+		{
+			continue;
+		}
+
+		// cell centers are the nodes of the blend, positions within half a cell of the border take the border cells
+		const FVector Cell = Local / Field->CellSize - 0.5;
+		const FIntVector Low(FMath::FloorToInt32(Cell.X), FMath::FloorToInt32(Cell.Y), FMath::FloorToInt32(Cell.Z));
+		const FVector3f Weight(FVector(Cell.X - Low.X, Cell.Y - Low.Y, Cell.Z - Low.Z));
+		FVector4f Fluid = FVector4f(0.0f, 0.0f, 0.0f, 0.0f);
+		FVector3f Velocity = FVector3f::ZeroVector;
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			const int32 X = FMath::Clamp(Low.X + (Corner & 1), 0, Resolution.X - 1);
+			const int32 Y = FMath::Clamp(Low.Y + ((Corner >> 1) & 1), 0, Resolution.Y - 1);
+			const int32 Z = FMath::Clamp(Low.Z + (Corner >> 2), 0, Resolution.Z - 1);
+			const float CornerWeight = ((Corner & 1) ? Weight.X : 1.0f - Weight.X)
+				* (((Corner >> 1) & 1) ? Weight.Y : 1.0f - Weight.Y)
+				* ((Corner >> 2) ? Weight.Z : 1.0f - Weight.Z);
+			Fluid += CornerWeight * Field->Fluid[CellIndex(X, Y, Z)];
+			Velocity += CornerWeight * Field->Velocity[CellIndex(X, Y, Z)];
+		}
+		Sample.Temperature = Fluid.X;
+		Sample.Reaction = Fluid.Y;
+		Sample.Smoke = Fluid.Z;
+		Sample.Velocity = FVector(Velocity);
+	}
+	return Staleness;
+}
+
+TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> FFireSimulationField::GetSnapshot() const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Snapshot;
+}
+
+uint32 FFireSimulationField::AdvanceStep()
+{
+	return NumSteps.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void FFireSimulationField::Publish(const TSharedRef<const FFireFieldSnapshot, ESPMode::ThreadSafe>& InSnapshot)
+{
+	FWriteScopeLock WriteLock(Lock);
+	if (!Snapshot.IsValid() || Snapshot->Step <= InSnapshot->Step)
+	{
+		Snapshot = InSnapshot;
+	}
+}
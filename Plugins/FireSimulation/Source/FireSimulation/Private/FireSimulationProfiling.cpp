@@ -0,0 +1,32 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationProfiling.h"
+
+#include "HAL/IConsoleManager.h"
+
+UE_TRACE_CHANNEL_DEFINE(FireSimulationChannel);
+CSV_DEFINE_CATEGORY(FireSimulation, false);
+
+static void OnFireSimulationProfileChanged(IConsoleVariable* Variable);
+
+static TAutoConsoleVariable<int32> CVarFireSimulationProfile(
+	TEXT("r.FireSimulation.Profile"),
+	0,
+	TEXT("0: off (default)\n")
+	TEXT("1: per stage CPU and GPU scopes, the FireSimulation trace channel and CSV category with cell counts per stage and volume"),
+	FConsoleVariableDelegate::CreateStatic(&OnFireSimulationProfileChanged),
+	ECVF_Default);
+
+static void OnFireSimulationProfileChanged(IConsoleVariable* Variable)
+{
+	const bool bEnabled = Variable->GetInt() != 0;
+	UE::Trace::ToggleChannel(TEXT("FireSimulation"), bEnabled);
+#if CSV_PROFILER
+	FCsvProfiler::Get()->EnableCategoryByIndex(CSV_CATEGORY_INDEX(FireSimulation), bEnabled);
+#endif
+}
+
+bool FireSimulationProfiling::IsEnabled()
+{
+	return CVarFireSimulationProfile.GetValueOnAnyThread() != 0;
+}
@@ -0,0 +1,33 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "RenderGraphEvent.h"
+#include "Trace/Trace.h"
+
+/** Per stage scopes of a step, enabled together with the CSV category by r.FireSimulation.Profile */
+UE_TRACE_CHANNEL_EXTERN(FireSimulationChannel);
+CSV_DECLARE_CATEGORY_EXTERN(FireSimulation);
+
+namespace FireSimulationProfiling
+{
+	/** True while r.FireSimulation.Profile is set, any thread */
+	bool IsEnabled();
+}
+
+/** Insights CPU event on the FireSimulation channel and CSV timing stat of a stage, free while both are disabled */
+#define FIRE_SIMULATION_CPU_STAGE_SCOPE(Stage) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(FireSimulation_##Stage, FireSimulationChannel); \
+	CSV_SCOPED_TIMING_STAT(FireSimulation, Stage)
+
+/** CPU scope of a stage plus a GPU event around the passes it records, shown by ProfileGPU and the GPU track of Insights */
+#define FIRE_SIMULATION_STAGE_SCOPE(GraphBuilder, Stage) \
+	FIRE_SIMULATION_CPU_STAGE_SCOPE(Stage); \
+	RDG_EVENT_SCOPE_CONDITIONAL(GraphBuilder, FireSimulationProfiling::IsEnabled(), #Stage)
+
+/** Accumulates the cells a stage processed this frame into the CSV stat <Stage>Cells */
+#define FIRE_SIMULATION_STAGE_CELLS(Stage, NumCells) \
+	CSV_CUSTOM_STAT(FireSimulation, Stage##Cells, int32(NumCells), ECsvCustomStatOp::Accumulate)
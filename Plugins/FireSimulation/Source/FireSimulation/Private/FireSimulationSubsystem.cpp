@@ -0,0 +1,628 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationSubsystem.h"
+
+#include "FireSimulation.h"
+#include "FireSimulationAtlas.h"
+#include "FireSimulationCascade.h"
+#include "FireSimulationCommands.h"
+#include "FireSimulationContext.h"
+#include "FireSimulationCpuContext.h"
+#include "FireSimulationDynamicObstacles.h"
+#include "FireSimulationEmitterBatch.h"
+#include "FireSimulationProfiling.h"
+#include "FireSimulatorVolume.h"
+#include "RenderGraphBuilder.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "RenderingThread.h"
+
+static TAutoConsoleVariable<float> CVarFireSimulationFixedRate(
+	TEXT("r.FireSimulation.FixedRate"),
+	30.0f,
+	TEXT("Steps per second of every fire volume, independent of the frame rate. 0 steps every volume once per frame."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireSimulationFrameBudgetMs(
+	TEXT("r.FireSimulation.FrameBudgetMs"),
+	4.0f,
+	TEXT("Milliseconds of simulation steps per frame, due steps beyond it are deferred to later frames by priority.\n")
+	TEXT("The most important due step always runs. 0 disables the budget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireSimulationGpuNsPerCell(
+	TEXT("r.FireSimulation.GpuNsPerCell"),
+	0.5f,
+	TEXT("Estimated GPU nanoseconds per velocity and fluid cell of a step, used to charge GPU steps against r.FireSimulation.FrameBudgetMs"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireSimulationLodScreenSize(
+	TEXT("r.FireSimulation.LodScreenSize"),
+	0.5f,
+	TEXT("Ratio of the radius of a fire volume to its view distance below which it halves its resolution, once per halving\n")
+	TEXT("of the ratio, down to r.FireSimulation.LodMinResolution. 0 keeps the full resolution."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireSimulationLodHysteresis(
+	TEXT("r.FireSimulation.LodHysteresis"),
+	0.25f,
+	TEXT("Fraction of a LOD level the screen coverage has to move past a level boundary before the resolution changes"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireSimulationScheduleDistance(
+	TEXT("r.FireSimulation.ScheduleDistance"),
+	5000.0f,
+	TEXT("Distance from the view at which the priority of a volume halves when steps are deferred"),
+	ECVF_Default);
+
+DECLARE_STATS_GROUP(TEXT("FireSimulation"), STATGROUP_FireSimulation, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("FireSimulation Tick"), STAT_FireSimulation_Tick, STATGROUP_FireSimulation);
+DECLARE_CYCLE_STAT(TEXT("FireSimulation Execute"), STAT_FireSimulation_Execute, STATGROUP_FireSimulation);
+DECLARE_CYCLE_STAT(TEXT("FireSimulation Cpu Step"), STAT_FireSimulation_CpuStep, STATGROUP_FireSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Volumes"), STAT_FireSimulation_ActiveVolumes, STATGROUP_FireSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stepped Volumes"), STAT_FireSimulation_SteppedVolumes, STATGROUP_FireSimulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Steps"), STAT_FireSimulation_DeferredSteps, STATGROUP_FireSimulation);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Scheduled Ms"), STAT_FireSimulation_ScheduledMs, STATGROUP_FireSimulation);
+DECLARE_MEMORY_STAT(TEXT("GPU Memory"), STAT_FireSimulation_GpuMemory, STATGROUP_FireSimulation);
+DECLARE_MEMORY_STAT(TEXT("GPU Memory Budget"), STAT_FireSimulation_GpuMemoryBudget, STATGROUP_FireSimulation);
+DECLARE_MEMORY_STAT(TEXT("CPU Memory"), STAT_FireSimulation_CpuMemory, STATGROUP_FireSimulation);
+DECLARE_MEMORY_STAT(TEXT("Largest Volume"), STAT_FireSimulation_LargestVolume, STATGROUP_FireSimulation);
+
+DECLARE_GPU_STAT(FireSimulation);
+
+namespace FireSimulation
+{
+	struct FStep
+	{
+		FFireSimulationContextPtr Context;
+		FFireSimulationConfig Config;
+		/** Velocity resolution of the LOD level, zero for volumes in an atlas */
+		FIntVector Resolution = FIntVector::ZeroValue;
+		/** World cell the grid of a scrolling volume starts at */
+		FIntVector GridCell = FIntVector::ZeroValue;
+		/** Coarser levels of a cascaded volume and the focus point they scroll to */
+		FFireSimulationCascadePtr Cascade;
+		FVector Location = FVector::ZeroVector;
+		/** World position of the minimum corner of local cell 0 of a standalone volume */
+		FVector GridOrigin = FVector::ZeroVector;
+		/** Moving bodies inside a standalone volume with Config.bDynamicObstacles */
+		FFireDynamicObstacles DynamicObstacles;
+		/** Emitters submitted to a standalone volume since its last step */
+		FFireEmitterBatch Emitters;
+		/** Edits from other threads, drained on the rendering thread */
+		FFireSimulationCommandQueuePtr CommandQueue;
+	};
+
+	/** A volume or atlas whose clock is due this frame */
+	struct FScheduledStep
+	{
+		FFireSimulationSchedule* Schedule = nullptr;
+		int32 Volume = INDEX_NONE;
+		int32 Atlas = INDEX_NONE;
+		float Priority = 0.0f;
+		float CostMs = 0.0f;
+	};
+
+	/** A deferred clock catches up at most this many steps, beyond that the simulation slows down */
+	static constexpr float MaxLagSteps = 4.0f;
+	/** Priority of volumes whose owner was not rendered recently */
+	static constexpr float OffscreenWeight = 0.25f;
+
+	static float EstimateGpuCostMs(const FFireSimulationContext& Context)
+	{
+		const double NumCells = double(Context.GetVelocityResolution().X) * Context.GetVelocityResolution().Y * Context.GetVelocityResolution().Z
+			+ double(Context.GetFluidResolution().X) * Context.GetFluidResolution().Y * Context.GetFluidResolution().Z;
+		return float(NumCells * CVarFireSimulationGpuNsPerCell.GetValueOnGameThread() * 1.0e-6);
+	}
+
+	/**
+	 * Level whose range of log2(LodScreenSize / coverage) holds the coverage of the volume. The level only changes once the
+	 * coverage moves r.FireSimulation.LodHysteresis of a level past the boundary, so a volume near a boundary does not thrash.
+	 */
+	static int32 UpdateLodLevel(const FFireSimulationContext& Context, const UFireSimulatorVolume* Volume, const FVector* ViewLocation, int32 LodLevel)
+	{
+		const float ScreenSize = CVarFireSimulationLodScreenSize.GetValueOnGameThread();
+		if (!ViewLocation || ScreenSize <= 0.0f)
+		{
+			return 0;
+		}
+
+		const float Radius = 0.5f * Context.GetLocalSize().Size();
+		const float Distance = FMath::Max(FVector::Distance(*ViewLocation, Volume->GetComponentLocation()), 1.0f);
+		const float Level = FMath::Log2(FMath::Max(ScreenSize * Distance / FMath::Max(Radius, 1.0f), 1.0f));
+		const float Hysteresis = FMath::Max(CVarFireSimulationLodHysteresis.GetValueOnGameThread(), 0.0f);
+		if (Level >= LodLevel + 1 + Hysteresis || Level < LodLevel - Hysteresis)
+		{
+			LodLevel = FMath::FloorToInt32(Level);
+		}
+		return FMath::Clamp(LodLevel, 0, Context.GetNumLodLevels() - 1);
+	}
+
+	/** Halves with every r.FireSimulation.ScheduleDistance from the view, quartered while off-screen */
+	static float GetImportance(const UFireSimulatorVolume* Volume, const FVector* ViewLocation)
+	{
+		float Importance = 1.0f;
+		if (ViewLocation)
+		{
+			const float Distance = FVector::Distance(*ViewLocation, Volume->GetComponentLocation());
+			Importance /= 1.0f + Distance / FMath::Max(CVarFireSimulationScheduleDistance.GetValueOnGameThread(), 1.0f);
+		}
+
+		// owners without primitives never render, they count as visible
+		const AActor* Owner = Volume->GetOwner();
+		if (Owner && Owner->FindComponentByClass<UPrimitiveComponent>() && !Owner->WasRecentlyRendered(0.2f))
+		{
+			Importance *= OffscreenWeight;
+		}
+		return Importance;
+	}
+
+	/** Memory a volume owns, volumes in an atlas share the memory of the atlas */
+	static uint64 GetVolumeBytes(const UFireSimulatorVolume* Volume)
+	{
+		if (const FFireSimulationContextPtr& Context = Volume->GetContext(); Context.IsValid())
+		{
+			const uint64 CascadeBytes = Volume->GetCascade().IsValid() ? Volume->GetCascade()->GetPlannedBytes() : 0;
+			return Context->GetAtlas() ? 0 : Context->GetPlannedBytes() + CascadeBytes;
+		}
+		if (const FFireSimulationCpuContextPtr& CpuContext = Volume->GetCpuContext(); CpuContext.IsValid())
+		{
+			return CpuContext->GetAllocatedBytes();
+		}
+		return 0;
+	}
+
+	static double ToMegabytes(uint64 Bytes)
+	{
+		return Bytes / (1024.0 * 1024.0);
+	}
+}
+
+static FAutoConsoleCommandWithWorld CCmdFireSimulationMemoryReport(
+	TEXT("r.FireSimulation.MemoryReport"),
+	TEXT("Logs the memory of every fire volume and atlas of the world and the totals against r.FireSimulation.MemoryBudgetMB"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UFireSimulationSubsystem* Subsystem = World ? World->GetSubsystem<UFireSimulationSubsystem>() : nullptr)
+		{
+			Subsystem->LogMemoryReport();
+		}
+	}));
+
+void UFireSimulationSubsystem::Register(UFireSimulatorVolume* Volume)
+{
+	LLM_SCOPE_BYTAG(FireSimulation);
+	check(Volume);
+	if (Volumes.Contains(Volume))
+	{
+		return;
+	}
+	Volumes.Add(Volume);
+	Schedules.Add(MakeSchedule());
+
+	const FFireSimulationContextPtr& Context = Volume->GetContext();
+	const FFireSimulationConfig& Config = Volume->GetConfig();
+	if (Context.IsValid() && Config.bUseAtlas && !Config.bScrolling && FFireSimulationAtlas::CanHold(Context->GetVelocityResolution()))
+	{
+		for (const FFireSimulationAtlasPtr& Atlas : Atlases)
+		{
+			if (Atlas->IsCompatible(Config))
+			{
+				if (const int32 Slot = Atlas->AllocateSlot(); Slot != INDEX_NONE)
+				{
+					Context->SetAtlasSlot(Atlas, Slot);
+					return;
+				}
+			}
+		}
+
+		const FFireSimulationAtlasPtr& Atlas = Atlases.Add_GetRef(MakeShared<FFireSimulationAtlas, ESPMode::ThreadSafe>(Config));
+		AtlasSchedules.Add(MakeSchedule());
+		Context->SetAtlasSlot(Atlas, Atlas->AllocateSlot());
+	}
+}
+
+void UFireSimulationSubsystem::Unregister(UFireSimulatorVolume* Volume)
+{
+	if (const int32 Index = Volumes.Find(Volume); Index != INDEX_NONE)
+	{
+		Volumes.RemoveAtSwap(Index);
+		Schedules.RemoveAtSwap(Index);
+	}
+
+	const FFireSimulationContextPtr& Context = Volume->GetContext();
+	if (Context.IsValid() && Context->GetAtlas())
+	{
+		Context->GetAtlas()->ReleaseSlot(Context->GetAtlasSlot());
+	}
+}
+
+void UFireSimulationSubsystem::Deinitialize()
+{
+	// render resources of the atlases have to be released on the rendering thread
+	ENQUEUE_RENDER_COMMAND(ReleaseFireSimulationAtlases)(
+		[Atlases = MoveTemp(Atlases)](FRHICommandListImmediate&)
+	{
+	});
+	AtlasSchedules.Reset();
+
+	Super::Deinitialize();
+}
+
+FFireSimulationSchedule UFireSimulationSubsystem::MakeSchedule()
+{
+	// golden ratio phases keep the due frames of any number of clocks spread over a step
+	const float FixedRate = CVarFireSimulationFixedRate.GetValueOnGameThread();
+	FFireSimulationSchedule Schedule;
+	Schedule.Accumulator = FixedRate > 0.0f ? FMath::Frac(NumClocks * UE_GOLDEN_RATIO) / FixedRate : 0.0f;
+	++NumClocks;
+	return Schedule;
+}
+
+const FFireSimulationSchedule* UFireSimulationSubsystem::FindSchedule(const UFireSimulatorVolume* Volume) const
+{
+	const int32 Index = Volumes.Find(const_cast<UFireSimulatorVolume*>(Volume));
+	if (Index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	const FFireSimulationContextPtr& Context = Volume->GetContext();
+	if (Context.IsValid() && Context->GetAtlas())
+	{
+		const int32 AtlasIndex = Atlases.IndexOfByPredicate([&Context](const FFireSimulationAtlasPtr& Atlas) { return Atlas.Get() == Context->GetAtlas(); });
+		return AtlasSchedules.IsValidIndex(AtlasIndex) ? &AtlasSchedules[AtlasIndex] : nullptr;
+	}
+	return &Schedules[Index];
+}
+
+float UFireSimulationSubsystem::GetInterpolationAlpha(const UFireSimulatorVolume* Volume) const
+{
+	const FFireSimulationSchedule* Schedule = FindSchedule(Volume);
+	return Schedule ? Schedule->Alpha : 1.0f;
+}
+
+uint64 UFireSimulationSubsystem::GetGpuBytes() const
+{
+	uint64 Bytes = 0;
+	for (const UFireSimulatorVolume* Volume : Volumes)
+	{
+		if (Volume && Volume->GetContext().IsValid())
+		{
+			Bytes += FireSimulation::GetVolumeBytes(Volume);
+		}
+	}
+	for (const FFireSimulationAtlasPtr& Atlas : Atlases)
+	{
+		Bytes += Atlas->GetPlannedBytes();
+	}
+	return Bytes;
+}
+
+void UFireSimulationSubsystem::LogMemoryReport() const
+{
+	using namespace FireSimulation;
+
+	uint64 CpuBytes = 0;
+	UE_LOG(LogFireSimulation, Display, TEXT("Fire simulation memory of %d volumes and %d atlases"), Volumes.Num(), Atlases.Num());
+	for (const UFireSimulatorVolume* Volume : Volumes)
+	{
+		if (!Volume)
+		{
+			continue;
+		}
+
+		const uint64 Bytes = GetVolumeBytes(Volume);
+		if (const FFireSimulationContextPtr& Context = Volume->GetContext(); Context.IsValid())
+		{
+			const FIntVector& Resolution = Context->GetVelocityResolution();
+			const FIntVector& FluidResolution = Context->GetFluidResolution();
+			UE_LOG(LogFireSimulation, Display, TEXT("  %-48s GPU %3dx%3dx%3d fluid %3dx%3dx%3d %8.2f MB%s"), *Volume->GetReadableName(),
+				Resolution.X, Resolution.Y, Resolution.Z, FluidResolution.X, FluidResolution.Y, FluidResolution.Z, ToMegabytes(Bytes),
+				Context->GetAtlas() ? TEXT(" (atlas)") : TEXT(""));
+		}
+		else if (const FFireSimulationCpuContextPtr& CpuContext = Volume->GetCpuContext(); CpuContext.IsValid())
+		{
+			const FIntVector& Resolution = CpuContext->GetVelocityResolution();
+			const FIntVector& FluidResolution = CpuContext->GetFluidResolution();
+			UE_LOG(LogFireSimulation, Display, TEXT("  %-48s CPU %3dx%3dx%3d fluid %3dx%3dx%3d %8.2f MB"), *Volume->GetReadableName(),
+				Resolution.X, Resolution.Y, Resolution.Z, FluidResolution.X, FluidResolution.Y, FluidResolution.Z, ToMegabytes(Bytes));
+			CpuBytes += Bytes;
+		}
+	}
+
+	for (const FFireSimulationAtlasPtr& Atlas : Atlases)
+	{
+		const FIntVector& Resolution = Atlas->GetVelocityResolution();
+		UE_LOG(LogFireSimulation, Display, TEXT("  Atlas %dx%dx%d, %d of %d slots used %8.2f MB"),
+			Resolution.X, Resolution.Y, Resolution.Z, Atlas->GetNumUsedSlots(), Atlas->GetNumSlots(), ToMegabytes(Atlas->GetPlannedBytes()));
+	}
+
+	const uint64 Budget = FFireSimulationContext::GetMemoryBudgetBytes();
+	const uint64 GpuBytes = GetGpuBytes();
+	UE_LOG(LogFireSimulation, Display, TEXT("Total GPU %.2f MB of %s, CPU %.2f MB"), ToMegabytes(GpuBytes),
+		Budget > 0 ? *FString::Printf(TEXT("%.2f MB budget"), ToMegabytes(Budget)) : TEXT("no budget"), ToMegabytes(CpuBytes));
+}
+
+void UFireSimulationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FireSimulation_Tick);
+	using namespace FireSimulation;
+
+	const float FixedRate = CVarFireSimulationFixedRate.GetValueOnGameThread();
+	const float StepTime = FixedRate > 0.0f ? 1.0f / FixedRate : DeltaTime;
+	if (StepTime <= 0.0f)
+	{
+		return;
+	}
+
+	FVector ViewLocation = FVector::ZeroVector;
+	bool bHasView = false;
+	if (const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController())
+	{
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		bHasView = true;
+	}
+
+	// every active volume outside of an atlas and every atlas with an active volume runs its own clock
+	TArray<FScheduledStep> DueSteps;
+	TArray<FScheduledStep> AtlasSteps;
+	AtlasSteps.SetNum(Atlases.Num());
+	int32 NumActiveVolumes = 0;
+	uint64 CpuBytes = 0;
+	uint64 LargestVolumeBytes = 0;
+	for (int32 Index = 0; Index < Volumes.Num(); ++Index)
+	{
+		const UFireSimulatorVolume* Volume = Volumes[Index];
+		if (!Volume)
+		{
+			continue;
+		}
+
+		const uint64 Bytes = GetVolumeBytes(Volume);
+		LargestVolumeBytes = FMath::Max(LargestVolumeBytes, Bytes);
+		CpuBytes += Volume->GetCpuContext().IsValid() ? Bytes : 0;
+
+		const FFireSimulationContextPtr& Context = Volume->GetContext();
+		if (!Volume->IsActive() || (!Context.IsValid() && !Volume->GetCpuContext().IsValid()))
+		{
+			continue;
+		}
+		++NumActiveVolumes;
+
+		const float Importance = GetImportance(Volume, bHasView ? &ViewLocation : nullptr);
+		if (Context.IsValid() && Context->GetAtlas())
+		{
+			const int32 AtlasIndex = Atlases.IndexOfByPredicate([&Context](const FFireSimulationAtlasPtr& Atlas) { return Atlas.Get() == Context->GetAtlas(); });
+			FScheduledStep& AtlasStep = AtlasSteps[AtlasIndex];
+			AtlasStep.Schedule = &AtlasSchedules[AtlasIndex];
+			AtlasStep.Atlas = AtlasIndex;
+			AtlasStep.Priority = FMath::Max(AtlasStep.Priority, Importance);
+			AtlasStep.CostMs += EstimateGpuCostMs(*Context);
+			continue;
+		}
+
+		FFireSimulationSchedule& Schedule = Schedules[Index];
+		// a scrolling grid wraps its addressing, resampling would have to unwrap it first
+		if (Context.IsValid() && !Volume->GetConfig().bScrolling)
+		{
+			Schedule.LodLevel = UpdateLodLevel(*Context, Volume, bHasView ? &ViewLocation : nullptr, Schedule.LodLevel);
+		}
+		Schedule.Accumulator += DeltaTime;
+		if (Schedule.Accumulator >= StepTime)
+		{
+			// the coarser levels of a cascade take turns, so a step costs at most two levels
+			const float CostMs = Context.IsValid() ? EstimateGpuCostMs(*Context) * (Volume->GetCascade().IsValid() ? 2.0f : 1.0f) : Schedule.CostMs;
+			DueSteps.Add({ &Schedule, Index, INDEX_NONE, Importance * Schedule.Accumulator / StepTime, CostMs });
+		}
+	}
+
+	for (FScheduledStep& AtlasStep : AtlasSteps)
+	{
+		if (AtlasStep.Schedule)
+		{
+			AtlasStep.Schedule->Accumulator += DeltaTime;
+			if (AtlasStep.Schedule->Accumulator >= StepTime)
+			{
+				AtlasStep.Priority *= AtlasStep.Schedule->Accumulator / StepTime;
+				DueSteps.Add(AtlasStep);
+			}
+		}
+	}
+
+	// the longer a step is overdue the higher its priority, so deferred volumes are not starved
+	DueSteps.Sort([](const FScheduledStep& A, const FScheduledStep& B) { return A.Priority > B.Priority; });
+
+	const float BudgetMs = CVarFireSimulationFrameBudgetMs.GetValueOnGameThread();
+	float ScheduledMs = 0.0f;
+	int32 NumDeferred = 0;
+	TArray<FStep> Steps;
+	Steps.Reserve(DueSteps.Num());
+	TBitArray<> SteppedAtlases(false, Atlases.Num());
+	int32 NumCpuSteps = 0;
+	for (const FScheduledStep& Due : DueSteps)
+	{
+		if (BudgetMs > 0.0f && ScheduledMs > 0.0f && ScheduledMs + Due.CostMs > BudgetMs)
+		{
+			++NumDeferred;
+			continue;
+		}
+		ScheduledMs += Due.CostMs;
+		Due.Schedule->Accumulator -= StepTime;
+
+		if (Due.Atlas != INDEX_NONE)
+		{
+			SteppedAtlases[Due.Atlas] = true;
+			continue;
+		}
+
+		UFireSimulatorVolume* Volume = Volumes[Due.Volume];
+		const FIntVector* Resolution = nullptr;
+		if (const FFireSimulationContextPtr& Context = Volume->GetContext(); Context.IsValid())
+		{
+			FStep& Step = Steps.Add_GetRef({ Context, Volume->GetConfig(), Context->GetLodResolution(Due.Schedule->LodLevel, Volume->GetConfig()),
+				Context->ComputeGridCell(Volume->GetComponentLocation()), Volume->GetCascade(), Volume->GetComponentLocation() });
+			if (!Context->GetAtlas())
+			{
+				const FVector Size(Context->GetLocalSize());
+				const FVector GridOrigin = Step.Config.bScrolling ? FVector(Step.GridCell) / FVector(Context->GetWorldToGrid()) : Step.Location - 0.5 * Size;
+				if (Step.Config.bDynamicObstacles)
+				{
+					Step.DynamicObstacles = FireSimulationObstacles::Gather(*GetWorld(), GridOrigin, Size);
+				}
+				Volume->ConsumeEmitters(Step.Emitters);
+				Step.Emitters.GridOrigin = GridOrigin;
+				Step.GridOrigin = GridOrigin;
+				Step.CommandQueue = Volume->GetCommandQueue();
+			}
+			Resolution = &Context->GetVelocityResolution();
+		}
+		else
+		{
+			// every stage of a CPU step runs in parallel over the cells, so volumes are stepped one after the other
+			SCOPE_CYCLE_COUNTER(STAT_FireSimulation_CpuStep);
+			const double StartTime = FPlatformTime::Seconds();
+			FFireSimulationCpuContext& CpuContext = *Volume->GetCpuContext();
+			FFireEmitterBatch Emitters;
+			Volume->ConsumeEmitters(Emitters);
+			Emitters.GridOrigin = Volume->GetComponentLocation() - 0.5 * FVector(CpuContext.GetLocalSize());
+			CpuContext.SetEmitters(Emitters);
+			CpuContext.SetGridOrigin(Emitters.GridOrigin);
+			CpuContext.Step(StepTime, Volume->GetConfig());
+			const float StepMs = float((FPlatformTime::Seconds() - StartTime) * 1000.0);
+			Due.Schedule->CostMs = Due.Schedule->CostMs > 0.0f ? FMath::Lerp(Due.Schedule->CostMs, StepMs, 0.25f) : StepMs;
+			++NumCpuSteps;
+			Resolution = &CpuContext.GetVelocityResolution();
+		}
+		CSV_CUSTOM_STAT(FireSimulation, MaxVolumeCells, Resolution->X * Resolution->Y * Resolution->Z, ECsvCustomStatOp::Max);
+	}
+
+	// volumes of an atlas are stepped together, slots left out of a step would lose their state
+	for (const UFireSimulatorVolume* Volume : Volumes)
+	{
+		const FFireSimulationContext* Context = Volume && Volume->IsActive() ? Volume->GetContext().Get() : nullptr;
+		if (Context && Context->GetAtlas())
+		{
+			const int32 AtlasIndex = Atlases.IndexOfByPredicate([Context](const FFireSimulationAtlasPtr& Atlas) { return Atlas.Get() == Context->GetAtlas(); });
+			if (SteppedAtlases[AtlasIndex])
+			{
+				Steps.Add({ Volume->GetContext(), Volume->GetConfig() });
+				const FIntVector& Resolution = Context->GetVelocityResolution();
+				CSV_CUSTOM_STAT(FireSimulation, MaxVolumeCells, Resolution.X * Resolution.Y * Resolution.Z, ECsvCustomStatOp::Max);
+			}
+		}
+	}
+
+	// a deferred clock slows the volume down instead of catching up with a burst of steps
+	const auto UpdateClock = [FixedRate, StepTime](FFireSimulationSchedule& Schedule)
+	{
+		Schedule.Accumulator = FMath::Min(Schedule.Accumulator, StepTime * MaxLagSteps);
+		Schedule.Alpha = FixedRate > 0.0f ? FMath::Clamp(Schedule.Accumulator / StepTime, 0.0f, 1.0f) : 1.0f;
+	};
+	for (FFireSimulationSchedule& Schedule : Schedules)
+	{
+		UpdateClock(Schedule);
+	}
+	for (FFireSimulationSchedule& Schedule : AtlasSchedules)
+	{
+		UpdateClock(Schedule);
+	}
+
+	SET_DWORD_STAT(STAT_FireSimulation_ActiveVolumes, NumActiveVolumes);
+	SET_DWORD_STAT(STAT_FireSimulation_SteppedVolumes, Steps.Num() + NumCpuSteps);
+	SET_DWORD_STAT(STAT_FireSimulation_DeferredSteps, NumDeferred);
+	SET_FLOAT_STAT(STAT_FireSimulation_ScheduledMs, ScheduledMs);
+	SET_MEMORY_STAT(STAT_FireSimulation_GpuMemory, GetGpuBytes());
+	SET_MEMORY_STAT(STAT_FireSimulation_GpuMemoryBudget, FFireSimulationContext::GetMemoryBudgetBytes());
+	SET_MEMORY_STAT(STAT_FireSimulation_CpuMemory, CpuBytes);
+	SET_MEMORY_STAT(STAT_FireSimulation_LargestVolume, LargestVolumeBytes);
+	CSV_CUSTOM_STAT(FireSimulation, Volumes, NumActiveVolumes, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(FireSimulation, SteppedVolumes, Steps.Num() + NumCpuSteps, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(FireSimulation, DeferredSteps, NumDeferred, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(FireSimulation, ScheduledMs, ScheduledMs, ECsvCustomStatOp::Set);
+	if (Steps.IsEmpty())
+	{
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(FireSimulationDispatch)(
+		[Steps = MoveTemp(Steps), StepTime](FRHICommandListImmediate& CommandList) mutable
+	{
+		// the graph holds only fire simulation passes, so its allocations during Execute are tagged as well
+		LLM_SCOPE_BYTAG(FireSimulation);
+		FRDGBuilder GraphBuilder(CommandList);
+		{
+			SCOPE_CYCLE_COUNTER(STAT_FireSimulation_Execute);
+			RDG_EVENT_SCOPE(GraphBuilder, "FireSimulation");
+			RDG_GPU_STAT_SCOPE(GraphBuilder, FireSimulation);
+
+			TMap<FFireSimulationAtlas*, TArray<FFireSimulationBrick>> AtlasBricks;
+			for (FireSimulation::FStep& Step : Steps)
+			{
+				if (FFireSimulationAtlas* Atlas = Step.Context->GetAtlas())
+				{
+					FFireSimulationBrick& Brick = AtlasBricks.FindOrAdd(Atlas).AddDefaulted_GetRef();
+					Brick.Slot = Step.Context->GetAtlasSlot();
+					Brick.VelocityResolution = Step.Context->GetVelocityResolution();
+					Brick.WorldToGrid = Step.Context->GetWorldToGrid();
+					Brick.TScale = Step.Context->GetTScale();
+					Brick.bReset = Step.Context->ConsumeAtlasReset();
+				}
+				else
+				{
+					// edits submitted from other threads since the last step, the latest submitted config replaces the one of the volume
+					TArray<FFireImpulse> Impulses;
+					if (Step.CommandQueue.IsValid())
+					{
+						FireSimulationCommands::Drain(*Step.CommandQueue, Step.Config, Step.Emitters, Step.Config.bDynamicObstacles ? &Step.DynamicObstacles : nullptr, Impulses);
+					}
+
+					Step.Context->SetGridOrigin(Step.GridOrigin);
+					Step.Context->AddResamplePasses(GraphBuilder, Step.Resolution);
+					if (Step.Config.bScrolling)
+					{
+						Step.Context->AddScrollPasses(GraphBuilder, Step.GridCell);
+					}
+					if (Step.Config.bDynamicObstacles)
+					{
+						Step.Context->SetDynamicObstacles(Step.DynamicObstacles);
+					}
+					if (!Step.Emitters.Emitters.IsEmpty())
+					{
+						Step.Context->SetEmitters(Step.Emitters);
+					}
+					if (!Impulses.IsEmpty())
+					{
+						Step.Context->SetImpulses(Impulses);
+					}
+					if (Step.Cascade.IsValid())
+					{
+						Step.Cascade->AddPasses(GraphBuilder, StepTime, Step.Config, *Step.Context, Step.Location);
+					}
+					else
+					{
+						Step.Context->AddPasses(GraphBuilder, StepTime, Step.Config);
+					}
+				}
+			}
+
+			for (const TPair<FFireSimulationAtlas*, TArray<FFireSimulationBrick>>& Pair : AtlasBricks)
+			{
+				Pair.Key->AddPasses(GraphBuilder, StepTime, Pair.Value);
+			}
+		}
+		GraphBuilder.Execute();
+	});
+}
+
+TStatId UFireSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFireSimulationSubsystem, STATGROUP_Tickables);
+}
+
+bool UFireSimulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,322 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationVoxelizer.h"
+
+#include "FireSimulation.h"
+#include "FireSimulatorVolume.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Tasks/Task.h"
+#include "UObject/GarbageCollection.h"
+
+static int32 GFireSimulationObstacleCache = 1;
+static FAutoConsoleVariableRef CVarFireSimulationObstacleCache(
+	TEXT("r.FireSimulation.ObstacleCache"),
+	GFireSimulationObstacleCache,
+	TEXT("0: voxelize the static obstacles of every volume at BeginPlay\n")
+	TEXT("1: load them from Saved/FireSimulation/Obstacles and voxelize only changed primitives (default)"),
+	ECVF_Default);
+
+namespace FireVoxelizer
+{
+	static constexpr uint32 FileMagic = 0x584F5646;
+	static constexpr int32 FileVersion = 1;
+
+	/** Grid the cells of a cache file belong to, a different grid invalidates all of them */
+	struct FGrid
+	{
+		FIntVector Resolution = FIntVector::ZeroValue;
+		FVector Min = FVector::ZeroVector;
+		FVector CellSize = FVector::ZeroVector;
+
+		int32 GetNumCells() const { return Resolution.X * Resolution.Y * Resolution.Z; }
+
+		friend FArchive& operator<<(FArchive& Ar, FGrid& Grid)
+		{
+			return Ar << Grid.Resolution << Grid.Min << Grid.CellSize;
+		}
+
+		bool operator==(const FGrid& Other) const
+		{
+			return Resolution == Other.Resolution && Min.Equals(Other.Min, 0.01) && CellSize.Equals(Other.CellSize, 0.001);
+		}
+	};
+
+	/** Static primitive gathered on the game thread, rasterized on the background task if its cache record is outdated */
+	struct FPrimitive
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FString Key;
+		uint32 Hash = 0;
+	};
+
+	/** Solid cells of one primitive inside the box of cells its bounds overlap, one bit per cell with x fastest */
+	struct FPrimitiveRecord
+	{
+		FString Key;
+		uint32 Hash = 0;
+		FIntVector Min = FIntVector::ZeroValue;
+		FIntVector Size = FIntVector::ZeroValue;
+		TArray<uint32> Bits;
+
+		friend FArchive& operator<<(FArchive& Ar, FPrimitiveRecord& Record)
+		{
+			return Ar << Record.Key << Record.Hash << Record.Min << Record.Size << Record.Bits;
+		}
+	};
+
+	static FString GetCachePath(const UFireSimulatorVolume& Volume)
+	{
+		const FString LevelName = FPackageName::GetShortName(UWorld::RemovePIEPrefix(Volume.GetPackage()->GetName()));
+		const AActor* Owner = Volume.GetOwner();
+		const FString VolumeName = Owner ? FString::Printf(TEXT("%s.%s"), *Owner->GetName(), *Volume.GetName()) : Volume.GetName();
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("FireSimulation"), TEXT("Obstacles"), LevelName, VolumeName + TEXT(".obstacles"));
+	}
+
+	/** Owner and component names stay the same between editor, PIE and cooked runs of a level */
+	static FString GetPrimitiveKey(const UPrimitiveComponent& Component)
+	{
+		const AActor* Owner = Component.GetOwner();
+		return Owner ? FString::Printf(TEXT("%s.%s"), *Owner->GetName(), *Component.GetName()) : Component.GetName();
+	}
+
+	/** Changes with the placement, the bounds and the collision geometry of the primitive */
+	static uint32 HashPrimitive(UPrimitiveComponent& Component)
+	{
+		const FTransform& Transform = Component.GetComponentTransform();
+		const FVector Values[] = { Transform.GetLocation(), Transform.GetRotation().Euler(), Transform.GetScale3D(), Component.Bounds.BoxExtent };
+		uint32 Hash = FCrc::MemCrc32(Values, sizeof(Values));
+		if (const UBodySetup* BodySetup = Component.GetBodySetup())
+		{
+			Hash = HashCombine(Hash, GetTypeHash(BodySetup->BodySetupGuid));
+		}
+		return Hash;
+	}
+
+	/** A cell is solid when its box overlaps the collision of the primitive, simple collision counts its interior as well */
+	static FPrimitiveRecord Rasterize(UPrimitiveComponent& Component, const FGrid& Grid)
+	{
+		const FBox Bounds = Component.Bounds.GetBox();
+		const FVector MinCell = ((Bounds.Min - Grid.Min) / Grid.CellSize).ComponentMax(FVector::ZeroVector);
+		const FVector MaxCell = ((Bounds.Max - Grid.Min) / Grid.CellSize).ComponentMin(FVector(Grid.Resolution - FIntVector(1)));
+
+		FPrimitiveRecord Record;
+		Record.Min = FIntVector(FMath::FloorToInt32(MinCell.X), FMath::FloorToInt32(MinCell.Y), FMath::FloorToInt32(MinCell.Z));
+		const FIntVector Max(FMath::FloorToInt32(MaxCell.X), FMath::FloorToInt32(MaxCell.Y), FMath::FloorToInt32(MaxCell.Z));
+		Record.Size = FIntVector(FMath::Max(Max.X - Record.Min.X + 1, 0), FMath::Max(Max.Y - Record.Min.Y + 1, 0), FMath::Max(Max.Z - Record.Min.Z + 1, 0));
+
+		const int32 NumCells = Record.Size.X * Record.Size.Y * Record.Size.Z;
+		TArray<uint8> Solid;
+		Solid.SetNumZeroed(NumCells);
+		const FCollisionShape CellShape = FCollisionShape::MakeBox(0.5 * Grid.CellSize);
+		ParallelFor(Record.Size.Z, [&](int32 Z)
+		{
+			for (int32 Y = 0; Y < Record.Size.Y; ++Y)
+			{
+				for (int32 X = 0; X < Record.Size.X; ++X)
+				{
+					const FVector Center = Grid.Min + (FVector(Record.Min + FIntVector(X, Y, Z)) + 0.5) * Grid.CellSize;
+					Solid[(Z * Record.Size.Y + Y) * Record.Size.X + X] = Component.OverlapComponent(Center, FQuat::Identity, CellShape) ? 1 : 0;
+				}
+			}
+		});
+
+		Record.Bits.SetNumZeroed(FMath::DivideAndRoundUp(NumCells, 32));
+		for (int32 Index = 0; Index < NumCells; ++Index)
+		{
+			Record.Bits[Index >> 5] |= uint32(Solid[Index]) << (Index & 31);
+		}
+		return Record;
+	}
+
+	/** Records of the cache file, empty if it is missing, outdated or was written for another grid */
+	static TMap<FString, FPrimitiveRecord> LoadCache(const FString& Path, const FGrid& Grid)
+	{
+		TMap<FString, FPrimitiveRecord> Records;
+		TArray<uint8> File;
+		if (!FFileHelper::LoadFileToArray(File, *Path, FILEREAD_Silent))
+		{
+			return Records;
+		}
+
+		FMemoryReader Reader(File);
+		uint32 Magic = 0;
+		int32 Version = 0;
+		FGrid FileGrid;
+		int32 UncompressedSize = 0;
+		Reader << Magic << Version << FileGrid << UncompressedSize;
+		if (Reader.IsError() || Magic != FileMagic || Version != FileVersion || !(FileGrid == Grid) || UncompressedSize <= 0)
+		{
+			return Records;
+		}
+
+		TArray<uint8> Payload;
+		Payload.SetNumUninitialized(UncompressedSize);
+		const int32 Offset = int32(Reader.Tell());
+		if (!FCompression::UncompressMemory(NAME_Zlib, Payload.GetData(), UncompressedSize, File.GetData() + Offset, File.Num() - Offset))
+		{
+			UE_LOG(LogFireSimulation, Warning, TEXT("Obstacle cache %s is corrupt, voxelizing again"), *Path);
+			return Records;
+		}
+
+		FMemoryReader PayloadReader(Payload);
+		TArray<FPrimitiveRecord> Loaded;
+		PayloadReader << Loaded;
+		if (!PayloadReader.IsError())
+		{
+			for (FPrimitiveRecord& Record : Loaded)
+			{
+				Records.Add(Record.Key, MoveTemp(Record));
+			}
+		}
+		return Records;
+	}
+
+	/** The records compress well, most of their bits are runs of open cells */
+	static void SaveCache(const FString& Path, FGrid Grid, TArray<FPrimitiveRecord>& Records)
+	{
+		TArray<uint8> Payload;
+		FMemoryWriter PayloadWriter(Payload);
+		PayloadWriter << Records;
+
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Payload.Num());
+		TArray<uint8> Compressed;
+		Compressed.SetNumUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Payload.GetData(), Payload.Num()))
+		{
+			return;
+		}
+		Compressed.SetNum(CompressedSize);
+
+		TArray<uint8> File;
+		FMemoryWriter Writer(File);
+		uint32 Magic = FileMagic;
+		int32 Version = FileVersion;
+		int32 UncompressedSize = Payload.Num();
+		Writer << Magic << Version << Grid << UncompressedSize;
+		File.Append(Compressed);
+		if (!FFileHelper::SaveArrayToFile(File, *Path))
+		{
+			UE_LOG(LogFireSimulation, Warning, TEXT("Failed to write the obstacle cache %s"), *Path);
+		}
+	}
+}
+
+void FFireSimulationVoxelizer::VoxelizeAsync(const UFireSimulatorVolume& Volume, const FIntVector& Resolution, const FVector& Size, FFireVoxelizeCallback&& OnComplete)
+{
+	using namespace FireVoxelizer;
+	TRACE_CPUPROFILER_EVENT_SCOPE(FireSimulation_GatherObstacles);
+
+	FGrid Grid;
+	Grid.Resolution = Resolution;
+	Grid.Min = Volume.GetComponentLocation() - 0.5 * Size;
+	Grid.CellSize = Size / FVector(Resolution);
+
+	// the world, the names and the placements of the primitives are only safe to read on the game thread
+	TArray<FPrimitive> Primitives;
+	if (UWorld* World = Volume.GetWorld())
+	{
+		TArray<FOverlapResult> Overlaps;
+		World->OverlapMultiByObjectType(Overlaps, Grid.Min + 0.5 * Size, FQuat::Identity, FCollisionObjectQueryParams(ECC_WorldStatic), FCollisionShape::MakeBox(0.5 * Size));
+
+		TSet<const UPrimitiveComponent*> Visited;
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			UPrimitiveComponent* Component = Overlap.GetComponent();
+			if (!Component || Component->Mobility != EComponentMobility::Static)
+			{
+				continue;
+			}
+
+			// a component with several bodies overlaps more than once
+			bool bVisited = false;
+			Visited.Add(Component, &bVisited);
+			if (!bVisited)
+			{
+				Primitives.Add({ Component, GetPrimitiveKey(*Component), HashPrimitive(*Component) });
+			}
+		}
+	}
+
+	const bool bUseCache = GFireSimulationObstacleCache != 0;
+	UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Grid, Primitives = MoveTemp(Primitives), bUseCache, CachePath = GetCachePath(Volume), VolumeName = Volume.GetPathName(), OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FireSimulation_Voxelize);
+
+		TMap<FString, FPrimitiveRecord> Cached = bUseCache ? LoadCache(CachePath, Grid) : TMap<FString, FPrimitiveRecord>();
+		const int32 NumCached = Cached.Num();
+
+		TArray<FPrimitiveRecord> Records;
+		int32 NumRasterized = 0;
+		for (const FPrimitive& Primitive : Primitives)
+		{
+			FPrimitiveRecord* CachedRecord = Cached.Find(Primitive.Key);
+			if (CachedRecord && CachedRecord->Hash == Primitive.Hash)
+			{
+				Records.Add(MoveTemp(*CachedRecord));
+				continue;
+			}
+
+			// garbage collection waits until the primitive is rasterized, one destroyed since the gather is left out
+			FGCScopeGuard GCGuard;
+			UPrimitiveComponent* Component = Primitive.Component.Get();
+			if (!Component)
+			{
+				continue;
+			}
+
+			FPrimitiveRecord& Record = Records.Add_GetRef(Rasterize(*Component, Grid));
+			Record.Key = Primitive.Key;
+			Record.Hash = Primitive.Hash;
+			++NumRasterized;
+		}
+
+		// a removed primitive leaves one record less than the file held
+		if (bUseCache && (NumRasterized > 0 || Records.Num() != NumCached))
+		{
+			SaveCache(CachePath, Grid, Records);
+		}
+
+		TArray<uint32> Bits;
+		Bits.SetNumZeroed(FMath::DivideAndRoundUp(Grid.GetNumCells(), 32));
+		for (const FPrimitiveRecord& Record : Records)
+		{
+			for (int32 Z = 0; Z < Record.Size.Z; ++Z)
+			{
+				for (int32 Y = 0; Y < Record.Size.Y; ++Y)
+				{
+					for (int32 X = 0; X < Record.Size.X; ++X)
+					{
+						const int32 Local = (Z * Record.Size.Y + Y) * Record.Size.X + X;
+						if ((Record.Bits[Local >> 5] >> (Local & 31)) & 1)
+						{
+							const FIntVector Cell = Record.Min + FIntVector(X, Y, Z);
+							const int32 Index = (Cell.Z * Grid.Resolution.Y + Cell.Y) * Grid.Resolution.X + Cell.X;
+							Bits[Index >> 5] |= 1u << (Index & 31);
+						}
+					}
+				}
+			}
+		}
+
+		UE_LOG(LogFireSimulation, Log, TEXT("Voxelized %d static primitives into the obstacles of %s, %d of them rasterized"),
+			Records.Num(), *VolumeName, NumRasterized);
+
+		AsyncTask(ENamedThreads::GameThread, [Bits = MoveTemp(Bits), OnComplete = MoveTemp(OnComplete)]() mutable
+		{
+			OnComplete(MoveTemp(Bits));
+		});
+	});
+}
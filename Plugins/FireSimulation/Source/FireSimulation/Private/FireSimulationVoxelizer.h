@@ -0,0 +1,26 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UFireSimulatorVolume;
+
+/** Receives the solid cells of a voxelized grid with x fastest, on the game thread */
+using FFireVoxelizeCallback = TUniqueFunction<void(TArray<uint32>&& Bits)>;
+
+/**
+ * Voxelizes the static collision geometry that overlaps a fire volume into its obstacles, one bit per velocity cell.
+ * The cells of every primitive are cached per level and volume under Saved/FireSimulation/Obstacles, so only primitives
+ * that were added, moved or changed their collision are rasterized again.
+ */
+class FFireSimulationVoxelizer
+{
+public:
+	/**
+	 * Gathers the static primitives of the axis aligned grid of Resolution and Size centered at the volume on the game thread,
+	 * the cache is loaded and changed primitives are rasterized on a background task. OnComplete runs on the game thread
+	 * afterwards, also if the volume ended play in the meantime.
+	 */
+	static void VoxelizeAsync(const UFireSimulatorVolume& Volume, const FIntVector& Resolution, const FVector& Size, FFireVoxelizeCallback&& OnComplete);
+};
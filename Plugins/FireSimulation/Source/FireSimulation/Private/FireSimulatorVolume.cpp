@@ -4,14 +4,22 @@
 #include "FireSimulatorVolume.h"
 
 #include "FireSimulation.h"
+#include "FireSimulationCascade.h"
+#include "FireSimulationContext.h"
+#include "FireSimulationCpuContext.h"
+#include "FireSimulationEmitterBatch.h"
+#include "FireSimulationSubsystem.h"
+#include "FireSimulationVoxelizer.h"
+#include "RenderingThread.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
 
 
 // Sets default values for this component's properties
 UFireSimulatorVolume::UFireSimulatorVolume()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
+	// Simulation steps are recorded by UFireSimulationSubsystem for all volumes at once, so the component itself never ticks.
+	PrimaryComponentTick.bCanEverTick = false;
 
 	// ...
 }
@@ -21,21 +29,181 @@ UFireSimulatorVolume::UFireSimulatorVolume()
 void UFireSimulatorVolume::BeginPlay()
 {
 	Super::BeginPlay();
+	LLM_SCOPE_BYTAG(FireSimulation);
 
-	FFireSimulationModule::Get().Initialize(VolumeSize, Config);
+	UFireSimulationSubsystem* Subsystem = GetWorld()->GetSubsystem<UFireSimulationSubsystem>();
+	const FFireSimulationConfig EffectiveConfig = GetConfig();
+	if (FFireSimulationCpuContext::IsEnabled())
+	{
+		CpuContext = MakeShared<FFireSimulationCpuContext, ESPMode::ThreadSafe>();
+		CpuContext->Initialize(VolumeSize, EffectiveConfig);
+	}
+	else
+	{
+		// the volume shrinks to fit into what the other volumes of the world left of the memory budget
+		Context = MakeShared<FFireSimulationContext, ESPMode::ThreadSafe>();
+		Context->Initialize(VolumeSize, EffectiveConfig, Subsystem ? Subsystem->GetGpuBytes() : 0);
+		if (EffectiveConfig.NumCascadeLevels > 1)
+		{
+			Cascade = MakeShared<FFireSimulationCascade, ESPMode::ThreadSafe>(*Context, EffectiveConfig);
+		}
+	}
+
+	if (Subsystem)
+	{
+		Subsystem->Register(this);
+	}
+
+	// Register assigns the atlas slot, atlas volumes are stepped together without emitters, commands or field readbacks
+	const bool bStandalone = CpuContext.IsValid() || !Context->GetAtlas();
+	if (bStandalone)
+	{
+		Emitters = MakeShared<FFireEmitterBatch, ESPMode::ThreadSafe>();
+		Field = MakeShared<FFireSimulationField, ESPMode::ThreadSafe>();
+		if (CpuContext.IsValid())
+		{
+			CpuContext->SetField(Field);
+		}
+		else
+		{
+			// the rendering thread drains the queue when the volume steps
+			CommandQueue = MakeShared<FFireSimulationCommandQueue, ESPMode::ThreadSafe>();
+			Context->SetField(Field);
+		}
+	}
+
+	// the obstacles of atlas slots and scrolling grids are not tied to the static geometry around the volume
+	if (bStandalone && !EffectiveConfig.bScrolling && EffectiveConfig.bStaticObstacles)
+	{
+		const FIntVector Resolution = CpuContext.IsValid() ? CpuContext->GetVelocityResolution() : Context->GetBaseResolution();
+		const FVector Size(CpuContext.IsValid() ? CpuContext->GetLocalSize() : Context->GetLocalSize());
+
+		// the volume simulates without static obstacles until they arrive, a volume that ended play by then drops them
+		TWeakPtr<FFireSimulationContext, ESPMode::ThreadSafe> WeakContext = Context;
+		TWeakPtr<FFireSimulationCpuContext, ESPMode::ThreadSafe> WeakCpuContext = CpuContext;
+		FFireSimulationVoxelizer::VoxelizeAsync(*this, Resolution, Size, [WeakContext, WeakCpuContext, Resolution](TArray<uint32>&& Bits)
+		{
+			if (!Bits.ContainsByPredicate([](uint32 Word) { return Word != 0; }))
+			{
+				return;
+			}
+
+			if (const TSharedPtr<FFireSimulationCpuContext, ESPMode::ThreadSafe> PinnedCpuContext = WeakCpuContext.Pin())
+			{
+				PinnedCpuContext->SetStaticObstacles(Bits, Resolution);
+			}
+			else if (TSharedPtr<FFireSimulationContext, ESPMode::ThreadSafe> PinnedContext = WeakContext.Pin())
+			{
+				ENQUEUE_RENDER_COMMAND(SetFireSimulationStaticObstacles)(
+					[Context = MoveTemp(PinnedContext), Bits = MoveTemp(Bits), Resolution](FRHICommandListImmediate&) mutable
+				{
+					Context->SetStaticObstacles(MoveTemp(Bits), Resolution);
+				});
+			}
+		});
+	}
+}
+
+FFireSimulationConfig UFireSimulatorVolume::GetConfig() const
+{
+	// the levels of a cascade stay nested around the component by scrolling with it
+	FFireSimulationConfig EffectiveConfig = Config;
+	EffectiveConfig.bScrolling |= Config.NumCascadeLevels > 1;
+	return EffectiveConfig;
 }
 
 void UFireSimulatorVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	if (UFireSimulationSubsystem* Subsystem = GetWorld()->GetSubsystem<UFireSimulationSubsystem>())
+	{
+		Subsystem->Unregister(this);
+	}
+
+	CpuContext.Reset();
+	Emitters.Reset();
+	CommandQueue.Reset();
+	Field.Reset();
+
+	// render resources of the context have to be released on the rendering thread
+	ENQUEUE_RENDER_COMMAND(ReleaseFireSimulationContext)(
+		[Context = MoveTemp(Context), Cascade = MoveTemp(Cascade)](FRHICommandListImmediate&)
+	{
+	});
+
 	Super::EndPlay(EndPlayReason);
 }
 
+void UFireSimulatorVolume::AddEmitter(const FFireEmitter& Emitter)
+{
+	if (AcceptsEmitters())
+	{
+		FireSimulationEmitters::Add(*Emitters, Emitter, GetWorld()->GetDeltaSeconds());
+	}
+}
+
+void UFireSimulatorVolume::AddEmitters(const TArray<FFireEmitter>& InEmitters)
+{
+	if (AcceptsEmitters())
+	{
+		const float DeltaSeconds = GetWorld()->GetDeltaSeconds();
+		for (const FFireEmitter& Emitter : InEmitters)
+		{
+			FireSimulationEmitters::Add(*Emitters, Emitter, DeltaSeconds);
+		}
+	}
+}
 
-// Called every frame
-void UFireSimulatorVolume::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UFireSimulatorVolume::AddMeshSurfaceEmitter(const UStaticMeshComponent* Mesh, const FFireEmitter& Emission)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (!AcceptsEmitters() || !Mesh || !Mesh->GetStaticMesh())
+	{
+		return;
+	}
+
+	const FTransform& MeshToWorld = Mesh->GetComponentTransform();
+	const TArray<FVector3f>& Points = FireSimulationEmitters::GetSurfacePoints(*Mesh->GetStaticMesh());
+	const float DeltaSeconds = GetWorld()->GetDeltaSeconds();
+	FFireEmitter Emitter = Emission;
+	if (Points.IsEmpty())
+	{
+		// cooked meshes without CPU access emit from their bounds
+		const FBoxSphereBounds LocalBounds = Mesh->CalcBounds(FTransform::Identity);
+		Emitter.Shape = EFireEmitterShape::Box;
+		Emitter.Location = MeshToWorld.TransformPosition(LocalBounds.Origin);
+		Emitter.Rotation = MeshToWorld.GetRotation();
+		Emitter.Extent = LocalBounds.BoxExtent * MeshToWorld.GetScale3D().GetAbs();
+		FireSimulationEmitters::Add(*Emitters, Emitter, DeltaSeconds);
+		return;
+	}
 
-	FFireSimulationModule::Get().Dispatch(DeltaTime, Config);
+	Emitter.Shape = EFireEmitterShape::Point;
+	for (const FVector3f& Point : Points)
+	{
+		Emitter.Location = MeshToWorld.TransformPosition(FVector(Point));
+		FireSimulationEmitters::Add(*Emitters, Emitter, DeltaSeconds);
+	}
 }
 
+bool UFireSimulatorVolume::AcceptsEmitters()
+{
+	if (Emitters.IsValid())
+	{
+		return true;
+	}
+
+	// atlas volumes are stepped together without emitters, volumes that did not begin play have nothing to emit into
+	if (!bWarnedAboutEmitters)
+	{
+		UE_LOG(LogFireSimulation, Warning, TEXT("%s drops its emitters, only standalone volumes that began play take emitters"), *GetPathName());
+		bWarnedAboutEmitters = true;
+	}
+	return false;
+}
+
+void UFireSimulatorVolume::ConsumeEmitters(FFireEmitterBatch& OutBatch)
+{
+	if (Emitters.IsValid())
+	{
+		OutBatch.Emitters = MoveTemp(Emitters->Emitters);
+	}
+}
@@ -0,0 +1,117 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireScratchPool.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireScratchPoolPlanTest, "Plugins.FireSimulation.ScratchPool.Plan",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FFireScratchPoolPlanTest::RunTest(const FString& Parameters)
+{
+	// stages of an unfused dense step, see FireStage in FireSimulationContext.cpp
+	enum EStage : int32
+	{
+		PrepareAdvectionFwd,
+		PrepareAdvectionBack,
+		AdvectFluid,
+		AdvectVelocity,
+		Buoyancy,
+		Extinguish,
+		Vorticity,
+		Confinement,
+		Divergence,
+		PreparePressure,
+		Pressure,
+		Projection,
+		Num
+	};
+
+	const FRDGTextureDesc VelocityDesc = FRDGTextureDesc::Create3D(FIntVector(64, 64, 64), PF_FloatRGBA);
+	const FRDGTextureDesc FluidDesc = FRDGTextureDesc::Create3D(FIntVector(128, 128, 128), PF_FloatRGBA);
+	const FRDGTextureDesc PressureDesc = FRDGTextureDesc::Create3D(FIntVector(64, 64, 64), PF_R16F);
+
+	struct FLifetime { const TCHAR* Name; FRDGTextureDesc Desc; int32 First; int32 Last; };
+	const FLifetime Lifetimes[] =
+	{
+		{ TEXT("Velocity"), VelocityDesc, PrepareAdvectionFwd, AdvectVelocity },
+		{ TEXT("Fluid"), FluidDesc, PrepareAdvectionFwd, AdvectFluid },
+		{ TEXT("Phi1"), FluidDesc, PrepareAdvectionFwd, AdvectFluid },
+		{ TEXT("Phi0"), FluidDesc, PrepareAdvectionBack, AdvectFluid },
+		{ TEXT("AdvectedFluid"), FluidDesc, AdvectFluid, Extinguish },
+		{ TEXT("FluidOut"), FluidDesc, Extinguish, Num },
+		{ TEXT("AdvectedVelocity"), VelocityDesc, AdvectVelocity, Buoyancy },
+		{ TEXT("BuoyantVelocity"), VelocityDesc, Buoyancy, Confinement },
+		{ TEXT("Vorticity"), VelocityDesc, Vorticity, Confinement },
+		{ TEXT("ConfinedVelocity"), VelocityDesc, Confinement, Projection },
+		{ TEXT("Divergence"), PressureDesc, Divergence, Pressure },
+		{ TEXT("Pressure0"), PressureDesc, PreparePressure, Projection },
+		{ TEXT("Pressure1"), PressureDesc, Pressure, Projection },
+		{ TEXT("VelocityOut"), VelocityDesc, Projection, Num },
+	};
+	constexpr int32 VelocityIn = 0;
+	constexpr int32 FluidIn = 1;
+	constexpr int32 FluidOut = 5;
+	constexpr int32 BuoyantVelocity = 7;
+
+	FFireScratchPool Pool;
+	FFireScratchPool Unaliased;
+	for (const FLifetime& Lifetime : Lifetimes)
+	{
+		Pool.Declare(Lifetime.Name, Lifetime.Desc, Lifetime.First, Lifetime.Last);
+		Unaliased.Declare(Lifetime.Name, Lifetime.Desc, Lifetime.First, Lifetime.Last);
+	}
+
+	Pool.Plan();
+
+	// lifetimes that touch in a stage overlap, a stage may read one texture and write another
+	for (int32 A = 0; A < Pool.GetNumLogical(); ++A)
+	{
+		for (int32 B = A + 1; B < Pool.GetNumLogical(); ++B)
+		{
+			const bool bOverlap = Lifetimes[A].First <= Lifetimes[B].Last && Lifetimes[B].First <= Lifetimes[A].Last;
+			if (Pool.GetPhysical(A) == Pool.GetPhysical(B))
+			{
+				TestFalse(*FString::Printf(TEXT("Logical %d and %d share a texture with overlapping lifetimes"), A, B), bOverlap);
+				TestTrue(*FString::Printf(TEXT("Logical %d and %d share a texture with different descriptions"), A, B), Lifetimes[A].Desc == Lifetimes[B].Desc);
+			}
+		}
+	}
+
+	// disjoint lifetimes share, so every description needs only as many textures as it has live at once
+	const FRDGTextureDesc Descs[] = { VelocityDesc, FluidDesc, PressureDesc };
+	for (const FRDGTextureDesc& Desc : Descs)
+	{
+		int32 MaxLive = 0;
+		for (int32 Stage = 0; Stage <= Num; ++Stage)
+		{
+			int32 NumLive = 0;
+			for (const FLifetime& Lifetime : Lifetimes)
+			{
+				NumLive += Lifetime.Desc == Desc && Lifetime.First <= Stage && Stage <= Lifetime.Last;
+			}
+			MaxLive = FMath::Max(MaxLive, NumLive);
+		}
+
+		TSet<int32> Physicals;
+		for (int32 Handle = 0; Handle < Pool.GetNumLogical(); ++Handle)
+		{
+			if (Lifetimes[Handle].Desc == Desc)
+			{
+				Physicals.Add(Pool.GetPhysical(Handle));
+			}
+		}
+		TestEqual(TEXT("Textures of a description"), Physicals.Num(), MaxLive);
+	}
+	TestEqual(TEXT("Velocity and buoyant velocity share"), Pool.GetPhysical(VelocityIn), Pool.GetPhysical(BuoyantVelocity));
+	TestEqual(TEXT("Fluid and fluid output share"), Pool.GetPhysical(FluidIn), Pool.GetPhysical(FluidOut));
+	TestTrue(TEXT("Aliasing saves memory"), Pool.GetPeakBytes() < Pool.GetUnaliasedBytes());
+
+	// without aliasing every logical texture has its own
+	Unaliased.Plan(false);
+	TestEqual(TEXT("Textures without aliasing"), Unaliased.GetNumPhysical(), Unaliased.GetNumLogical());
+	return true;
+}
+
+#endif
@@ -0,0 +1,33 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationContext.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireSimulationResolutionTest, "Plugins.FireSimulation.Resolution",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FFireSimulationResolutionTest::RunTest(const FString& Parameters)
+{
+	FFireSimulationConfig Config;
+	Config.CellSize = 10.0f;
+	Config.MaxResolution = 128;
+
+	// the same volume with each axis as the major one has to give the same resolution, rotated with the axes
+	static const FVector Sizes[] = { FVector(1000.0, 400.0, 250.0), FVector(3000.0, 120.0, 90.0), FVector(80.0, 64.0, 50.0) };
+	for (const FVector& Size : Sizes)
+	{
+		const FIntVector XMajor = FFireSimulationContext::ComputeResolution(Size, Config);
+		const FIntVector YMajor = FFireSimulationContext::ComputeResolution(FVector(Size.Y, Size.X, Size.Z), Config);
+		const FIntVector ZMajor = FFireSimulationContext::ComputeResolution(FVector(Size.Y, Size.Z, Size.X), Config);
+
+		TestTrue(*FString::Printf(TEXT("%s has cells on every axis"), *Size.ToString()), XMajor.GetMin() > 0);
+		TestTrue(*FString::Printf(TEXT("%s is within MaxResolution"), *Size.ToString()), XMajor.GetMax() <= Config.MaxResolution);
+		TestEqual(*FString::Printf(TEXT("%s, y major"), *Size.ToString()), YMajor, FIntVector(XMajor.Y, XMajor.X, XMajor.Z));
+		TestEqual(*FString::Printf(TEXT("%s, z major"), *Size.ToString()), ZMajor, FIntVector(XMajor.Y, XMajor.Z, XMajor.X));
+	}
+	return true;
+}
+
+#endif
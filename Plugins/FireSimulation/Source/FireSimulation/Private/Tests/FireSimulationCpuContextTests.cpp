@@ -0,0 +1,182 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationContext.h"
+#include "FireSimulationCpuContext.h"
+#include "FireSimulationEmitterBatch.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeExit.h"
+#include "RenderGraphBuilder.h"
+#include "RenderingThread.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFireSimulationCpuMatchesGpuTest, "Plugins.FireSimulation.CpuMatchesGpu",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+namespace FireSimulationCpuTests
+{
+	static constexpr int32 NumSteps = 16;
+	static constexpr float TimeStep = 1.0f / 30.0f;
+	/** Largest difference of a cell of the two fields relative to the peak of the CPU field, see FFireSimulationCpuContext */
+	static constexpr float Tolerance = 0.02f;
+}
+
+bool FFireSimulationCpuMatchesGpuTest::RunTest(const FString& Parameters)
+{
+	using namespace FireSimulationCpuTests;
+
+	if (!FApp::CanEverRender())
+	{
+		AddWarning(TEXT("Skipped, the process can not render"));
+		return true;
+	}
+
+	// one full precision sub-step with a fixed Jacobi iteration count, the configuration the CPU backend mirrors exactly
+	FFireSimulationConfig Config;
+	Config.CellSize = 10.0f;
+	Config.MaxResolution = 32;
+	Config.bAdaptiveSubSteps = false;
+	Config.bAdaptivePressureIterations = false;
+	Config.PressureSolver = EFirePressureSolver::Jacobi;
+	Config.bSparse = false;
+	Config.bDynamicObstacles = false;
+	Config.VelocityPrecision = EFireStoragePrecision::Full;
+	Config.FluidPrecision = EFireStoragePrecision::Full;
+	Config.PressurePrecision = EFireStoragePrecision::Full;
+	Config.DivergencePrecision = EFireStoragePrecision::Full;
+	const FVector Size(320.0);
+
+	// both backends publish every step at the velocity resolution
+	IConsoleVariable* IntervalVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("r.FireSimulation.FieldReadbackInterval"));
+	IConsoleVariable* DownsampleVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("r.FireSimulation.FieldReadbackDownsample"));
+	const int32 Interval = IntervalVariable->GetInt();
+	const int32 Downsample = DownsampleVariable->GetInt();
+	IntervalVariable->Set(1, ECVF_SetByCode);
+	DownsampleVariable->Set(1, ECVF_SetByCode);
+
+	FFireSimulationCpuContext CpuContext;
+	CpuContext.Initialize(Size, Config);
+	const FFireSimulationFieldPtr CpuField = MakeShared<FFireSimulationField, ESPMode::ThreadSafe>();
+	CpuContext.SetField(CpuField);
+
+	TSharedPtr<FFireSimulationContext, ESPMode::ThreadSafe> Context = MakeShared<FFireSimulationContext, ESPMode::ThreadSafe>();
+	Context->Initialize(Size, Config);
+	const FFireSimulationFieldPtr GpuField = MakeShared<FFireSimulationField, ESPMode::ThreadSafe>();
+	Context->SetField(GpuField);
+
+	ON_SCOPE_EXIT
+	{
+		// render resources of the context have to be released on the rendering thread
+		ENQUEUE_RENDER_COMMAND(ReleaseFireSimulationTestContext)([Context = MoveTemp(Context)](FRHICommandListImmediate&)
+		{
+		});
+		FlushRenderingCommands();
+		IntervalVariable->Set(Interval, ECVF_SetByCode);
+		DownsampleVariable->Set(Downsample, ECVF_SetByCode);
+	};
+
+	const FIntVector Resolution = CpuContext.GetVelocityResolution();
+	if (!TestEqual(TEXT("Both backends choose the same resolution"), Context->GetBaseResolution(), Resolution))
+	{
+		return false;
+	}
+
+	// a solid block above the emitter, the plume has to flow around it on both backends
+	TArray<uint32> Bits;
+	Bits.SetNumZeroed(FMath::DivideAndRoundUp(Resolution.X * Resolution.Y * Resolution.Z, 32));
+	for (int32 Z = Resolution.Z * 9 / 16; Z < Resolution.Z * 11 / 16; ++Z)
+	{
+		for (int32 Y = Resolution.Y * 3 / 8; Y < Resolution.Y * 5 / 8; ++Y)
+		{
+			for (int32 X = Resolution.X * 3 / 8; X < Resolution.X * 5 / 8; ++X)
+			{
+				const int32 Bit = (Z * Resolution.Y + Y) * Resolution.X + X;
+				Bits[Bit >> 5] |= 1u << (Bit & 31);
+			}
+		}
+	}
+	CpuContext.SetStaticObstacles(Bits, Resolution);
+	ENQUEUE_RENDER_COMMAND(SetFireSimulationTestObstacles)([Context, Bits, Resolution](FRHICommandListImmediate&) mutable
+	{
+		Context->SetStaticObstacles(MoveTemp(Bits), Resolution);
+	});
+
+	FFireEmitter Emitter;
+	Emitter.Shape = EFireEmitterShape::Sphere;
+	Emitter.Location = FVector(0.0, 0.0, -0.3 * Size.Z);
+	Emitter.Radius = 40.0f;
+	Emitter.Heat = 3000.0f;
+	Emitter.Reaction = 10.0f;
+	FFireEmitterBatch Batch;
+	Batch.GridOrigin = -0.5 * Size;
+	Batch.Emitters.Add(FireSimulationEmitters::Scale(Emitter, TimeStep));
+
+	// readbacks complete a few steps late, the CPU snapshots are kept until the latest GPU one is known
+	TMap<uint32, TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe>> CpuSnapshots;
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		CpuContext.SetGridOrigin(Batch.GridOrigin);
+		CpuContext.SetEmitters(Batch);
+		CpuContext.Step(TimeStep, Config);
+		const TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot = CpuField->GetSnapshot();
+		CpuSnapshots.Add(Snapshot->Step, Snapshot);
+
+		ENQUEUE_RENDER_COMMAND(StepFireSimulationTest)([Context, Batch, Config](FRHICommandListImmediate& RHICmdList)
+		{
+			FRDGBuilder GraphBuilder(RHICmdList);
+			Context->SetGridOrigin(Batch.GridOrigin);
+			Context->SetEmitters(Batch);
+			Context->AddPasses(GraphBuilder, TimeStep, Config);
+			GraphBuilder.Execute();
+		});
+		FlushRenderingCommands();
+	}
+
+	const TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> GpuSnapshot = GpuField->GetSnapshot();
+	if (!TestTrue(TEXT("The GPU field was read back"), GpuSnapshot.IsValid()))
+	{
+		return false;
+	}
+	const TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe>* CpuSnapshot = CpuSnapshots.Find(GpuSnapshot->Step);
+	if (!TestNotNull(TEXT("The CPU field of the read back step"), CpuSnapshot)
+		|| !TestEqual(TEXT("Both fields have the same resolution"), GpuSnapshot->Resolution, (*CpuSnapshot)->Resolution))
+	{
+		return false;
+	}
+
+	// the tolerance scales with the peaks, so the emitter has to have heated the volume for the comparison to mean anything
+	const FFireFieldSnapshot& Cpu = **CpuSnapshot;
+	const FFireFieldSnapshot& Gpu = *GpuSnapshot;
+	FVector4f Peak(0.0f, 0.0f, 0.0f, 0.0f);
+	FVector4f Error(0.0f, 0.0f, 0.0f, 0.0f);
+	float PeakSpeed = 0.0f;
+	float VelocityError = 0.0f;
+	for (int32 Index = 0; Index < Cpu.Fluid.Num(); ++Index)
+	{
+		const FVector4f Difference = Gpu.Fluid[Index] - Cpu.Fluid[Index];
+		for (int32 Channel = 0; Channel < 3; ++Channel)
+		{
+			Peak[Channel] = FMath::Max(Peak[Channel], FMath::Abs(Cpu.Fluid[Index][Channel]));
+			Error[Channel] = FMath::Max(Error[Channel], FMath::Abs(Difference[Channel]));
+		}
+		PeakSpeed = FMath::Max(PeakSpeed, Cpu.Velocity[Index].Size());
+		VelocityError = FMath::Max(VelocityError, (Gpu.Velocity[Index] - Cpu.Velocity[Index]).Size());
+	}
+	TestTrue(TEXT("The emitter heats the volume"), Peak.X > 0.0f && PeakSpeed > 0.0f);
+
+	static const TCHAR* Channels[] = { TEXT("Temperature"), TEXT("Reaction"), TEXT("Smoke") };
+	for (int32 Channel = 0; Channel < 3; ++Channel)
+	{
+		TestTrue(*FString::Printf(TEXT("%s of step %u within %.0f%% of its peak %g, largest difference %g"),
+			Channels[Channel], Gpu.Step, Tolerance * 100.0f, Peak[Channel], Error[Channel]),
+			Error[Channel] <= Tolerance * Peak[Channel] + UE_KINDA_SMALL_NUMBER);
+	}
+	TestTrue(*FString::Printf(TEXT("Velocity of step %u within %.0f%% of its peak %g, largest difference %g"),
+		Gpu.Step, Tolerance * 100.0f, PeakSpeed, VelocityError),
+		VelocityError <= Tolerance * PeakSpeed + UE_KINDA_SMALL_NUMBER);
+	return true;
+}
+
+#endif
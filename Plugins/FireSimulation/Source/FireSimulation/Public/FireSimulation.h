@@ -3,10 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
 #include "Modules/ModuleManager.h"
-#include "FireSimulationConfig.h"
 
-class UTextureRenderTargetVolume;
+DECLARE_LOG_CATEGORY_EXTERN(LogFireSimulation, Log, All);
+LLM_DECLARE_TAG(FireSimulation);
 
 class FIRESIMULATION_API FFireSimulationModule final : public IModuleInterface
 {
@@ -24,31 +25,4 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
-
-	void Initialize(const FVector& Size, const FFireSimulationConfig& Config);
-	void Dispatch(float TimeStep, const FFireSimulationConfig& Config);
-
-private:
-	struct FBufferDesc
-	{
-		FIntVector Resolution = FIntVector::ZeroValue;
-		FIntVector Bounds = FIntVector::ZeroValue;
-		FVector3f RcpSize = FVector3f::ZeroVector;
-		FIntVector ThreadCount = FIntVector::ZeroValue;
-
-		void Init(FIntVector Res);
-	};
-	
-	void DispatchRenderThread(float TimeStep, const FFireSimulationConfig& Config, FRHICommandListImmediate& CommandList);
-
-	FVector3f LocalSize = FVector3f::ZeroVector;
-	FVector2f TScale = FVector2f::ZeroVector;
-	FVector3f WorldToGrid = FVector3f::ZeroVector;
-	
-	FBufferDesc Velocity;
-	FBufferDesc Fluid;
-
-	TRefCountPtr<IPooledRenderTarget> PrevVelocity;
-	TRefCountPtr<IPooledRenderTarget> PrevFluid;
-	TRefCountPtr<IPooledRenderTarget> Obstacles;
 };
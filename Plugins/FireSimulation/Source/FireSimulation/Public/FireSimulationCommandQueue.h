@@ -0,0 +1,95 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationConfig.h"
+#include "FireSimulationEmitter.h"
+#include "Misc/TVariant.h"
+#include <atomic>
+
+/** Velocity change inside a sphere for one step, e.g. an explosion or a fan */
+struct FFireImpulse
+{
+	FVector Location = FVector::ZeroVector;
+	/** At least one velocity cell */
+	float Radius = 100.0f;
+	/** Velocity change at the center in world units per second, falls off linearly to zero at the radius */
+	FVector Velocity = FVector::ZeroVector;
+};
+
+enum class EFireObstacleType : uint8
+{
+	Box,
+	Sphere,
+	Capsule,
+};
+
+/** Collision shape of a moving body for one step, in addition to the bodies the volume gathers with Config.bDynamicObstacles */
+struct FFireObstacle
+{
+	EFireObstacleType Type = EFireObstacleType::Box;
+	/** Shape to world, shapes are centered at the origin of the transform and capsules are aligned with its z axis */
+	FTransform Transform;
+	/** Box: half size, sphere: radius in x, capsule: radius in x and half length of its segment in z */
+	FVector Extent = FVector::ZeroVector;
+	/** Velocity of the body in world units per second, the fluid around the shape takes it */
+	FVector Velocity = FVector::ZeroVector;
+};
+
+using FFireSimulationCommand = TVariant<FFireEmitter, FFireImpulse, FFireObstacle>;
+
+/**
+ * Edits of one volume, submitted from any thread and drained by the rendering thread once per step of the volume. Commands
+ * are kept in a fixed ring of r.FireSimulation.CommandQueueSize slots, submitting does not lock or allocate and drops the
+ * command when the ring is full. Overlapping impulses of a step are merged, only the latest submitted config is kept.
+ */
+class FIRESIMULATION_API FFireSimulationCommandQueue
+{
+public:
+	/** Capacity 0 takes r.FireSimulation.CommandQueueSize */
+	explicit FFireSimulationCommandQueue(int32 InCapacity = 0);
+	~FFireSimulationCommandQueue();
+
+	FFireSimulationCommandQueue(const FFireSimulationCommandQueue&) = delete;
+	FFireSimulationCommandQueue& operator=(const FFireSimulationCommandQueue&) = delete;
+
+	/** Emits for DeltaSeconds, see UFireSimulatorVolume::AddEmitter. False when the command was dropped. */
+	bool SubmitEmitter(const FFireEmitter& Emitter, float DeltaSeconds);
+	bool SubmitImpulse(const FFireImpulse& Impulse);
+	/** Ignored by volumes without Config.bDynamicObstacles */
+	bool SubmitObstacle(const FFireObstacle& Obstacle);
+	/**
+	 * Replaces the simulation parameters of the volume from its next step on. Cell size, resolution, atlas, scrolling, obstacle
+	 * and cascade settings are fixed at BeginPlay and kept. Allocates, meant for rare changes.
+	 */
+	void SubmitConfig(const FFireSimulationConfig& Config);
+
+	/** Rendering thread only, false when the queue is empty */
+	bool Dequeue(FFireSimulationCommand& OutCommand);
+	/** Rendering thread only, the latest config submitted so far or nullptr */
+	const FFireSimulationConfig* ReceiveConfig();
+	/** Rendering thread only, commands dropped since the last call */
+	uint32 ConsumeNumDropped();
+
+private:
+	struct FSlot
+	{
+		/** Position the slot can be written at, one past it once the command is written */
+		std::atomic<uint32> Sequence = 0;
+		FFireSimulationCommand Command;
+	};
+
+	bool Enqueue(const FFireSimulationCommand& Command);
+
+	TUniquePtr<FSlot[]> Slots;
+	uint32 Mask = 0;
+	/** Producers and the consumer advance on their own cache lines */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Head = 0;
+	alignas(PLATFORM_CACHE_LINE_SIZE) uint32 Tail = 0;
+	std::atomic<uint32> NumDropped = 0;
+	std::atomic<FFireSimulationConfig*> PendingConfig = nullptr;
+	TUniquePtr<FFireSimulationConfig> ReceivedConfig;
+};
+
+using FFireSimulationCommandQueuePtr = TSharedPtr<FFireSimulationCommandQueue, ESPMode::ThreadSafe>;
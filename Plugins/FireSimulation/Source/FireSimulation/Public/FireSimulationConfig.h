@@ -2,6 +2,26 @@
 
 #include "FireSimulationConfig.generated.h"
 
+UENUM()
+enum class EFirePressureSolver : uint8
+{
+	// NumPressureIterations Jacobi iterations on the simulation grid
+	Jacobi,
+	// NumMultigridCycles V-cycles over a hierarchy of coarser grids, atlas volumes fall back to Jacobi
+	Multigrid,
+};
+
+UENUM()
+enum class EFireStoragePrecision : uint8
+{
+	// 16 bit float per channel
+	Half,
+	// 32 bit float per channel
+	Full,
+	// 8 bit per channel, scaled by FluidStorageRange, fluid only since the other fields are signed
+	UNorm8,
+};
+
 USTRUCT()
 struct FIRESIMULATION_API FFireSimulationConfig
 {
@@ -12,6 +32,63 @@ struct FIRESIMULATION_API FFireSimulationConfig
 	int32 FluidResolutionScale = 2;
 	int32 NumPressureIterations = 8;
 
+	// Splits a step into sub-steps so that no velocity moves more than CflNumber cells per sub-step. The largest velocity
+	// is read back from an earlier step to avoid stalls, MaxSubSteps bounds the cost of a frame spike.
+	bool bAdaptiveSubSteps = false;
+	float CflNumber = 2.0f;
+	int32 MaxSubSteps = 4;
+	// Keeps the fluid state before the last step next to the current one, so that a renderer can blend between them while
+	// the volume runs at r.FireSimulation.FixedRate. Free with fused kernels, one more fluid texture without.
+	bool bInterpolateOutput = true;
+
+	// Jacobi iterations run in one dispatch, each dispatch recomputes a halo of this many cells around its tile (1..4).
+	// 1 dispatches every iteration on its own, more sweeps save bandwidth but round the pressure at the tile halos differently.
+	int32 PressureSweepsPerDispatch = 1;
+	EFirePressureSolver PressureSolver = EFirePressureSolver::Jacobi;
+	int32 NumMultigridCycles = 2;
+	// Jacobi sweeps before and after the coarse grid correction on every multigrid level
+	int32 MultigridSmoothingSteps = 2;
+	// Start the solve from the pressure of the previous step instead of a guess from the divergence
+	bool bWarmStartPressure = true;
+	// Jacobi only: chooses the iteration count between Min and MaxPressureIterations so that the rms residual
+	// stays near PressureResidualTarget, starting from NumPressureIterations
+	bool bAdaptivePressureIterations = false;
+	int32 MinPressureIterations = 1;
+	int32 MaxPressureIterations = 32;
+	float PressureResidualTarget = 0.001f;
+
+	// Simulate only bricks of 8^3 velocity cells that hold content or border on it, values below SparseThreshold count as empty.
+	// Not used by atlas volumes, sparse volumes solve the pressure with Jacobi iterations.
+	bool bSparse = false;
+	float SparseThreshold = 0.0001f;
+
+	// Storage of the simulated fields, trades precision for memory and bandwidth. Velocity, pressure and divergence
+	// fall back to Half for UNorm8. r.FireSimulation.StorageReport lists the bytes per cell of every combination.
+	EFireStoragePrecision VelocityPrecision = EFireStoragePrecision::Half;
+	EFireStoragePrecision FluidPrecision = EFireStoragePrecision::Half;
+	EFireStoragePrecision PressurePrecision = EFireStoragePrecision::Half;
+	EFireStoragePrecision DivergencePrecision = EFireStoragePrecision::Half;
+	// Largest temperature, reaction, vapor and smoke that UNorm8 fluid storage can hold
+	FVector4f FluidStorageRange = FVector4f(2000.0f, 1.0f, 1.0f, 1.0f);
+
+	// Small volumes with equal parameters share atlas textures and are simulated in one dispatch per stage
+	bool bUseAtlas = false;
+
+	// The grid follows the volume component in whole world aligned cells, with wrapped addressing instead of copies.
+	// Cells that enter the grid start empty. Scrolling volumes are dense Jacobi volumes outside of atlases at a fixed resolution.
+	bool bScrolling = false;
+	// Voxelizes the static collision geometry inside the volume into obstacles on a background task started at BeginPlay, cached
+	// per level and volume under Saved/FireSimulation/Obstacles. Standalone volumes that do not scroll only.
+	bool bStaticObstacles = false;
+	// Rasterizes the collision shapes of movable bodies inside the volume into obstacles every step, the fluid around them
+	// takes their velocity. Standalone volumes only, r.FireSimulation.MaxDynamicObstacleShapes bounds the shapes per volume.
+	bool bDynamicObstacles = false;
+
+	// Nested scrolling grids around the component for domains larger than one grid, each level has the resolution of the volume
+	// at twice the cell size of the one inside it and steps at half its rate. Neighbouring levels exchange boundary velocity and
+	// fluid every step. More than one level implies bScrolling (1..4).
+	int32 NumCascadeLevels = 1;
+
 	// Fluid advection
 	FVector4f FluidDissipation = FVector4f(0.001f, 0.0f, 0.03f, 0.03f);
 	FVector4f FluidDecay = FVector4f(0.0f, 0.2f, 0.0f, 0.0f);
@@ -29,6 +106,13 @@ struct FIRESIMULATION_API FFireSimulationConfig
 	float ReactionExtinguish = 0.15f;
 	FVector3f TemperatureDistribution = FVector3f(0,0,0);
 
+	// Emitters, see UFireSimulatorVolume::AddEmitter. Scales of the heat, reaction and vapor they add. Emitted water turns into
+	// vapor from VaporMinTemperature on, fully 1 / VaporTemperatureScale above it, and brings VaporDensity smoke per vapor.
+	FVector3f EmitterScale = FVector3f(1.0f, 1.0f, 1.0f);
+	float VaporMinTemperature = 100.0f;
+	float VaporTemperatureScale = 0.01f;
+	float VaporDensity = 0.5f;
+
 	// Turbulence
 	float VorticityStrength = 12.0f;
 };
@@ -0,0 +1,52 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FireSimulationEmitter.generated.h"
+
+UENUM(BlueprintType)
+enum class EFireEmitterShape : uint8
+{
+	// Spreads its amount over the eight cells around the location, e.g. a droplet of a spray
+	Point,
+	// Every cell within Radius of the location
+	Sphere,
+	// Every cell within Extent of the location along the rotated axes
+	Box,
+};
+
+/**
+ * Source of heat, fuel and water vapor or a temperature sink, submitted to a volume for one frame with
+ * UFireSimulatorVolume::AddEmitter. Rates are per second and per cell, scaled by the emitter settings of the volume config.
+ */
+USTRUCT(BlueprintType)
+struct FIRESIMULATION_API FFireEmitter
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	EFireEmitterShape Shape = EFireEmitterShape::Sphere;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	FVector Location = FVector::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	FQuat Rotation = FQuat::Identity;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	float Radius = 50.0f;
+	// Half size of a box
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	FVector Extent = FVector(50.0);
+
+	// Temperature added per second
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	float Heat = 0.0f;
+	// Fuel added per second, burns while it is hot enough
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	float Reaction = 0.0f;
+	// Water added per second, turns into vapor and smoke in hot cells and extinguishes the fire
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	float Vapor = 0.0f;
+	// Temperature removed per second
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emitter")
+	float TemperatureSink = 0.0f;
+};
@@ -0,0 +1,77 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+
+/** State of a volume around a world position, see FFireSimulationField::Query */
+struct FFireFieldSample
+{
+	/** Largest temperature and reaction of the velocity cells around the position */
+	float Temperature = 0.0f;
+	float Reaction = 0.0f;
+	/** Mean smoke density of the velocity cells around the position */
+	float Smoke = 0.0f;
+	/** World units per second */
+	FVector Velocity = FVector::ZeroVector;
+};
+
+/** Age of the state a query sampled */
+struct FFireFieldStaleness
+{
+	/** False until the first readback of the volume completed, all samples are zero then */
+	bool bValid = false;
+	/** Step of the volume the state was read back after and the steps the volume took since */
+	uint32 Step = 0;
+	uint32 StepsBehind = 0;
+	/** Seconds since the step was recorded on the rendering thread */
+	double AgeSeconds = 0.0;
+};
+
+/** Field of one read back step, every cell covers r.FireSimulation.FieldReadbackDownsample^3 velocity cells */
+struct FFireFieldSnapshot
+{
+	FIntVector Resolution = FIntVector::ZeroValue;
+	/** World position of the minimum corner of cell 0 and size of the volume at the step */
+	FVector GridOrigin = FVector::ZeroVector;
+	FVector Size = FVector::ZeroVector;
+	FVector CellSize = FVector::ZeroVector;
+	uint32 Step = 0;
+	/** FPlatformTime::Seconds when the step was recorded */
+	double Time = 0.0;
+	/** Temperature, reaction and smoke per cell with x fastest, w is zero so that a cell loads as one vector */
+	TArray<FVector4f> Fluid;
+	TArray<FVector3f> Velocity;
+};
+
+/**
+ * CPU copy of the temperature, reaction, smoke and velocity of a standalone volume, mirrored every
+ * r.FireSimulation.FieldReadbackInterval steps through a ring of asynchronous readbacks that never stall the rendering thread.
+ * CPU volumes publish their state directly after the step.
+ * Queries sample the latest completed readback and report how old it is.
+ */
+class FIRESIMULATION_API FFireSimulationField
+{
+public:
+	/**
+	 * Samples the latest state at the world Positions into OutSamples, which has to hold as many samples. Cells are blended
+	 * trilinearly, positions outside the volume sample zero. Any thread, thousands of positions per call are cheap.
+	 */
+	FFireFieldStaleness Query(TConstArrayView<FVector> Positions, TArrayView<FFireFieldSample> OutSamples) const;
+	/** Latest completed readback, null before the first one. Any thread. */
+	TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> GetSnapshot() const;
+
+	/** Thread that steps the volume only, counts a step of the volume and returns its number */
+	uint32 AdvanceStep();
+	/** Thread that steps the volume only, replaces the snapshot unless it is older than the current one */
+	void Publish(const TSharedRef<const FFireFieldSnapshot, ESPMode::ThreadSafe>& InSnapshot);
+
+private:
+	mutable FRWLock Lock;
+	TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot;
+	std::atomic<uint32> NumSteps = 0;
+};
+
+using FFireSimulationFieldPtr = TSharedPtr<FFireSimulationField, ESPMode::ThreadSafe>;
@@ -0,0 +1,74 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FireSimulationSubsystem.generated.h"
+
+class UFireSimulatorVolume;
+class FFireSimulationAtlas;
+
+/** Fixed rate clock of a volume or atlas, see r.FireSimulation.FixedRate */
+struct FFireSimulationSchedule
+{
+	/** Simulation time the volume is behind the game, stepped off in fixed steps */
+	float Accumulator = 0.0f;
+	/** Measured milliseconds of a CPU step */
+	float CostMs = 0.0f;
+	/** Blend weight from the previous to the current fluid state */
+	float Alpha = 1.0f;
+	/** Resolution level of a standalone GPU volume, see r.FireSimulation.LodScreenSize */
+	int32 LodLevel = 0;
+};
+
+/**
+ * Gathers all active fire volumes of a world and records their simulation steps
+ * into a single render command and render graph per frame.
+ * Volumes are stepped at r.FireSimulation.FixedRate with staggered phases. Steps that do not fit into
+ * r.FireSimulation.FrameBudgetMs are deferred, off-screen and distant volumes first.
+ * Standalone GPU volumes lower their resolution with their screen coverage and keep their state across the change.
+ */
+UCLASS()
+class FIRESIMULATION_API UFireSimulationSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void Register(UFireSimulatorVolume* Volume);
+	void Unregister(UFireSimulatorVolume* Volume);
+	/** Registered volumes, game thread only */
+	TConstArrayView<TObjectPtr<UFireSimulatorVolume>> GetVolumes() const { return Volumes; }
+
+	/** GPU memory planned by all volumes and atlases, compared against r.FireSimulation.MemoryBudgetMB */
+	uint64 GetGpuBytes() const;
+	/** Logs the memory of every volume and atlas and the totals against the budget */
+	void LogMemoryReport() const;
+	/**
+	 * Weight of the current fluid state when blending from the previous one, see FFireSimulationContext::GetPreviousFluidState.
+	 * Rendering lags one fixed step behind the game and reaches the current state when the next step is due.
+	 */
+	float GetInterpolationAlpha(const UFireSimulatorVolume* Volume) const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<UFireSimulatorVolume>> Volumes;
+	/** Per volume, volumes in an atlas are stepped together on the clock of their atlas */
+	TArray<FFireSimulationSchedule> Schedules;
+
+	TArray<TSharedPtr<FFireSimulationAtlas, ESPMode::ThreadSafe>> Atlases;
+	TArray<FFireSimulationSchedule> AtlasSchedules;
+	/** Clocks started so far, spreads the phases of new clocks over a step */
+	int32 NumClocks = 0;
+
+	FFireSimulationSchedule MakeSchedule();
+	const FFireSimulationSchedule* FindSchedule(const UFireSimulatorVolume* Volume) const;
+};
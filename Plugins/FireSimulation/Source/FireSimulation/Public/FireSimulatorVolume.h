@@ -3,10 +3,19 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "FireSimulationCommandQueue.h"
 #include "FireSimulationConfig.h"
+#include "FireSimulationEmitter.h"
+#include "FireSimulationField.h"
 #include "Components/SceneComponent.h"
 #include "FireSimulatorVolume.generated.h"
 
+class FFireSimulationCascade;
+class FFireSimulationContext;
+class FFireSimulationCpuContext;
+class UStaticMeshComponent;
+struct FFireEmitterBatch;
+
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class FIRESIMULATION_API UFireSimulatorVolume : public USceneComponent
 {
@@ -16,6 +25,38 @@ public:
 	// Sets default values for this component's properties
 	UFireSimulatorVolume();
 
+	/** Config the volume simulates with, a cascade scrolls without changing the authored Config */
+	FFireSimulationConfig GetConfig() const;
+	const TSharedPtr<FFireSimulationContext, ESPMode::ThreadSafe>& GetContext() const { return Context; }
+	/** Set instead of the context when the volume is simulated on the CPU */
+	const TSharedPtr<FFireSimulationCpuContext, ESPMode::ThreadSafe>& GetCpuContext() const { return CpuContext; }
+	/** Coarser levels around the context, set when Config.NumCascadeLevels is above one */
+	const TSharedPtr<FFireSimulationCascade, ESPMode::ThreadSafe>& GetCascade() const { return Cascade; }
+
+	/**
+	 * Emits into the volume for the current frame, submit again every frame to keep emitting. All emitters of a volume are
+	 * splatted in one pass per step. Standalone GPU and CPU volumes only, atlas volumes log a warning and drop them.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FireSimulation")
+	void AddEmitter(const FFireEmitter& Emitter);
+	UFUNCTION(BlueprintCallable, Category = "FireSimulation")
+	void AddEmitters(const TArray<FFireEmitter>& InEmitters);
+	/** Emits from points spread over the surface of a static mesh, every point emits like a point emitter with the rates of Emission */
+	UFUNCTION(BlueprintCallable, Category = "FireSimulation")
+	void AddMeshSurfaceEmitter(const UStaticMeshComponent* Mesh, const FFireEmitter& Emission);
+	/** Moves the emitters submitted since the last step into OutBatch, called by the subsystem when the volume steps */
+	void ConsumeEmitters(FFireEmitterBatch& OutBatch);
+	/**
+	 * Queue for edits from any thread, e.g. Mass processors or physics callbacks, drained by the rendering thread when the volume
+	 * steps. Keep the pointer to submit without the game thread. Valid from BeginPlay for standalone GPU volumes.
+	 */
+	const FFireSimulationCommandQueuePtr& GetCommandQueue() const { return CommandQueue; }
+	/**
+	 * CPU copy of temperature, reaction, smoke and velocity for gameplay queries from any thread, see FFireSimulationField::Query.
+	 * Valid from BeginPlay for standalone GPU and CPU volumes, empty until the first readback completed.
+	 */
+	const FFireSimulationFieldPtr& GetField() const { return Field; }
+
 protected:
 	UPROPERTY(EditAnywhere)
 	FFireSimulationConfig Config;
@@ -26,7 +67,15 @@ protected:
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-public:
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+private:
+	/** False with a warning the first time for volumes without emitters */
+	bool AcceptsEmitters();
+
+	TSharedPtr<FFireSimulationContext, ESPMode::ThreadSafe> Context;
+	TSharedPtr<FFireSimulationCpuContext, ESPMode::ThreadSafe> CpuContext;
+	TSharedPtr<FFireSimulationCascade, ESPMode::ThreadSafe> Cascade;
+	TSharedPtr<FFireEmitterBatch, ESPMode::ThreadSafe> Emitters;
+	FFireSimulationCommandQueuePtr CommandQueue;
+	FFireSimulationFieldPtr Field;
+	bool bWarnedAboutEmitters = false;
 };
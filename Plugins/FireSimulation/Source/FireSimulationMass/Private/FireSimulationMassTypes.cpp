@@ -0,0 +1,12 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationMassTypes.h"
+
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+
+void UFireSimulationSampleTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	BuildContext.RequireFragment<FTransformFragment>();
+	BuildContext.AddFragment<FFireSampleFragment>();
+}
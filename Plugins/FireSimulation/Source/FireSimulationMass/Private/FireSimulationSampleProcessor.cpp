@@ -0,0 +1,184 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FireSimulationSampleProcessor.h"
+
+#include "FireSimulationField.h"
+#include "FireSimulationMassTypes.h"
+#include "FireSimulationSubsystem.h"
+#include "FireSimulatorVolume.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "Engine/World.h"
+
+namespace FireSimulationMass
+{
+	/** Snapshot of a volume for one frame */
+	struct FVolume
+	{
+		TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot;
+		FBox Bounds = FBox(ForceInit);
+		FVector3f RcpCellSize = FVector3f::ZeroVector;
+		float AgeSeconds = 0.0f;
+	};
+
+	/**
+	 * Blends the eight cells around Local, a position relative to the grid origin. Temperature, reaction and smoke are blended
+	 * together as one vector, the derivatives of the blend along each axis are their gradient per world unit.
+	 */
+	static FORCEINLINE VectorRegister4Float Sample(const FVolume& Volume, const FVector3f& Local, VectorRegister4Float& OutDx, VectorRegister4Float& OutDy, VectorRegister4Float& OutDz)
+	{
+		const FFireFieldSnapshot& Snapshot = *Volume.Snapshot;
+		const FIntVector& Resolution = Snapshot.Resolution;
+		const FVector3f Cell = Local * Volume.RcpCellSize - 0.5f;
+		const FVector3f Low(FMath::FloorToFloat(Cell.X), FMath::FloorToFloat(Cell.Y), FMath::FloorToFloat(Cell.Z));
+		const FVector3f Weight = Cell - Low;
+
+		// cells past the border repeat the border cell
+		const int32 X0 = FMath::Clamp(int32(Low.X), 0, Resolution.X - 1);
+		const int32 X1 = FMath::Clamp(int32(Low.X) + 1, 0, Resolution.X - 1);
+		const int32 Y0 = FMath::Clamp(int32(Low.Y), 0, Resolution.Y - 1);
+		const int32 Y1 = FMath::Clamp(int32(Low.Y) + 1, 0, Resolution.Y - 1);
+		const int32 Z0 = FMath::Clamp(int32(Low.Z), 0, Resolution.Z - 1);
+		const int32 Z1 = FMath::Clamp(int32(Low.Z) + 1, 0, Resolution.Z - 1);
+		const int32 Row00 = (Z0 * Resolution.Y + Y0) * Resolution.X;
+		const int32 Row10 = (Z0 * Resolution.Y + Y1) * Resolution.X;
+		const int32 Row01 = (Z1 * Resolution.Y + Y0) * Resolution.X;
+		const int32 Row11 = (Z1 * Resolution.Y + Y1) * Resolution.X;
+
+		const FVector4f* Fluid = Snapshot.Fluid.GetData();
+		const VectorRegister4Float C000 = VectorLoad(&Fluid[Row00 + X0].X);
+		const VectorRegister4Float C100 = VectorLoad(&Fluid[Row00 + X1].X);
+		const VectorRegister4Float C010 = VectorLoad(&Fluid[Row10 + X0].X);
+		const VectorRegister4Float C110 = VectorLoad(&Fluid[Row10 + X1].X);
+		const VectorRegister4Float C001 = VectorLoad(&Fluid[Row01 + X0].X);
+		const VectorRegister4Float C101 = VectorLoad(&Fluid[Row01 + X1].X);
+		const VectorRegister4Float C011 = VectorLoad(&Fluid[Row11 + X0].X);
+		const VectorRegister4Float C111 = VectorLoad(&Fluid[Row11 + X1].X);
+
+		const VectorRegister4Float Wx = VectorSetFloat1(Weight.X);
+		const VectorRegister4Float Wy = VectorSetFloat1(Weight.Y);
+		const VectorRegister4Float Wz = VectorSetFloat1(Weight.Z);
+
+		// along x, then y, then z
+		const VectorRegister4Float D00 = VectorSubtract(C100, C000);
+		const VectorRegister4Float D10 = VectorSubtract(C110, C010);
+		const VectorRegister4Float D01 = VectorSubtract(C101, C001);
+		const VectorRegister4Float D11 = VectorSubtract(C111, C011);
+		const VectorRegister4Float X00 = VectorMultiplyAdd(D00, Wx, C000);
+		const VectorRegister4Float X10 = VectorMultiplyAdd(D10, Wx, C010);
+		const VectorRegister4Float X01 = VectorMultiplyAdd(D01, Wx, C001);
+		const VectorRegister4Float X11 = VectorMultiplyAdd(D11, Wx, C011);
+		const VectorRegister4Float XY0 = VectorMultiplyAdd(VectorSubtract(X10, X00), Wy, X00);
+		const VectorRegister4Float XY1 = VectorMultiplyAdd(VectorSubtract(X11, X01), Wy, X01);
+
+		const VectorRegister4Float Dx0 = VectorMultiplyAdd(VectorSubtract(D10, D00), Wy, D00);
+		const VectorRegister4Float Dx1 = VectorMultiplyAdd(VectorSubtract(D11, D01), Wy, D01);
+		const VectorRegister4Float Dy0 = VectorSubtract(X10, X00);
+		const VectorRegister4Float Dy1 = VectorSubtract(X11, X01);
+		OutDx = VectorMultiply(VectorMultiplyAdd(VectorSubtract(Dx1, Dx0), Wz, Dx0), VectorSetFloat1(Volume.RcpCellSize.X));
+		OutDy = VectorMultiply(VectorMultiplyAdd(VectorSubtract(Dy1, Dy0), Wz, Dy0), VectorSetFloat1(Volume.RcpCellSize.Y));
+		OutDz = VectorMultiply(VectorSubtract(XY1, XY0), VectorSetFloat1(Volume.RcpCellSize.Z));
+		return VectorMultiplyAdd(VectorSubtract(XY1, XY0), Wz, XY0);
+	}
+}
+
+UFireSimulationSampleProcessor::UFireSimulationSampleProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = int32(EProcessorExecutionFlags::All);
+	ExecutionOrder.ExecuteBefore.Add(UE::Mass::ProcessorGroupNames::Avoidance);
+	// the volumes of the subsystem change on the game thread, the chunks are still sampled in parallel
+	bRequiresGameThreadExecution = true;
+}
+
+void UFireSimulationSampleProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FFireSampleFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void UFireSimulationSampleProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FireSimulationSampleProcessor);
+
+	// the snapshots are taken once per frame, the chunks read them without locking
+	TArray<FireSimulationMass::FVolume, TInlineAllocator<8>> Volumes;
+	const UWorld* World = EntityManager.GetWorld();
+	if (const UFireSimulationSubsystem* Subsystem = World ? World->GetSubsystem<UFireSimulationSubsystem>() : nullptr)
+	{
+		const double Now = FPlatformTime::Seconds();
+		for (const UFireSimulatorVolume* Volume : Subsystem->GetVolumes())
+		{
+			if (!Volume || !Volume->GetField().IsValid())
+			{
+				continue;
+			}
+			TSharedPtr<const FFireFieldSnapshot, ESPMode::ThreadSafe> Snapshot = Volume->GetField()->GetSnapshot();
+			if (!Snapshot.IsValid() || Snapshot->Fluid.IsEmpty())
+			{
+				continue;
+			}
+
+			FireSimulationMass::FVolume& Entry = Volumes.AddDefaulted_GetRef();
+			Entry.Bounds = FBox(Snapshot->GridOrigin, Snapshot->GridOrigin + Snapshot->Size);
+			Entry.RcpCellSize = FVector3f(FVector::OneVector / Snapshot->CellSize);
+			Entry.AgeSeconds = float(Now - Snapshot->Time);
+			Entry.Snapshot = MoveTemp(Snapshot);
+		}
+	}
+
+	EntityQuery.ParallelForEachEntityChunk(EntityManager, Context, [&Volumes](FMassExecutionContext& ChunkContext)
+	{
+		const int32 NumEntities = ChunkContext.GetNumEntities();
+		const TConstArrayView<FTransformFragment> Transforms = ChunkContext.GetFragmentView<FTransformFragment>();
+		const TArrayView<FFireSampleFragment> Samples = ChunkContext.GetMutableFragmentView<FFireSampleFragment>();
+
+		// volumes away from every agent of the chunk are skipped
+		FBox ChunkBounds(ForceInit);
+		for (int32 Index = 0; Index < NumEntities; ++Index)
+		{
+			Samples[Index] = FFireSampleFragment();
+			ChunkBounds += Transforms[Index].GetTransform().GetLocation();
+		}
+
+		TArray<int32, TInlineAllocator<256>> Binned;
+		for (const FireSimulationMass::FVolume& Volume : Volumes)
+		{
+			if (!Volume.Bounds.Intersect(ChunkBounds))
+			{
+				continue;
+			}
+
+			Binned.Reset();
+			for (int32 Index = 0; Index < NumEntities; ++Index)
+			{
+				if (Volume.Bounds.IsInsideOrOn(Transforms[Index].GetTransform().GetLocation()))
+				{
+					Binned.Add(Index);
+				}
+			}
+
+			for (const int32 Index : Binned)
+			{
+				const FVector3f Local(Transforms[Index].GetTransform().GetLocation() - Volume.Snapshot->GridOrigin);
+				VectorRegister4Float Dx, Dy, Dz;
+				FVector4f Fluid, GradientX, GradientY, GradientZ;
+				VectorStore(FireSimulationMass::Sample(Volume, Local, Dx, Dy, Dz), &Fluid.X);
+				VectorStore(Dx, &GradientX.X);
+				VectorStore(Dy, &GradientY.X);
+				VectorStore(Dz, &GradientZ.X);
+
+				// x = temperature, y = reaction, z = smoke
+				FFireSampleFragment& Sample = Samples[Index];
+				if (Fluid.X >= Sample.Temperature)
+				{
+					Sample.Temperature = Fluid.X;
+					Sample.TemperatureGradient = FVector3f(GradientX.X, GradientY.X, GradientZ.X);
+					Sample.AgeSeconds = Volume.AgeSeconds;
+				}
+				Sample.Smoke = FMath::Max(Sample.Smoke, Fluid.Z);
+			}
+		}
+	});
+}
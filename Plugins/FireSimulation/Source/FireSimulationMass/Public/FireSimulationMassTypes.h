@@ -0,0 +1,37 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "MassEntityTypes.h"
+#include "FireSimulationMassTypes.generated.h"
+
+/**
+ * Fire around an agent, sampled every frame by UFireSimulationSampleProcessor from the CPU copy of the fire volumes, see
+ * FFireSimulationField. Zero outside of every volume, where volumes overlap the hottest one wins.
+ */
+USTRUCT()
+struct FIRESIMULATIONMASS_API FFireSampleFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Temperature blended from the cells around the agent */
+	float Temperature = 0.0f;
+	/** Smoke density blended from the cells around the agent, the densest volume where volumes overlap */
+	float Smoke = 0.0f;
+	/** Change of the temperature per world unit, points towards the heat. Avoidance steers against it. */
+	FVector3f TemperatureGradient = FVector3f::ZeroVector;
+	/** Seconds since the sampled state was simulated, see FFireFieldStaleness */
+	float AgeSeconds = 0.0f;
+};
+
+/** Samples the fire volumes of the world at the agent every frame into FFireSampleFragment */
+UCLASS(meta = (DisplayName = "Fire Sampling"))
+class FIRESIMULATIONMASS_API UFireSimulationSampleTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+};
@@ -0,0 +1,29 @@
+﻿// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityQuery.h"
+#include "MassProcessor.h"
+#include "FireSimulationSampleProcessor.generated.h"
+
+/**
+ * Samples temperature, its gradient and smoke for every agent with FFireSampleFragment, before avoidance. The latest field
+ * snapshot of every volume is taken once per frame, chunks are sampled in parallel. Within a chunk the agents are binned per
+ * volume, so the cells of a volume are walked once per chunk in agent order.
+ */
+UCLASS()
+class FIRESIMULATIONMASS_API UFireSimulationSampleProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UFireSimulationSampleProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery EntityQuery;
+};